@@ -8,8 +8,26 @@
 **  The ANSI C Corner Turn kernel.
 **
 ** Note:
-**  This kernel has been stripped out of all optimizations such as
-**  AltiVec or SSE.
+**  The corner turn is done by the cache-blocked engine of ctTile.c by
+**  default; 'naive' runs the original loop of this kernel, which has been
+**  stripped out of all optimizations such as AltiVec or SSE, and
+**  'recursive' the cache-oblivious engine.  'inplace' turns the input
+**  matrix in place, on one thread, and allocates no output matrix.  After
+**  the run the bandwidth is printed, with its fraction of a STREAM copy of
+**  the same size, and the peak resident memory.  'stream' runs the tiled
+**  engine with non-temporal stores and the input prefetched, at the
+**  fastest prefetch distance, and compares it with 'tiled'.  'outofcore' turns the
+**  input file into the output file a tile at a time, without loading
+**  either (ctOutOfCore.c), and prints the disk to disk throughput.
+**  'fp16' and 'bf16' turn the matrix stored in 2 byte elements
+**  (PcaCHalf.h), converted from and back to float outside the timed
+**  region, so that each element moves half the bytes; the output is
+**  checked with 'ctVerify <data set num> fp16' (or bf16).
+**
+**  The columns are split into bands of whole tiles, one per thread
+**  (ctThread.c).  Each thread first writes the rows of the output its
+**  band turns into, before timing, so that on a NUMA machine those pages
+**  are local to it; the bandwidth of each node is printed as well.
 **
 ** Input/Output:
 **  The input matrix is stored in file 
@@ -20,7 +38,8 @@
 **                  "./data/<dataSetNum>-ct-timing.dat".
 **
 ** Command:
-**   ct <data set num>
+**   ct <data set num> [tiled | stream | recursive | naive | inplace |
+**                     outofcore | fp16 | bf16]
 **
 ** Author: Hector Chan
 **         MIT Lincoln Laboratory
@@ -28,60 +47,316 @@
 ******************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "PcaCArray.h"
 #include "PcaCTimer.h"
+#include "PcaCHalf.h"
+#include "ct.h"
+#include "ctSimd.h"
+
+/* The matrix, the engine, and the band of columns of each thread. */
+struct ctTurn {
+  void  (*engine)(int, int, float *, float *, int, int);
+  int     numrows, numcols;
+  float  *in, *out;
+  int    *bounds;   /* thread t turns columns bounds[t] to bounds[t+1]-1 */
+  double *seconds;  /* and took seconds[t] */
+  int    *nodes;    /* on node nodes[t] */
+  int     inPlace;  /* ctInPlace on 'in' instead of the engine */
+  int     half;     /* or ctTiledHalfColumns on halfIn, if a PcaCHalf format */
+  pca_half *halfIn, *halfOut;
+};
 
 void ct(int numrows, int numcols, float *in, float *out)
+{
+  ctTiled(numrows, numcols, in, out);
+}
+
+void ctNaive(int numrows, int numcols, float *in, float *out)
+{
+  ctNaiveColumns(numrows, numcols, in, out, 0, numcols);
+}
+
+void ctNaiveColumns(int numrows, int numcols, float *in, float *out, int c0, int c1)
 {
   unsigned int i, j;
 
   for (i=0; i<numrows; i++) {
-    for (j=0; j<numcols; j++)
+    for (j=c0; j<c1; j++)
       *(out + j * numrows + i) = *(in + i * numcols + j);
   }
 }
 
+/*
+  Each thread writes zeros over the rows of the output its band turns
+  into, so that their pages are placed on its node before timing.
+*/
+static void ctTouchJob(void *arg, int thread, int numThreads)
+{
+  struct ctTurn *turn = (struct ctTurn *)arg;
+  int            c0 = turn->bounds[thread], c1 = turn->bounds[thread + 1];
+
+  if (turn->half)
+    memset(turn->halfOut + (unsigned long)c0 * turn->numrows, 0,
+           (unsigned long)(c1 - c0) * turn->numrows * sizeof(pca_half));
+  else
+    memset(turn->out + (unsigned long)c0 * turn->numrows, 0,
+           (unsigned long)(c1 - c0) * turn->numrows * sizeof(float));
+}
+
+static void ctTurnJob(void *arg, int thread, int numThreads);
+
+/*
+  ctTunePrefetch runs the streaming engine once with each prefetch
+  distance of CT_PREFETCH_TRIES, and returns the fastest, in rows.
+*/
+static int ctTunePrefetch(struct ctTurn *turn)
+{
+  static const int tries[] = CT_PREFETCH_TRIES;
+  int              k, rows, best = 0;
+  double           start, seconds, bestSeconds = -1.0;
+
+  for (k = 0; k < (int)(sizeof(tries) / sizeof(tries[0])); k++) {
+    rows = tries[k] * CT_SIMD_WIDTH;
+    ctSetPrefetch(rows);
+    start = ctThreadSeconds();
+    ctThreadRun(ctTurnJob, turn);
+    seconds = ctThreadSeconds() - start;
+#ifdef VERBOSE
+    printf("Prefetch %d rows ahead: %f sec\n", rows, seconds);
+#endif
+    if (bestSeconds < 0 || seconds < bestSeconds) {
+      best        = rows;
+      bestSeconds = seconds;
+    }
+  }
+
+  ctSetPrefetch(best);
+  return best;
+}
+
+static void ctTurnJob(void *arg, int thread, int numThreads)
+{
+  struct ctTurn *turn = (struct ctTurn *)arg;
+  double         start = ctThreadSeconds();
+
+  if (turn->inPlace)
+    ctInPlace(turn->numrows, turn->numcols, turn->in);
+  else if (turn->half)
+    ctTiledHalfColumns(turn->numrows, turn->numcols, turn->halfIn, turn->halfOut,
+                       turn->bounds[thread], turn->bounds[thread + 1]);
+  else
+    turn->engine(turn->numrows, turn->numcols, turn->in, turn->out,
+                 turn->bounds[thread], turn->bounds[thread + 1]);
+  turn->seconds[thread] = ctThreadSeconds() - start;
+  turn->nodes[thread]   = ctThreadNode();
+}
+
 int main(int argc, char **argv)
 {
   PcaCArrayFloat inmatrix, outmatrix, rtime;
+  PcaCArrayHalf  halfin, halfout;
   pca_timer_t    timer;
   char           inmatrixfile[100], outmatrixfile[100], timefile[100];
+  struct ctTurn  turn;
+  int            numThreads, thread, node, align, nodeThreads;
+  int            l1Tile, l2Tile, dim, outOfCore, tileRows, tileCols;
+  int            stream, prefetchRows, elemBytes;
+  long           peakKilobytes;
+  double         bytes, bandwidth, streamBandwidth, nodeBytes, nodeSeconds;
+  double         start, standardSeconds;
 
-  if (argc != 2) {
-    printf("Usage: %s <data set num>\n", argv[0]);
+  turn.engine  = ctTiledColumns;
+  turn.inPlace = 0;
+  outOfCore    = 0;
+  stream       = 0;
+  turn.half    = 0;
+  if (argc == 3 && pca_half_format(argv[2]) != 0)
+    turn.half = pca_half_format(argv[2]);
+  else if (argc == 3 && strcmp(argv[2], "inplace") == 0)
+    turn.inPlace = 1;
+  else if (argc == 3 && strcmp(argv[2], "outofcore") == 0)
+    outOfCore = 1;
+  else if (argc == 3 && strcmp(argv[2], "stream") == 0) {
+    turn.engine = ctTiledStreamColumns;
+    stream      = 1;
+  }
+  else if (argc == 3 && strcmp(argv[2], "naive") == 0)
+    turn.engine = ctNaiveColumns;
+  else if (argc == 3 && strcmp(argv[2], "recursive") == 0)
+    turn.engine = ctRecursiveColumns;
+  else if (argc == 3 && strcmp(argv[2], "tiled") != 0)
+    argc = 0;
+
+  if (argc != 2 && argc != 3) {
+    printf("Usage: %s <data set num> [tiled | stream | recursive | naive | inplace | "
+           "outofcore | fp16 | bf16]\n", argv[0]);
     return -1;
   }
 
+  elemBytes = turn.half ? sizeof(pca_half) : sizeof(float);
+
   /* Build the input file names */
   sprintf(inmatrixfile, "./data/%s-ct-inmatrix.dat", argv[1]);
   sprintf(outmatrixfile, "./data/%s-ct-outmatrix.dat", argv[1]);
   sprintf(timefile, "./data/%s-ct-timing.dat", argv[1]);
 
+  /* Out of core: file to file, neither matrix in memory */
+  if (outOfCore) {
+    pca_create_carray_1d(float, rtime, 1, PCA_REAL);
+    rtime.data[0] = ctOutOfCore(inmatrixfile, outmatrixfile, &tileRows, &tileCols, &bytes);
+    printf("Done.  Latency: %f s.\n", rtime.data[0]);
+    if (rtime.data[0] > 0)
+      printf("Disk to disk: %.1f MB/s, tiles of %d x %d.\n", bytes / rtime.data[0] / 1e6,
+             tileRows, tileCols);
+    printf("Peak RSS: %ld KB.\n", ctPeakKilobytes());
+    writeToFile(float, timefile, rtime);
+    clean_mem(float, rtime);
+    return 0;
+  }
+
   /* Read the input matrix from file */
   readFromFile(float, inmatrixfile, inmatrix);
 
   /* Allocate memory for output matrix and run time */
-  pca_create_carray_2d(float, outmatrix, inmatrix.size[1], inmatrix.size[0], PCA_REAL);
+  if (!turn.inPlace)
+    pca_create_carray_2d(float, outmatrix, inmatrix.size[1], inmatrix.size[0], PCA_REAL);
   pca_create_carray_1d(float, rtime, 1, PCA_REAL);
 
+  /* Store the input in halves, outside the timed region */
+  if (turn.half) {
+    pca_create_carray_2d(pca_half, halfin, inmatrix.size[0], inmatrix.size[1], PCA_REAL);
+    pca_create_carray_2d(pca_half, halfout, inmatrix.size[1], inmatrix.size[0], PCA_REAL);
+    pca_floats_to_halves(turn.half, inmatrix.data, halfin.data,
+                         (unsigned long)inmatrix.size[0] * inmatrix.size[1]);
+    turn.halfIn  = halfin.data;
+    turn.halfOut = halfout.data;
+  }
+
+  /* Find the tile sizes and start the threads outside the timed region */
+  ctTileSizes(&l1Tile, &l2Tile);
+  numThreads = turn.inPlace ? 1 : ctThreadProcessors(CT_THREADS);
+  ctThreadStart(numThreads);
+
+  /* Split the columns into bands of whole L1 tiles, one per thread */
+  turn.numrows = inmatrix.size[0];
+  turn.numcols = inmatrix.size[1];
+  turn.in      = inmatrix.data;
+  turn.out     = turn.inPlace ? NULL : outmatrix.data;
+  turn.bounds  = (int *)malloc((numThreads + 1) * sizeof(int));
+  turn.seconds = (double *)malloc(numThreads * sizeof(double));
+  turn.nodes   = (int *)malloc(numThreads * sizeof(int));
+  if (turn.bounds == NULL || turn.seconds == NULL || turn.nodes == NULL) {
+    printf("Out of memory\n");
+    return -1;
+  }
+  align = l1Tile > 0 ? l1Tile : CT_SIMD_WIDTH;
+  for (thread = 0; thread < numThreads; thread++)
+    turn.bounds[thread] = (int)((double)turn.numcols * thread / numThreads) / align * align;
+  turn.bounds[numThreads] = turn.numcols;
+
+  /* Place the output pages on the nodes of the threads that write them */
+  if (!turn.inPlace)
+    ctThreadRun(ctTouchJob, &turn);
+
+  /* Find the prefetch distance of the streaming engine */
+  prefetchRows = stream ? ctTunePrefetch(&turn) : 0;
+
   /* Run corner turn */
   timer = startTimer();
-  ct(inmatrix.size[0], inmatrix.size[1], inmatrix.data, outmatrix.data);
+  ctThreadRun(ctTurnJob, &turn);
   rtime.data[0] = stopTimer(timer); /* time is in second  */
+  peakKilobytes = ctPeakKilobytes();
 
 #ifdef VERBOSE
   printf("Time: %f sec\n", rtime.data[0]);
+  printf("Tiles: L1 %d x %d, L2 %d x %d, registers %d x %d\n",
+         l1Tile, l1Tile, l2Tile, l2Tile, CT_SIMD_WIDTH, CT_SIMD_WIDTH);
+  for (thread = 0; thread < numThreads; thread++)
+    printf("Thread %d: columns %d to %d, node %d, %f sec\n", thread,
+           turn.bounds[thread], turn.bounds[thread + 1] - 1, turn.nodes[thread],
+           turn.seconds[thread]);
 #endif
   printf("Done.  Latency: %f s.\n", rtime.data[0]);
 
+  /* Every element is read and written once, as in a copy */
+  bytes = 2.0 * turn.numrows * turn.numcols * elemBytes;
+  streamBandwidth = ctStreamCopy((unsigned long)turn.numrows * turn.numcols * elemBytes);
+  if (rtime.data[0] > 0) {
+    bandwidth = bytes / rtime.data[0];
+    printf("Bandwidth: %.1f MB/s, %.1f%% of STREAM copy (%.1f MB/s), %d threads.\n",
+           bandwidth / 1e6, 100.0 * bandwidth / streamBandwidth, streamBandwidth / 1e6,
+           numThreads);
+  }
+  else {
+    printf("Bandwidth: too fast to time; STREAM copy %.1f MB/s.\n",
+           streamBandwidth / 1e6);
+  }
+
+  printf("Peak RSS: %ld KB.\n", peakKilobytes);
+
+  /* The bandwidth of each node: its bytes over its slowest thread */
+  for (node = 0; node < ctThreadNodes(); node++) {
+    nodeThreads = 0;
+    nodeBytes   = nodeSeconds = 0.0;
+    for (thread = 0; thread < numThreads; thread++) {
+      if (turn.nodes[thread] != node)
+        continue;
+      nodeThreads++;
+      nodeBytes += 2.0 * turn.numrows * (turn.bounds[thread + 1] - turn.bounds[thread])
+                   * elemBytes;
+      if (turn.seconds[thread] > nodeSeconds)
+        nodeSeconds = turn.seconds[thread];
+    }
+    if (nodeThreads > 0 && nodeSeconds > 0)
+      printf("Node %d: %.1f MB/s, %d threads.\n", node, nodeBytes / nodeSeconds / 1e6,
+             nodeThreads);
+  }
+
+  /* Streaming against standard stores: the tiled engine on the same matrix */
+  if (stream) {
+    turn.engine = ctTiledColumns;
+    start = ctThreadSeconds();
+    ctThreadRun(ctTurnJob, &turn);
+    standardSeconds = ctThreadSeconds() - start;
+    if (rtime.data[0] > 0 && standardSeconds > 0)
+      printf("Stores: standard %.1f MB/s, streaming %.1f MB/s (%s), prefetch %d rows ahead.\n",
+             bytes / standardSeconds / 1e6, bytes / rtime.data[0] / 1e6,
+             CT_SIMD_STREAM ? "non-temporal" : "none on this machine, prefetch only",
+             prefetchRows);
+  }
+
+  ctThreadStop();
+  free(turn.bounds);
+  free(turn.seconds);
+  free(turn.nodes);
+
+  /* Back to float for the output file */
+  if (turn.half) {
+    pca_halves_to_floats(turn.half, halfout.data, outmatrix.data,
+                         (unsigned long)outmatrix.size[0] * outmatrix.size[1]);
+    clean_mem(pca_half, halfin);
+    clean_mem(pca_half, halfout);
+  }
+
   /* Write the run time and output matrix to file */
   writeToFile(float, timefile, rtime);
-  writeToFile(float, outmatrixfile, outmatrix);
+  if (turn.inPlace) {
+    /* The input now holds the transpose */
+    dim              = inmatrix.size[0];
+    inmatrix.size[0] = inmatrix.size[1];
+    inmatrix.size[1] = dim;
+    writeToFile(float, outmatrixfile, inmatrix);
+  }
+  else {
+    writeToFile(float, outmatrixfile, outmatrix);
+    clean_mem(float, outmatrix);
+  }
 
   /* Clean the memory */
   clean_mem(float, rtime);
-  clean_mem(float, outmatrix);
   clean_mem(float, inmatrix);
 
   return 0;
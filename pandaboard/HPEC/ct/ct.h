@@ -0,0 +1,198 @@
+/******************************************************************************
+** File: ct.h
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The corner turn engines and their configuration.
+**
+**    ctNaive     - the original row by row loop.
+**    ctTiled     - the cache-blocked engine (ctTile.c): tiles sized from
+**                  the L1 and L2 data caches, each taken apart into
+**                  CT_SIMD_WIDTH x CT_SIMD_WIDTH tiles transposed in
+**                  registers (ctSimd.h).
+**    ctRecursive - the cache-oblivious engine (ctTile.c): the larger
+**                  dimension is halved until the block fits CT_RECURSIVE_BASE.
+**                  ctTiled uses it when the cache geometry is unknown.
+**    ctTiledStream - ctTiled with non-temporal stores of the output and
+**                  the input prefetched (ctTile.c).
+**
+**    ctInPlace   - the in-place engine (ctInPlace.c): cycle following,
+**                  in the input matrix, with no second matrix.
+**
+**  ctOutOfCore (ctOutOfCore.c) turns a matrix file into another a tile at
+**  a time, for matrices larger than memory.
+**
+**  ctPermute (ctPermute.c) is the corner turn of a data cube: any
+**  permutation of the dimensions of an array of 4, 8 or 16 byte elements.
+**
+**  Each out-of-place engine also turns a band of columns alone (the *Columns
+**  functions), so that the threads of ctThread.c can share a matrix.
+**
+**  ctStreamCopy (ctStream.c) measures the copy bandwidth the corner turn
+**  is reported against.
+**
+******************************************************************************/
+
+#ifndef CT_H_
+#define CT_H_
+
+/* Cache sizes, in bytes, used when /sys does not give them; 0 is unknown. */
+#ifndef CT_L1_BYTES
+#define CT_L1_BYTES 0
+#endif
+#ifndef CT_L2_BYTES
+#define CT_L2_BYTES 0
+#endif
+
+/*
+  The number of threads the corner turn runs on; 0 is one per online
+  processor.  Set with "make THREADS=n".
+*/
+#ifndef CT_THREADS
+#define CT_THREADS 0
+#endif
+
+/*
+  Pin each thread to the processors of one NUMA node, spreading the
+  threads evenly over the nodes.  Set with "make PIN=1".
+*/
+#ifndef CT_PIN
+#define CT_PIN 0
+#endif
+
+/* The NUMA nodes and processors looked for in /sys. */
+#ifndef CT_NODE_DIR
+#define CT_NODE_DIR "/sys/devices/system/node"
+#endif
+#define CT_MAX_NODES 64
+#define CT_MAX_CPUS 1024
+
+/* The cache geometry is read from here (Linux). */
+#ifndef CT_CACHE_DIR
+#define CT_CACHE_DIR "/sys/devices/system/cpu/cpu0/cache"
+#endif
+
+/* The largest L1 tile edge, in elements. */
+#define CT_L1_TILE_MAX 256
+
+/* The tile edge, in elements, when the L1 size is unknown. */
+#define CT_TILE_DEFAULT 32
+
+/* The cache line, in bytes, that the streaming engine fills at a time. */
+#ifndef CT_LINE_BYTES
+#define CT_LINE_BYTES 64
+#endif
+
+/* The recursive engine transposes blocks of at most this many elements. */
+#define CT_RECURSIVE_BASE 1024
+
+/* The chunks the columns of the MPI corner turn (ctMpi.c) are exchanged in. */
+#ifndef CT_MPI_CHUNKS
+#define CT_MPI_CHUNKS 4
+#endif
+
+/*
+  The prefetch distances, in register tiles of rows, ct tries for the
+  streaming engine before timing it.
+*/
+#define CT_PREFETCH_TRIES {0, 1, 2, 4}
+
+/*
+  The out-of-core corner turn (ctOutOfCore.c): the tile buffers of its
+  pipeline, the most bytes of each, and its tile edge in elements; 0 is
+  the fastest of the edges that fit, found on the first bands of rows.
+*/
+#define CT_OOC_SLOTS 3
+#ifndef CT_OOC_BYTES
+#define CT_OOC_BYTES (16UL * 1024 * 1024)
+#endif
+#ifndef CT_OOC_TILE
+#define CT_OOC_TILE 0
+#endif
+
+/* The most dimensions ctPermute takes. */
+#define CT_PERMUTE_MAX_DIMS 8
+
+/* STREAM copy: the best of this many runs is reported. */
+#define CT_STREAM_TRIALS 10
+
+/*
+  The largest STREAM copy, in bytes per array.  Larger matrices are
+  compared with a copy of this size, already far beyond the caches, so
+  that the comparison does not need three times the matrix in memory.
+*/
+#ifndef CT_STREAM_MAX_BYTES
+#define CT_STREAM_MAX_BYTES (64UL * 1024 * 1024)
+#endif
+
+void ct(int numrows, int numcols, float *in, float *out);
+void ctNaive(int numrows, int numcols, float *in, float *out);
+void ctTiled(int numrows, int numcols, float *in, float *out);
+void ctRecursive(int numrows, int numcols, float *in, float *out);
+void ctTiledStream(int numrows, int numcols, float *in, float *out);
+
+/* Turn columns c0 to c1-1 of 'in' into rows c0 to c1-1 of 'out'. */
+void ctNaiveColumns(int numrows, int numcols, float *in, float *out, int c0, int c1);
+void ctTiledColumns(int numrows, int numcols, float *in, float *out, int c0, int c1);
+void ctRecursiveColumns(int numrows, int numcols, float *in, float *out, int c0, int c1);
+void ctTiledStreamColumns(int numrows, int numcols, float *in, float *out, int c0, int c1);
+
+/*
+  The same for 2 byte elements, the bits of fp16 or bf16 values (see
+  PcaCHalf.h).
+*/
+void ctTiledHalfColumns(int numrows, int numcols, unsigned short *in, unsigned short *out,
+                        int c0, int c1);
+
+/* The rows ahead ctTiledStream prefetches its input; 0 is none. */
+void ctSetPrefetch(int rows);
+
+/* Turn the numrows x numcols matrix 'data' into its numcols x numrows transpose. */
+void ctInPlace(int numrows, int numcols, float *data);
+
+/*
+  Turn the matrix file 'inFile' into 'outFile' without loading it; returns
+  the seconds taken, to the output on disk, the tile used and the bytes
+  read and written.
+*/
+double ctOutOfCore(const char *inFile, const char *outFile, int *tileRows, int *tileCols,
+                   double *bytes);
+
+/*
+  Permute the ndims-dimensional array 'in', of elements of elemBytes, into
+  'out', whose dimension k is dimension order[k] of 'in'.
+*/
+void ctPermute(int ndims, const int *dims, const int *order, int elemBytes,
+               const void *in, void *out);
+
+/* Tile edges, in elements; 0 when the geometry is unknown. */
+void ctTileSizes(int *l1Tile, int *l2Tile);
+int  ctTileElements(int elemBytes);
+
+/* Transpose a rows x cols block of floats between rows of any stride. */
+void ctTransposeFloats(int rows, int cols, float *in, long inStride,
+                       float *out, long outStride);
+
+/*
+  A job run by every thread of the pool (ctThread.c): 'thread' is 0 to
+  numThreads-1, and the caller of ctThreadRun() is thread 0.
+*/
+typedef void (*ctJob)(void *arg, int thread, int numThreads);
+
+int    ctThreadProcessors(int numThreads);
+void   ctThreadStart(int numThreads);
+void   ctThreadRun(ctJob job, void *arg);
+int    ctThreadNodes(void);
+int    ctThreadNode(void);
+double ctThreadSeconds(void);
+void   ctThreadStop(void);
+
+/* Bytes per second of a STREAM copy of 'bytes' bytes. */
+double ctStreamCopy(unsigned long bytes);
+
+/* The peak resident memory of the process so far, in kilobytes. */
+long ctPeakKilobytes(void);
+
+#endif
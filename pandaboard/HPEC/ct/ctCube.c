@@ -0,0 +1,132 @@
+/******************************************************************************
+** File: ctCube.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The data cube corner turn: a real or complex array of two or three
+**  dimensions (a vector is read as a one column matrix) is permuted into any order of its dimensions (ctPermute.c).
+**
+** Input/Output:
+**  The input cube is stored in file 
+**                  "./data/<dataSetNum>-ct-incube.dat".
+**  The output cube will be stored in file 
+**                  "./data/<dataSetNum>-ct-outcube.dat".
+**  The total run time will be stored in file 
+**                  "./data/<dataSetNum>-ct-cubetiming.dat".
+**
+** Command:
+**   ctCube <data set num> <order>
+**
+**  <order> gives, for each output dimension, the input dimension it is:
+**  for a beam x pulse x range cube, 021 gives beam x range x pulse.
+**
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "PcaCArray.h"
+#include "PcaCTimer.h"
+#include "ct.h"
+
+/*
+  ctCubeOrder reads the digits of 'text' into order[], and returns 1 if
+  they are a permutation of 0 to ndims-1.
+*/
+static int ctCubeOrder(const char *text, int ndims, int *order)
+{
+  int k, seen = 0;
+
+  if ((int)strlen(text) != ndims)
+    return 0;
+  for (k = 0; k < ndims; k++) {
+    order[k] = text[k] - '0';
+    if (order[k] < 0 || order[k] >= ndims || (seen & (1 << order[k])))
+      return 0;
+    seen |= 1 << order[k];
+  }
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  PcaCArrayFloat incube, outcube, rtime;
+  pca_timer_t    timer;
+  char           incubefile[100], outcubefile[100], timefile[100];
+  int            dims[3], order[3], k, elemBytes;
+  double         bytes, bandwidth, streamBandwidth;
+
+  if (argc != 3) {
+    printf("Usage: %s <data set num> <order>\n", argv[0]);
+    return -1;
+  }
+
+  /* Build the input file names */
+  sprintf(incubefile, "./data/%s-ct-incube.dat", argv[1]);
+  sprintf(outcubefile, "./data/%s-ct-outcube.dat", argv[1]);
+  sprintf(timefile, "./data/%s-ct-cubetiming.dat", argv[1]);
+
+  /* Read the input cube from file */
+  readFromFile(float, incubefile, incube);
+
+  if (!ctCubeOrder(argv[2], incube.ndims, order)) {
+    printf("%s: the order must be a permutation of the digits 0 to %d\n",
+           argv[0], incube.ndims - 1);
+    return -1;
+  }
+  for (k = 0; k < (int)incube.ndims; k++)
+    dims[k] = incube.size[k];
+  elemBytes = incube.rctype * sizeof(float);
+
+  /* Allocate memory for output cube and run time */
+  if (incube.ndims == 2) {
+    pca_create_carray_2d(float, outcube, dims[order[0]], dims[order[1]], incube.rctype);
+  }
+  else {
+    pca_create_carray_3d(float, outcube, dims[order[0]], dims[order[1]], dims[order[2]],
+                         incube.rctype);
+  }
+  pca_create_carray_1d(float, rtime, 1, PCA_REAL);
+
+  /* Find the tile size outside the timed region */
+  ctTileElements(elemBytes);
+
+  /* Run the cube corner turn */
+  timer = startTimer();
+  ctPermute(incube.ndims, dims, order, elemBytes, incube.data, outcube.data);
+  rtime.data[0] = stopTimer(timer); /* time is in second  */
+
+#ifdef VERBOSE
+  printf("Time: %f sec\n", rtime.data[0]);
+  printf("Tile: %d x %d elements of %d bytes\n", ctTileElements(elemBytes),
+         ctTileElements(elemBytes), elemBytes);
+#endif
+  printf("Done.  Latency: %f s.\n", rtime.data[0]);
+
+  /* Every element is read and written once, as in a copy */
+  for (k = 0, bytes = elemBytes; k < (int)incube.ndims; k++)
+    bytes *= dims[k];
+  streamBandwidth = ctStreamCopy((unsigned long)bytes);
+  if (rtime.data[0] > 0) {
+    bandwidth = 2.0 * bytes / rtime.data[0];
+    printf("Bandwidth: %.1f MB/s, %.1f%% of STREAM copy (%.1f MB/s).\n",
+           bandwidth / 1e6, 100.0 * bandwidth / streamBandwidth, streamBandwidth / 1e6);
+  }
+  else {
+    printf("Bandwidth: too fast to time; STREAM copy %.1f MB/s.\n",
+           streamBandwidth / 1e6);
+  }
+
+  /* Write the run time and output cube to file */
+  writeToFile(float, timefile, rtime);
+  writeToFile(float, outcubefile, outcube);
+
+  /* Clean the memory */
+  clean_mem(float, rtime);
+  clean_mem(float, outcube);
+  clean_mem(float, incube);
+
+  return 0;
+}
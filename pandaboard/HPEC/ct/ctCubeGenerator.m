@@ -0,0 +1,51 @@
+function ctCubeGenerator(DataSetNum, Dims, IsComplex)
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+% File: ctCubeGenerator.m
+%
+% HPEC Challenge Benchmark Suite
+% Corner Turn Data Cube Generator Matlab Function 
+%
+% function ctCubeGenerator(DataSetNum, Dims, IsComplex)
+%   
+%   Generates a random data cube for the data cube corner turn (ctCube)
+%
+%   Input(s):
+%     Dims      - the size of each dimension, e.g. [NumBeams NumPulses NumRanges]
+%     IsComplex - 1 for a complex cube, 0 for a real one
+%
+%   Output(s):
+%     Files: 
+%       ./data/<DataSetNum>-ct-incube.dat - the randomly generated cube
+%
+%   ctCubeVerify checks the output against the input cube itself, so no
+%   truth cube is written.
+%
+
+% build the file name
+InFileName = ['./data/' num2str(DataSetNum) '-ct-incube.dat'];
+
+% Check if the data set already exists
+if(exist(InFileName, 'file'))
+  ret = input('Files for this data set number exist.  Would you like to overwrite them? (y/n) ', 's');
+  if ~strcmpi(ret, 'y')
+    disp('Exiting');
+    return;
+  end 
+end 
+
+disp(['Generating test cube of size ' num2str(Dims)]);
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+oldPath = path;
+addpath('../matlab');
+cube = rand(Dims);
+if IsComplex
+  cube = complex(cube, rand(Dims));
+end
+writeFile(InFileName, cube, 'float32');
+path(oldPath);
+
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+
+disp(['Test cube is stored in file ' InFileName]);
@@ -0,0 +1,98 @@
+/******************************************************************************
+** File: ctCubeVerify.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The verifier of the data cube corner turn.  Every element of the
+**  output cube is compared with the element of the input cube it must be,
+**  found one index at a time, so no truth cube is needed.
+**
+** Input/Output:
+**  The input cube is stored in file 
+**              "./data/<dataSetNum>-ct-incube.dat".
+**  The output cube is stored in file 
+**              "./data/<dataSetNum>-ct-outcube.dat".
+**
+** Command:
+**   ctCubeVerify <data set num> <order>
+**
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "PcaCArray.h"
+
+int verify(PcaCArrayFloat *in, PcaCArrayFloat *out, const char *orderText)
+{
+  unsigned int ndims = in->ndims;
+  unsigned int k, c, seen = 0;
+  unsigned int order[3], index[3], inStride[3];
+  unsigned long i, total = 1, rest, inOffset;
+
+  /* Check the order, and that the output has the permuted dimensions */
+  if (strlen(orderText) != ndims || out->ndims != ndims || out->rctype != in->rctype) {
+#ifdef VERBOSE
+    printf("Error: the order or the output dimensions do not match the input");
+#endif
+    return 0;
+  }
+  for (k = 0; k < ndims; k++) {
+    order[k] = orderText[k] - '0';
+    if (order[k] >= ndims || (seen & (1 << order[k])) || out->size[k] != in->size[order[k]])
+      return 0;
+    seen |= 1 << order[k];
+    total *= out->size[k];
+  }
+
+  inStride[ndims - 1] = 1;
+  for (k = ndims - 1; k > 0; k--)
+    inStride[k - 1] = inStride[k] * in->size[k];
+
+  for (i = 0; i < total; i++) {
+    rest     = i;
+    inOffset = 0;
+    for (k = ndims; k > 0; k--) {
+      index[k - 1] = rest % out->size[k - 1];
+      rest        /= out->size[k - 1];
+      inOffset    += index[k - 1] * inStride[order[k - 1]];
+    }
+    for (c = 0; c < in->rctype; c++) {
+      if (out->data[i * in->rctype + c] != in->data[inOffset * in->rctype + c])
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  PcaCArrayFloat incube, outcube;
+  char           incubefile[100], outcubefile[100];
+
+  if (argc != 3) {
+    printf("Usage: %s <data set num> <order>\n", argv[0]);
+    return -1;
+  }
+
+  /* Build the input file names */
+  sprintf(incubefile, "./data/%s-ct-incube.dat", argv[1]);
+  sprintf(outcubefile, "./data/%s-ct-outcube.dat", argv[1]);
+
+  /* Read the input and output cubes from file */
+  readFromFile(float, incubefile, incube);
+  readFromFile(float, outcubefile, outcube);
+
+  /* Run the verifier */
+  printf("Verification: ");
+  if (verify(&incube, &outcube, argv[2])) {
+    printf("PASS\n");
+  }
+  else {
+    printf("FAIL\n");
+  }
+
+  return 0;
+}
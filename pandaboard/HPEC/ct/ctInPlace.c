@@ -0,0 +1,66 @@
+/******************************************************************************
+** File: ctInPlace.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The in-place corner turn, for matrices that do not fit in memory
+**  twice.
+**
+**  Stored row by row, element k = i*numcols + j of the numrows x numcols
+**  matrix belongs at j*numrows + i of its transpose, which is k*numrows
+**  modulo numrows*numcols-1 (the first and last elements stay put).  The
+**  moves form disjoint cycles; ctInPlace follows each one, carrying one
+**  element at a time to where it belongs, and marks every place it fills
+**  in a bit vector so that no cycle is followed twice.  The bit vector is
+**  1/32 the size of the matrix.
+**
+**  The cycles jump across the whole matrix, so this is much slower than
+**  the out-of-place engines; it runs on one thread.
+**
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ct.h"
+
+#define CT_BITS (8 * sizeof(unsigned long))
+
+void ctInPlace(int numrows, int numcols, float *data)
+{
+  unsigned long  rows = numrows, cols = numcols;
+  unsigned long  last = rows * cols - 1;
+  unsigned long  start, cur, quotient;
+  unsigned long *visited;
+  float          carried, displaced;
+
+  if (rows <= 1 || cols <= 1)
+    return;
+
+  visited = (unsigned long *)calloc(last / CT_BITS + 1, sizeof(unsigned long));
+  if (visited == NULL) {
+    printf("ctInPlace: out of memory\n");
+    exit(-1);
+  }
+
+  for (start = 1; start < last; start++) {
+    if (visited[start / CT_BITS] & (1UL << (start % CT_BITS)))
+      continue;
+
+    /* Element cur = i*cols + j moves to j*rows + i */
+    carried = data[start];
+    cur     = start;
+    do {
+      quotient  = cur / cols;
+      cur       = (cur - quotient * cols) * rows + quotient;
+      displaced = data[cur];
+      data[cur] = carried;
+      carried   = displaced;
+      visited[cur / CT_BITS] |= 1UL << (cur % CT_BITS);
+    } while (cur != start);
+  }
+
+  free(visited);
+}
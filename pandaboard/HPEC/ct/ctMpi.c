@@ -0,0 +1,290 @@
+/******************************************************************************
+** File: ctMpi.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The distributed corner turn over MPI.  Each rank owns a block of rows
+**  of the input matrix, and owns the same block of rows of the output,
+**  that is of columns of the input: the corner turn is an all-to-all.
+**
+**  Each rank transposes, in L1 tiles of register tiles (ctTile.c), the
+**  part of its rows that every other rank owns, into one send buffer,
+**  and MPI_Alltoallv() delivers the parts; each received part is copied
+**  into its place in the rank's output rows.  The columns are exchanged
+**  in CT_MPI_CHUNKS chunks: while one chunk is in flight, with the
+**  non-blocking MPI_Ialltoallv() of MPI 3, the next is transposed and
+**  the one before copied out, so the local work overlaps communication.
+**  With an older MPI the chunks are exchanged with MPI_Alltoallv().
+**
+**  Rank 0 reads the input and writes the output; they are scattered and
+**  gathered outside the timed region.  After the run rank 0 prints the
+**  bisection bandwidth: the bytes that cross between the first and the
+**  second half of the ranks over the time of the slowest rank.
+**
+** Input/Output:
+**  The input matrix is stored in file 
+**                  "./data/<dataSetNum>-ct-inmatrix.dat".
+**  The output matrix will be stored in file 
+**                  "./data/<dataSetNum>-ct-outmatrix.dat".
+**  The total run time will be stored in file 
+**                  "./data/<dataSetNum>-ct-timing.dat".
+**
+** Command:
+**   mpirun -np <ranks> ctMpi <data set num>
+**
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+
+#include "PcaCArray.h"
+#include "ct.h"
+
+/* The first of the 'count' items owned by rank r of 'ranks': block distribution. */
+#define CT_MPI_FIRST(count, r, ranks) ((int)(((double)(count) * (r)) / (ranks)))
+
+/* The columns a rank is sent, and the rows it sends, in one chunk. */
+struct ctMpiChunk {
+  int *sendCounts, *sendDispls;
+  int *recvCounts, *recvDispls;
+  int *colFirst;   /* first column of the chunk in each rank's block */
+  int *colCount;
+};
+
+/*
+  ctMpiPack transposes, for every destination rank, columns colFirst[d] to
+  colFirst[d]+colCount[d]-1 of the rank's 'rows' rows into 'send', one
+  part after another, each part colCount[d] x rows.
+*/
+static void ctMpiPack(int rows, int numcols, float *in, struct ctMpiChunk *chunk,
+                      int ranks, float *send)
+{
+  int d, i, j, ei, ej, tile = ctTileElements(sizeof(float));
+  float *part;
+
+  for (d = 0; d < ranks; d++) {
+    part = send + chunk->sendDispls[d];
+    for (i = 0; i < rows; i += tile) {
+      ei = i + tile < rows ? tile : rows - i;
+      for (j = 0; j < chunk->colCount[d]; j += tile) {
+        ej = j + tile < chunk->colCount[d] ? tile : chunk->colCount[d] - j;
+        ctTransposeFloats(ei, ej, in + (long)i * numcols + chunk->colFirst[d] + j,
+                          numcols, part + (long)j * rows + i, rows);
+      }
+    }
+  }
+}
+
+/*
+  ctMpiUnpack copies the part received from each source rank, rows of the
+  chunk's columns, into those rows of 'out' (the rank's output rows, each
+  numrows long), at the source's first row.
+*/
+static void ctMpiUnpack(int numrows, struct ctMpiChunk *chunk, int rank, int ranks,
+                        float *recv, float *out, int colBase)
+{
+  int s, j, rows, first = chunk->colFirst[rank] - colBase;
+
+  for (s = 0; s < ranks; s++) {
+    rows = CT_MPI_FIRST(numrows, s + 1, ranks) - CT_MPI_FIRST(numrows, s, ranks);
+    for (j = 0; j < chunk->colCount[rank]; j++)
+      memcpy(out + (long)(first + j) * numrows + CT_MPI_FIRST(numrows, s, ranks),
+             recv + chunk->recvDispls[s] + (long)j * rows, rows * sizeof(float));
+  }
+}
+
+static void ctMpiChunkSetup(struct ctMpiChunk *chunk, int k, int numrows, int numcols,
+                            int rank, int ranks)
+{
+  int d, c0, c1, myRows;
+
+  chunk->sendCounts = (int *)malloc(6 * ranks * sizeof(int));
+  if (chunk->sendCounts == NULL) {
+    printf("ctMpiChunkSetup: out of memory\n");
+    MPI_Abort(MPI_COMM_WORLD, -1);
+  }
+  chunk->sendDispls = chunk->sendCounts + ranks;
+  chunk->recvCounts = chunk->sendCounts + 2 * ranks;
+  chunk->recvDispls = chunk->sendCounts + 3 * ranks;
+  chunk->colFirst   = chunk->sendCounts + 4 * ranks;
+  chunk->colCount   = chunk->sendCounts + 5 * ranks;
+
+  myRows = CT_MPI_FIRST(numrows, rank + 1, ranks) - CT_MPI_FIRST(numrows, rank, ranks);
+  for (d = 0; d < ranks; d++) {
+    c0 = CT_MPI_FIRST(numcols, d, ranks);
+    c1 = CT_MPI_FIRST(numcols, d + 1, ranks);
+    chunk->colFirst[d] = c0 + CT_MPI_FIRST(c1 - c0, k, CT_MPI_CHUNKS);
+    chunk->colCount[d] = c0 + CT_MPI_FIRST(c1 - c0, k + 1, CT_MPI_CHUNKS) - chunk->colFirst[d];
+    chunk->sendCounts[d] = myRows * chunk->colCount[d];
+    chunk->sendDispls[d] = d == 0 ? 0 : chunk->sendDispls[d - 1] + chunk->sendCounts[d - 1];
+  }
+  for (d = 0; d < ranks; d++) {
+    chunk->recvCounts[d] = (CT_MPI_FIRST(numrows, d + 1, ranks) - CT_MPI_FIRST(numrows, d, ranks))
+      * chunk->colCount[rank];
+    chunk->recvDispls[d] = d == 0 ? 0 : chunk->recvDispls[d - 1] + chunk->recvCounts[d - 1];
+  }
+}
+
+int main(int argc, char **argv)
+{
+  PcaCArrayFloat     inmatrix, outmatrix, rtime;
+  char               inmatrixfile[100], outmatrixfile[100], timefile[100];
+  int                rank, ranks, dims[2], k, d, s, myRows, myCols, myRow0, myCol0;
+  int                sendMax = 0, recvMax = 0, count, *counts, *displs;
+  float             *in, *out, *send[2], *recv[2];
+  struct ctMpiChunk  chunks[CT_MPI_CHUNKS];
+  double             start, seconds, slowest, bisection, offRank;
+#if MPI_VERSION >= 3
+  MPI_Request        request[2];
+#endif
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+  if (argc != 2) {
+    if (rank == 0)
+      printf("Usage: mpirun -np <ranks> %s <data set num>\n", argv[0]);
+    MPI_Finalize();
+    return -1;
+  }
+
+  /* Build the input file names */
+  sprintf(inmatrixfile, "./data/%s-ct-inmatrix.dat", argv[1]);
+  sprintf(outmatrixfile, "./data/%s-ct-outmatrix.dat", argv[1]);
+  sprintf(timefile, "./data/%s-ct-timing.dat", argv[1]);
+
+  /* Rank 0 reads the input matrix from file */
+  if (rank == 0) {
+    readFromFile(float, inmatrixfile, inmatrix);
+    dims[0] = inmatrix.size[0];
+    dims[1] = inmatrix.size[1];
+  }
+  MPI_Bcast(dims, 2, MPI_INT, 0, MPI_COMM_WORLD);
+
+  myRow0 = CT_MPI_FIRST(dims[0], rank, ranks);
+  myRows = CT_MPI_FIRST(dims[0], rank + 1, ranks) - myRow0;
+  myCol0 = CT_MPI_FIRST(dims[1], rank, ranks);
+  myCols = CT_MPI_FIRST(dims[1], rank + 1, ranks) - myCol0;
+
+  /* The exchange of each chunk, and buffers for two chunks in flight */
+  for (k = 0; k < CT_MPI_CHUNKS; k++) {
+    ctMpiChunkSetup(&chunks[k], k, dims[0], dims[1], rank, ranks);
+    count = chunks[k].sendDispls[ranks - 1] + chunks[k].sendCounts[ranks - 1];
+    sendMax = count > sendMax ? count : sendMax;
+    count = chunks[k].recvDispls[ranks - 1] + chunks[k].recvCounts[ranks - 1];
+    recvMax = count > recvMax ? count : recvMax;
+  }
+  in      = (float *)malloc(((long)myRows * dims[1] + 1) * sizeof(float));
+  out     = (float *)malloc(((long)myCols * dims[0] + 1) * sizeof(float));
+  send[0] = (float *)malloc((2L * sendMax + 1) * sizeof(float));
+  recv[0] = (float *)malloc((2L * recvMax + 1) * sizeof(float));
+  counts  = (int *)malloc(2 * ranks * sizeof(int));
+  if (in == NULL || out == NULL || send[0] == NULL || recv[0] == NULL || counts == NULL) {
+    printf("ctMpi: rank %d out of memory\n", rank);
+    MPI_Abort(MPI_COMM_WORLD, -1);
+  }
+  send[1] = send[0] + sendMax;
+  recv[1] = recv[0] + recvMax;
+  displs  = counts + ranks;
+
+  /* Scatter the row blocks, and touch every buffer, before timing */
+  for (d = 0; d < ranks; d++) {
+    counts[d] = (CT_MPI_FIRST(dims[0], d + 1, ranks) - CT_MPI_FIRST(dims[0], d, ranks)) * dims[1];
+    displs[d] = CT_MPI_FIRST(dims[0], d, ranks) * dims[1];
+  }
+  MPI_Scatterv(rank == 0 ? inmatrix.data : NULL, counts, displs, MPI_FLOAT,
+               in, myRows * dims[1], MPI_FLOAT, 0, MPI_COMM_WORLD);
+  memset(out, 0, ((long)myCols * dims[0] + 1) * sizeof(float));
+  memset(send[0], 0, (2L * sendMax + 1) * sizeof(float));
+  memset(recv[0], 0, (2L * recvMax + 1) * sizeof(float));
+  ctTileElements(sizeof(float));
+
+  /* Run the distributed corner turn */
+  MPI_Barrier(MPI_COMM_WORLD);
+  start = MPI_Wtime();
+
+#if MPI_VERSION >= 3
+  for (k = 0; k < CT_MPI_CHUNKS; k++) {
+    ctMpiPack(myRows, dims[1], in, &chunks[k], ranks, send[k % 2]);
+    if (k > 0)
+      MPI_Wait(&request[(k - 1) % 2], MPI_STATUS_IGNORE);
+    MPI_Ialltoallv(send[k % 2], chunks[k].sendCounts, chunks[k].sendDispls, MPI_FLOAT,
+                   recv[k % 2], chunks[k].recvCounts, chunks[k].recvDispls, MPI_FLOAT,
+                   MPI_COMM_WORLD, &request[k % 2]);
+    if (k > 0)
+      ctMpiUnpack(dims[0], &chunks[k - 1], rank, ranks, recv[(k - 1) % 2], out, myCol0);
+  }
+  MPI_Wait(&request[(CT_MPI_CHUNKS - 1) % 2], MPI_STATUS_IGNORE);
+  ctMpiUnpack(dims[0], &chunks[CT_MPI_CHUNKS - 1], rank, ranks,
+              recv[(CT_MPI_CHUNKS - 1) % 2], out, myCol0);
+#else
+  for (k = 0; k < CT_MPI_CHUNKS; k++) {
+    ctMpiPack(myRows, dims[1], in, &chunks[k], ranks, send[0]);
+    MPI_Alltoallv(send[0], chunks[k].sendCounts, chunks[k].sendDispls, MPI_FLOAT,
+                  recv[0], chunks[k].recvCounts, chunks[k].recvDispls, MPI_FLOAT,
+                  MPI_COMM_WORLD);
+    ctMpiUnpack(dims[0], &chunks[k], rank, ranks, recv[0], out, myCol0);
+  }
+#endif
+
+  seconds = MPI_Wtime() - start;
+  MPI_Reduce(&seconds, &slowest, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+  /* Gather the output row blocks on rank 0 */
+  for (d = 0; d < ranks; d++) {
+    counts[d] = (CT_MPI_FIRST(dims[1], d + 1, ranks) - CT_MPI_FIRST(dims[1], d, ranks)) * dims[0];
+    displs[d] = CT_MPI_FIRST(dims[1], d, ranks) * dims[0];
+  }
+  if (rank == 0) {
+    pca_create_carray_2d(float, outmatrix, dims[1], dims[0], PCA_REAL);
+  }
+  MPI_Gatherv(out, myCols * dims[0], MPI_FLOAT, rank == 0 ? outmatrix.data : NULL,
+              counts, displs, MPI_FLOAT, 0, MPI_COMM_WORLD);
+
+  if (rank == 0) {
+    /* The bytes between the halves of the ranks, and between any two ranks */
+    bisection = offRank = 0.0;
+    for (s = 0; s < ranks; s++) {
+      for (d = 0; d < ranks; d++) {
+        double bytes = sizeof(float) *
+          (double)(CT_MPI_FIRST(dims[0], s + 1, ranks) - CT_MPI_FIRST(dims[0], s, ranks)) *
+          (CT_MPI_FIRST(dims[1], d + 1, ranks) - CT_MPI_FIRST(dims[1], d, ranks));
+        if (s != d)
+          offRank += bytes;
+        if ((s < ranks / 2) != (d < ranks / 2))
+          bisection += bytes;
+      }
+    }
+
+    pca_create_carray_1d(float, rtime, 1, PCA_REAL);
+    rtime.data[0] = slowest;
+    printf("Done.  Latency: %f s.\n", slowest);
+    if (slowest > 0 && ranks > 1)
+      printf("Bisection bandwidth: %.1f MB/s; all-to-all %.1f MB/s, %d ranks, %d chunks.\n",
+             bisection / slowest / 1e6, offRank / slowest / 1e6, ranks, CT_MPI_CHUNKS);
+
+    /* Write the run time and output matrix to file */
+    writeToFile(float, timefile, rtime);
+    writeToFile(float, outmatrixfile, outmatrix);
+
+    clean_mem(float, rtime);
+    clean_mem(float, outmatrix);
+    clean_mem(float, inmatrix);
+  }
+
+  for (k = 0; k < CT_MPI_CHUNKS; k++)
+    free(chunks[k].sendCounts);
+  free(in);
+  free(out);
+  free(send[0]);
+  free(recv[0]);
+  free(counts);
+
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,372 @@
+/******************************************************************************
+** File: ctOutOfCore.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The out-of-core corner turn, for matrices larger than memory.  The
+**  input file is never loaded: the matrix is taken in tiles, each read
+**  with pread() (one read per tile row), transposed in memory by the tiled
+**  engine, and written with pwrite() (one write per tile column) into its
+**  place in the output file.  Three threads form a pipeline over
+**  CT_OOC_SLOTS tile buffers: one reads tile i+1 while the caller
+**  transposes tile i and another writes tile i-1.
+**
+**  The matrix is cut into bands of rows, each into tiles across its
+**  columns; a tile has the area of a square of edge E, and is as square
+**  as the matrix allows.  Unless CT_OOC_TILE gives E, the first bands
+**  are turned with each of the edges of ctOocEdges[] in turn, the
+**  pipeline emptied after each, and the rest with the edge that moved the
+**  most bytes per second.  No work is repeated for the tuning.
+**
+**  The files are in the PcaCArray format, real and in the byte order of
+**  the machine.  Its 20 byte header leaves the elements unaligned to disk
+**  blocks, so O_DIRECT cannot be used; instead the output is flushed with
+**  fdatasync() before the clock stops, so that the time is disk to disk.
+**
+******************************************************************************/
+
+#define _XOPEN_SOURCE 600
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "PcaCArray.h"
+#include "ct.h"
+
+/* The bytes before the elements: indicator, version, ndims and two sizes. */
+#define CT_OOC_HEADER (5 * sizeof(uint32))
+
+/* The tile edges tried, smallest first. */
+static const int ctOocEdges[] = {256, 512, 1024, 2048, 4096};
+#define CT_OOC_EDGES ((int)(sizeof(ctOocEdges) / sizeof(ctOocEdges[0])))
+
+enum ctOocState {CT_OOC_FREE, CT_OOC_READ, CT_OOC_TURNED};
+
+struct ctOocSlot {
+  int    state;
+  int    r0, rows, c0, cols;  /* the tile */
+  int    band, lastInBand;
+  float *in, *out;
+};
+
+struct ctOoc {
+  int              inFile, outFile;
+  int              numrows, numcols;
+  struct ctOocSlot slots[CT_OOC_SLOTS];
+  pthread_mutex_t  lock;
+  pthread_cond_t   changed;
+  int              tiles;         /* tiles read so far */
+  int              done;          /* the reader has read the last tile */
+  int              bandsWritten;
+  int              edges;         /* the edges tried; 0 if none */
+  double           bandStart[CT_OOC_EDGES], bandEnd[CT_OOC_EDGES];
+  double           bandBytes[CT_OOC_EDGES];
+  int              edge;          /* the edge of the bands after the tuning */
+};
+
+/* ctOocRead reads 'bytes' at 'offset', or stops the kernel. */
+static void ctOocRead(int file, void *data, size_t bytes, off_t offset)
+{
+  ssize_t got;
+
+  while (bytes > 0) {
+    got = pread(file, data, bytes, offset);
+    if (got <= 0) {
+      if (got < 0 && errno == EINTR)
+        continue;
+      printf("ctOutOfCore: cannot read the input at %ld\n", (long)offset);
+      exit(-1);
+    }
+    data    = (char *)data + got;
+    bytes  -= got;
+    offset += got;
+  }
+}
+
+/* ctOocWrite writes 'bytes' at 'offset', or stops the kernel. */
+static void ctOocWrite(int file, const void *data, size_t bytes, off_t offset)
+{
+  ssize_t put;
+
+  while (bytes > 0) {
+    put = pwrite(file, data, bytes, offset);
+    if (put <= 0) {
+      if (put < 0 && errno == EINTR)
+        continue;
+      printf("ctOutOfCore: cannot write the output at %ld\n", (long)offset);
+      exit(-1);
+    }
+    data    = (const char *)data + put;
+    bytes  -= put;
+    offset += put;
+  }
+}
+
+/* The tile of a band of 'rows' rows, for edge 'edge': about edge * edge elements. */
+static int ctOocTileCols(struct ctOoc *ooc, int edge, int rows)
+{
+  long cols = (long)edge * edge / rows;
+
+  if (cols < edge)
+    cols = edge;
+  return cols < ooc->numcols ? (int)cols : ooc->numcols;
+}
+
+/* ctOocBest returns the edge of the fastest of the first 'bands' bands. */
+static int ctOocBest(struct ctOoc *ooc, int bands)
+{
+  int    band, best = 0;
+  double rate, bestRate = 0.0;
+
+  for (band = 0; band < bands; band++) {
+    rate = ooc->bandBytes[band] / (ooc->bandEnd[band] - ooc->bandStart[band] + 1e-9);
+#ifdef VERBOSE
+    printf("Out of core: edge %d, %.1f MB/s\n", ctOocEdges[band], rate / 1e6);
+#endif
+    if (rate > bestRate) {
+      best     = band;
+      bestRate = rate;
+    }
+  }
+  return ctOocEdges[best];
+}
+
+/* ctOocDrain waits until the first 'bands' bands are written. */
+static void ctOocDrain(struct ctOoc *ooc, int bands)
+{
+  pthread_mutex_lock(&ooc->lock);
+  while (ooc->bandsWritten < bands)
+    pthread_cond_wait(&ooc->changed, &ooc->lock);
+  pthread_mutex_unlock(&ooc->lock);
+}
+
+/*
+  ctOocReader reads the tiles, band after band, into the slots in turn.
+  While tuning, it waits for each band to be written before the next.
+*/
+static void *ctOocReader(void *arg)
+{
+  struct ctOoc     *ooc = (struct ctOoc *)arg;
+  struct ctOocSlot *slot;
+  int               band, r0, c0, rows, cols, edge, i;
+
+  for (r0 = 0, band = 0; r0 < ooc->numrows; r0 += rows, band++) {
+    if (band < ooc->edges) {
+      ctOocDrain(ooc, band);
+      edge = ctOocEdges[band];
+      ooc->bandStart[band] = ctThreadSeconds();
+    }
+    else {
+      if (band == ooc->edges && ooc->edges > 0) {
+        /* The tuning is over: keep the fastest edge */
+        ctOocDrain(ooc, band);
+        ooc->edge = ctOocBest(ooc, ooc->edges);
+      }
+      edge = ooc->edge;
+    }
+
+    rows = edge < ooc->numrows - r0 ? edge : ooc->numrows - r0;
+    cols = ctOocTileCols(ooc, edge, rows);
+    if (band < ooc->edges)
+      ooc->bandBytes[band] = 2.0 * rows * ooc->numcols * sizeof(float);
+
+    for (c0 = 0; c0 < ooc->numcols; c0 += cols) {
+      slot = &ooc->slots[ooc->tiles % CT_OOC_SLOTS];
+      pthread_mutex_lock(&ooc->lock);
+      while (slot->state != CT_OOC_FREE)
+        pthread_cond_wait(&ooc->changed, &ooc->lock);
+      pthread_mutex_unlock(&ooc->lock);
+
+      slot->r0         = r0;
+      slot->rows       = rows;
+      slot->c0         = c0;
+      slot->cols       = cols < ooc->numcols - c0 ? cols : ooc->numcols - c0;
+      slot->band       = band;
+      slot->lastInBand = c0 + cols >= ooc->numcols;
+      for (i = 0; i < rows; i++)
+        ctOocRead(ooc->inFile, slot->in + (long)i * slot->cols,
+                  slot->cols * sizeof(float),
+                  CT_OOC_HEADER + ((off_t)(r0 + i) * ooc->numcols + c0) * sizeof(float));
+
+      pthread_mutex_lock(&ooc->lock);
+      slot->state = CT_OOC_READ;
+      ooc->tiles++;
+      pthread_cond_broadcast(&ooc->changed);
+      pthread_mutex_unlock(&ooc->lock);
+    }
+  }
+
+  pthread_mutex_lock(&ooc->lock);
+  ooc->done = 1;
+  pthread_cond_broadcast(&ooc->changed);
+  pthread_mutex_unlock(&ooc->lock);
+  return NULL;
+}
+
+/*
+  ctOocNext waits until tile 'tile' is in state 'state', and returns its
+  slot, or NULL once the reader has read every tile and 'tile' is past
+  the last.
+*/
+static struct ctOocSlot *ctOocNext(struct ctOoc *ooc, int tile, int state)
+{
+  struct ctOocSlot *slot = &ooc->slots[tile % CT_OOC_SLOTS];
+
+  pthread_mutex_lock(&ooc->lock);
+  while (!(tile < ooc->tiles && slot->state == state) && !(ooc->done && tile >= ooc->tiles))
+    pthread_cond_wait(&ooc->changed, &ooc->lock);
+  if (tile >= ooc->tiles)
+    slot = NULL;
+  pthread_mutex_unlock(&ooc->lock);
+
+  return slot;
+}
+
+/* ctOocWriter writes each turned tile into its place in the output. */
+static void *ctOocWriter(void *arg)
+{
+  struct ctOoc     *ooc = (struct ctOoc *)arg;
+  struct ctOocSlot *slot;
+  int               tile, j;
+
+  for (tile = 0; (slot = ctOocNext(ooc, tile, CT_OOC_TURNED)) != NULL; tile++) {
+    for (j = 0; j < slot->cols; j++)
+      ctOocWrite(ooc->outFile, slot->out + (long)j * slot->rows, slot->rows * sizeof(float),
+                 CT_OOC_HEADER + ((off_t)(slot->c0 + j) * ooc->numrows + slot->r0) * sizeof(float));
+
+    pthread_mutex_lock(&ooc->lock);
+    if (slot->lastInBand) {
+      if (slot->band < ooc->edges)
+        ooc->bandEnd[slot->band] = ctThreadSeconds();
+      ooc->bandsWritten = slot->band + 1;
+    }
+    slot->state = CT_OOC_FREE;
+    pthread_cond_broadcast(&ooc->changed);
+    pthread_mutex_unlock(&ooc->lock);
+  }
+  return NULL;
+}
+
+/*
+  ctOutOfCore turns the matrix in 'inFile' into 'outFile', and returns
+  the seconds it took, with the tile of the bands after the tuning and
+  the bytes read and written.
+*/
+double ctOutOfCore(const char *inFile, const char *outFile, int *tileRows, int *tileCols,
+                   double *bytes)
+{
+  struct ctOoc ooc;
+  uint32       header[5];
+  pthread_t    reader, writer;
+  int          tile, k, l1Tile, l2Tile;
+  long         slotFloats;
+  double       start, seconds;
+  struct ctOocSlot *slot;
+
+  memset(&ooc, 0, sizeof(ooc));
+  if ((ooc.inFile = open(inFile, O_RDONLY)) < 0) {
+    printf("Failed opening: %s for reading\n", inFile);
+    exit(-1);
+  }
+  ctOocRead(ooc.inFile, header, sizeof(header), 0);
+  if (header[0] != EndianIndicator || header[1] >> 16 != Version || header[2] != 2 ||
+      (header[1] & ComplexIndicator)) {
+    printf("ctOutOfCore: %s is not a real matrix in the byte order of this machine\n", inFile);
+    exit(-1);
+  }
+  ooc.numrows = header[3];
+  ooc.numcols = header[4];
+
+  /* The output: its header, and its full length, before timing */
+  if ((ooc.outFile = open(outFile, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+    printf("Failed opening: %s for writing\n", outFile);
+    exit(-1);
+  }
+  header[1] = (Version << 16) + 1;
+  header[3] = ooc.numcols;
+  header[4] = ooc.numrows;
+  ctOocWrite(ooc.outFile, header, sizeof(header), 0);
+  if (ftruncate(ooc.outFile, CT_OOC_HEADER + (off_t)ooc.numrows * ooc.numcols * sizeof(float)) != 0) {
+    printf("ctOutOfCore: cannot size %s\n", outFile);
+    exit(-1);
+  }
+
+  /* The edges to try, and tile buffers for the largest */
+  ooc.edge = CT_OOC_TILE;
+  if (ooc.edge <= 0) {
+    for (k = 0; k < CT_OOC_EDGES; k++) {
+      if ((unsigned long)ctOocEdges[k] * ctOocEdges[k] * sizeof(float) <= CT_OOC_BYTES)
+        ooc.edges = k + 1;
+    }
+    if (ooc.edges == 0)
+      ooc.edges = 1;
+    ooc.edge = ctOocEdges[ooc.edges - 1];
+  }
+  slotFloats = (long)ooc.edge * ooc.edge;
+  if (slotFloats > (long)ooc.numrows * ooc.numcols)
+    slotFloats = (long)ooc.numrows * ooc.numcols + 1;
+  for (k = 0; k < CT_OOC_SLOTS; k++) {
+    ooc.slots[k].in  = (float *)malloc(slotFloats * sizeof(float));
+    ooc.slots[k].out = (float *)malloc(slotFloats * sizeof(float));
+    if (ooc.slots[k].in == NULL || ooc.slots[k].out == NULL) {
+      printf("ctOutOfCore: out of memory\n");
+      exit(-1);
+    }
+    memset(ooc.slots[k].in, 0, slotFloats * sizeof(float));
+    memset(ooc.slots[k].out, 0, slotFloats * sizeof(float));
+  }
+  pthread_mutex_init(&ooc.lock, NULL);
+  pthread_cond_init(&ooc.changed, NULL);
+  ctTileSizes(&l1Tile, &l2Tile);
+
+  /* Run the pipeline: read, turn here, write */
+  start = ctThreadSeconds();
+  if (ooc.numrows > 0 && ooc.numcols > 0) {
+    if (pthread_create(&reader, NULL, ctOocReader, &ooc) != 0 ||
+        pthread_create(&writer, NULL, ctOocWriter, &ooc) != 0) {
+      printf("ctOutOfCore: cannot start the pipeline\n");
+      exit(-1);
+    }
+    for (tile = 0; (slot = ctOocNext(&ooc, tile, CT_OOC_READ)) != NULL; tile++) {
+      ctTiled(slot->rows, slot->cols, slot->in, slot->out);
+      pthread_mutex_lock(&ooc.lock);
+      slot->state = CT_OOC_TURNED;
+      pthread_cond_broadcast(&ooc.changed);
+      pthread_mutex_unlock(&ooc.lock);
+    }
+    pthread_join(reader, NULL);
+    pthread_join(writer, NULL);
+  }
+  if (fdatasync(ooc.outFile) != 0) {
+    printf("ctOutOfCore: cannot flush %s\n", outFile);
+    exit(-1);
+  }
+  seconds = ctThreadSeconds() - start;
+
+  /* The matrix may have ended before the tuning did */
+  if (ooc.edges > 0 && ooc.bandsWritten <= ooc.edges)
+    ooc.edge = ctOocBest(&ooc, ooc.bandsWritten > 0 ? ooc.bandsWritten : 1);
+  *tileRows = ooc.edge < ooc.numrows ? ooc.edge : ooc.numrows;
+  *tileCols = *tileRows > 0 ? ctOocTileCols(&ooc, ooc.edge, *tileRows) : 0;
+  *bytes    = 2.0 * ooc.numrows * ooc.numcols * sizeof(float);
+
+  close(ooc.inFile);
+  close(ooc.outFile);
+  for (k = 0; k < CT_OOC_SLOTS; k++) {
+    free(ooc.slots[k].in);
+    free(ooc.slots[k].out);
+  }
+  pthread_mutex_destroy(&ooc.lock);
+  pthread_cond_destroy(&ooc.changed);
+
+  return seconds;
+}
@@ -0,0 +1,214 @@
+/******************************************************************************
+** File: ctPermute.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The permutation of a data cube, the corner turn of radar processing:
+**  for example beam x pulse x range into beam x range x pulse.
+**
+**  ctPermute moves every element of an ndims-dimensional array, stored
+**  row by row, to its place in the array whose dimension k is dimension
+**  order[k] of the input.  The output is one contiguous array, also row
+**  by row, ready for the next kernel.
+**
+**  Dimensions of one element are dropped, and input dimensions that stay
+**  next to each other, in the same order, are merged: beam x pulse x range
+**  into pulse x beam x range is a copy of whole range rows.  Otherwise
+**  the input dimension that becomes innermost and the innermost input
+**  dimension are the only two whose strides change; each plane of those
+**  two is transposed in L1 tiles, for every index of the other
+**  dimensions.  Elements of 4 bytes are transposed with the register tiles
+**  of ctSimd.h; elements of 8 (complex) or 16 bytes are copied whole.
+**
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ct.h"
+
+typedef struct { float v[2]; } ctElement8;
+typedef struct { float v[4]; } ctElement16;
+
+/*
+  A plane function turns the na x nb plane 'in', whose rows are inStride
+  elements apart, into the nb x na plane 'out', whose rows are outStride
+  elements apart, in tiles of tile x tile elements.
+*/
+typedef void (*ctPlane)(long na, long nb, char *in, long inStride,
+			char *out, long outStride, int tile, int elemBytes);
+
+static void ctPlane4(long na, long nb, char *in, long inStride,
+		     char *out, long outStride, int tile, int elemBytes)
+{
+  float *src = (float *)in, *dst = (float *)out;
+  long   ia, ib, ea, eb;
+
+  for (ia = 0; ia < na; ia += tile) {
+    ea = ia + tile < na ? tile : na - ia;
+    for (ib = 0; ib < nb; ib += tile) {
+      eb = ib + tile < nb ? tile : nb - ib;
+      ctTransposeFloats((int)ea, (int)eb, src + ia * inStride + ib, inStride,
+			dst + ib * outStride + ia, outStride);
+    }
+  }
+}
+
+#define CT_PERMUTE_PLANE(name, type)					\
+  static void name(long na, long nb, char *in, long inStride,		\
+		   char *out, long outStride, int tile, int elemBytes)	\
+  {									\
+    type *src = (type *)in, *dst = (type *)out;				\
+    long  ia0, ib0, ia, ib, ea, eb;					\
+									\
+    for (ia0 = 0; ia0 < na; ia0 += tile) {				\
+      ea = ia0 + tile < na ? ia0 + tile : na;				\
+      for (ib0 = 0; ib0 < nb; ib0 += tile) {				\
+	eb = ib0 + tile < nb ? ib0 + tile : nb;				\
+	for (ib = ib0; ib < eb; ib++) {					\
+	  for (ia = ia0; ia < ea; ia++)					\
+	    dst[ib * outStride + ia] = src[ia * inStride + ib];		\
+	}								\
+      }									\
+    }									\
+  }
+
+CT_PERMUTE_PLANE(ctPlane8, ctElement8)
+CT_PERMUTE_PLANE(ctPlane16, ctElement16)
+
+/* Elements of any other size, one memcpy each. */
+static void ctPlaneBytes(long na, long nb, char *in, long inStride,
+			 char *out, long outStride, int tile, int elemBytes)
+{
+  long ia0, ib0, ia, ib, ea, eb;
+
+  for (ia0 = 0; ia0 < na; ia0 += tile) {
+    ea = ia0 + tile < na ? ia0 + tile : na;
+    for (ib0 = 0; ib0 < nb; ib0 += tile) {
+      eb = ib0 + tile < nb ? ib0 + tile : nb;
+      for (ib = ib0; ib < eb; ib++) {
+	for (ia = ia0; ia < ea; ia++)
+	  memcpy(out + (ib * outStride + ia) * elemBytes,
+		 in + (ia * inStride + ib) * elemBytes, elemBytes);
+      }
+    }
+  }
+}
+
+void ctPermute(int ndims, const int *dims, const int *order, int elemBytes,
+	       const void *in, void *out)
+{
+  int   keep[CT_PERMUTE_MAX_DIMS];    /* new number of each kept input dim, or -1 */
+  int   kept[CT_PERMUTE_MAX_DIMS];    /* kept input dims, in output order */
+  int   first[CT_PERMUTE_MAX_DIMS];   /* first input dim of each merged group */
+  int   groupOf[CT_PERMUTE_MAX_DIMS]; /* merged input dim of each group */
+  int   mOrder[CT_PERMUTE_MAX_DIMS];  /* the order of the merged dims */
+  long  mDims[CT_PERMUTE_MAX_DIMS];
+  long  inStride[CT_PERMUTE_MAX_DIMS], outStride[CT_PERMUTE_MAX_DIMS];
+  long  size[CT_PERMUTE_MAX_DIMS], index[CT_PERMUTE_MAX_DIMS];
+  int   outer[CT_PERMUTE_MAX_DIMS];
+  int   d, k, g, n, groups, numOuter, a, b, tile;
+  long  total = 1, stride, inOffset, outOffset;
+  char *src = (char *)in, *dst = (char *)out;
+  ctPlane plane;
+
+  /* Drop the dimensions of one element */
+  for (d = 0, n = 0; d < ndims; d++) {
+    total  *= dims[d];
+    keep[d] = dims[d] > 1 ? n++ : -1;
+  }
+  if (total == 0)
+    return;
+  for (k = 0, n = 0; k < ndims; k++) {
+    if (keep[order[k]] >= 0)
+      kept[n++] = order[k];
+  }
+
+  /* Merge input dimensions that stay adjacent and in order */
+  groups = 0;
+  for (k = 0; k < n; k++) {
+    if (k == 0 || keep[kept[k]] != keep[kept[k - 1]] + 1) {
+      first[groups] = kept[k];
+      size[groups]  = dims[kept[k]];
+      groups++;
+    }
+    else {
+      size[groups - 1] *= dims[kept[k]];
+    }
+  }
+  if (groups <= 1) {
+    memcpy(dst, src, total * elemBytes);
+    return;
+  }
+
+  /* The merged input dimensions are the groups in input order */
+  for (g = 0; g < groups; g++) {
+    groupOf[g] = 0;
+    for (k = 0; k < groups; k++) {
+      if (first[k] < first[g])
+	groupOf[g]++;
+    }
+    mDims[groupOf[g]] = size[g];
+    mOrder[g]         = groupOf[g];
+  }
+  n = groups;
+
+  for (d = n - 1, stride = 1; d >= 0; d--) {
+    inStride[d] = stride;
+    stride     *= mDims[d];
+  }
+  for (k = n - 1, stride = 1; k >= 0; k--) {
+    outStride[mOrder[k]] = stride;
+    stride              *= mDims[mOrder[k]];
+  }
+
+  /*
+    The innermost output dimension, and the innermost input dimension:
+    when they are the same, whole rows of it are copied.
+  */
+  a = mOrder[n - 1];
+  b = n - 1;
+
+  /* The other dimensions, in output order */
+  numOuter = 0;
+  for (k = 0; k < n; k++) {
+    if (mOrder[k] != a && mOrder[k] != b)
+      outer[numOuter++] = mOrder[k];
+  }
+
+  tile = ctTileElements(elemBytes);
+  switch (elemBytes) {
+  case 4:  plane = ctPlane4;     break;
+  case 8:  plane = ctPlane8;     break;
+  case 16: plane = ctPlane16;    break;
+  default: plane = ctPlaneBytes; break;
+  }
+
+  for (k = 0; k < numOuter; k++)
+    index[k] = 0;
+  for (;;) {
+    inOffset = outOffset = 0;
+    for (k = 0; k < numOuter; k++) {
+      inOffset  += index[k] * inStride[outer[k]];
+      outOffset += index[k] * outStride[outer[k]];
+    }
+
+    if (a == b)
+      memcpy(dst + outOffset * elemBytes, src + inOffset * elemBytes,
+	     mDims[b] * elemBytes);
+    else
+      plane(mDims[a], mDims[b], src + inOffset * elemBytes, inStride[a],
+	    dst + outOffset * elemBytes, outStride[b], tile, elemBytes);
+
+    for (k = numOuter - 1; k >= 0; k--) {
+      if (++index[k] < mDims[outer[k]])
+	break;
+      index[k] = 0;
+    }
+    if (k < 0)
+      break;
+  }
+}
@@ -0,0 +1,250 @@
+/******************************************************************************
+** File: ctSimd.h
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The in-register transposes of the corner turn engine (ctTile.c).
+**  CT_TRANSPOSE_TILE(in, inStride, out, outStride) transposes one
+**  CT_SIMD_WIDTH x CT_SIMD_WIDTH tile of floats: rows of 'in', 'inStride'
+**  floats apart, become rows of 'out', 'outStride' floats apart.  Each
+**  row is loaded and stored whole, so only whole rows ever touch memory.
+**
+**    x86 AVX  - 8 x 8, with unpacklo/hi, shuffle and permute2f128.
+**    x86 SSE  - 4 x 4, with _MM_TRANSPOSE4_PS (unpacklo/hi, movelh/hl).
+**    ARM NEON - 4 x 4, with vtrnq and vcombine of the halves.
+**    Otherwise 4 x 4 in plain C.
+**
+**  CT_STREAM_TILE is the same transpose with non-temporal stores, which
+**  write around the caches and skip the read for ownership of each output
+**  line; every row of 'out' must start on a 16 byte boundary.  The stores
+**  are weakly ordered: CT_STREAM_FENCE orders them before any later store.
+**  CT_SIMD_STREAM is 0 where there are no such stores (NEON, plain C), and
+**  CT_STREAM_TILE is then CT_TRANSPOSE_TILE.  CT_PREFETCH(p) asks for the
+**  cache line at p ahead of its use.
+**
+**  CT_TRANSPOSE_HALF_TILE transposes a CT_HALF_WIDTH x CT_HALF_WIDTH tile
+**  of 2 byte elements (unsigned short), for the half precision corner
+**  turn: 8 x 8 with SSE2 unpacks of 16, 32 and 64 bits, or with NEON
+**  vtrnq of 16 and 32 bits and vcombine of the halves; otherwise plain C.
+**
+******************************************************************************/
+
+#ifndef CT_SIMD_H_
+#define CT_SIMD_H_
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CT_SIMD_WIDTH 8
+
+/*
+  CT_AVX_TRANSPOSE_ loads the tile into r0..r7 and leaves row k of its
+  transpose in the low halves of r(k) and r(k+4), and row k+4 in their
+  high halves, k = 0 to 3.
+*/
+#define CT_AVX_TRANSPOSE_(in, is)					\
+    r0 = _mm256_loadu_ps(in);          r1 = _mm256_loadu_ps(in + (is));	\
+    r2 = _mm256_loadu_ps(in + 2*(is)); r3 = _mm256_loadu_ps(in + 3*(is)); \
+    r4 = _mm256_loadu_ps(in + 4*(is)); r5 = _mm256_loadu_ps(in + 5*(is)); \
+    r6 = _mm256_loadu_ps(in + 6*(is)); r7 = _mm256_loadu_ps(in + 7*(is)); \
+    t0 = _mm256_unpacklo_ps(r0, r1);   t1 = _mm256_unpackhi_ps(r0, r1);	\
+    t2 = _mm256_unpacklo_ps(r2, r3);   t3 = _mm256_unpackhi_ps(r2, r3);	\
+    t4 = _mm256_unpacklo_ps(r4, r5);   t5 = _mm256_unpackhi_ps(r4, r5);	\
+    t6 = _mm256_unpacklo_ps(r6, r7);   t7 = _mm256_unpackhi_ps(r6, r7);	\
+    r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));		\
+    r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));		\
+    r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));		\
+    r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));		\
+    r4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1,0,1,0));		\
+    r5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3,2,3,2));		\
+    r6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1,0,1,0));		\
+    r7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3,2,3,2))
+
+#define CT_TRANSPOSE_TILE(in, is, out, os)				\
+  {									\
+    __m256 r0, r1, r2, r3, r4, r5, r6, r7;				\
+    __m256 t0, t1, t2, t3, t4, t5, t6, t7;				\
+    CT_AVX_TRANSPOSE_(in, is);						\
+    _mm256_storeu_ps(out,          _mm256_permute2f128_ps(r0, r4, 0x20)); \
+    _mm256_storeu_ps(out + (os),   _mm256_permute2f128_ps(r1, r5, 0x20)); \
+    _mm256_storeu_ps(out + 2*(os), _mm256_permute2f128_ps(r2, r6, 0x20)); \
+    _mm256_storeu_ps(out + 3*(os), _mm256_permute2f128_ps(r3, r7, 0x20)); \
+    _mm256_storeu_ps(out + 4*(os), _mm256_permute2f128_ps(r0, r4, 0x31)); \
+    _mm256_storeu_ps(out + 5*(os), _mm256_permute2f128_ps(r1, r5, 0x31)); \
+    _mm256_storeu_ps(out + 6*(os), _mm256_permute2f128_ps(r2, r6, 0x31)); \
+    _mm256_storeu_ps(out + 7*(os), _mm256_permute2f128_ps(r3, r7, 0x31)); \
+  }
+
+/* The halves are stored apart, so 16 byte alignment is enough. */
+#define CT_AVX_STREAM_ROW_(o, a, b, half)				\
+    _mm_stream_ps(o,     _mm256_extractf128_ps(a, half));		\
+    _mm_stream_ps(o + 4, _mm256_extractf128_ps(b, half))
+
+#define CT_SIMD_STREAM 1
+#define CT_STREAM_TILE(in, is, out, os)					\
+  {									\
+    __m256 r0, r1, r2, r3, r4, r5, r6, r7;				\
+    __m256 t0, t1, t2, t3, t4, t5, t6, t7;				\
+    CT_AVX_TRANSPOSE_(in, is);						\
+    CT_AVX_STREAM_ROW_(out,          r0, r4, 0);			\
+    CT_AVX_STREAM_ROW_(out + (os),   r1, r5, 0);			\
+    CT_AVX_STREAM_ROW_(out + 2*(os), r2, r6, 0);			\
+    CT_AVX_STREAM_ROW_(out + 3*(os), r3, r7, 0);			\
+    CT_AVX_STREAM_ROW_(out + 4*(os), r0, r4, 1);			\
+    CT_AVX_STREAM_ROW_(out + 5*(os), r1, r5, 1);			\
+    CT_AVX_STREAM_ROW_(out + 6*(os), r2, r6, 1);			\
+    CT_AVX_STREAM_ROW_(out + 7*(os), r3, r7, 1);			\
+  }
+#define CT_STREAM_FENCE() _mm_sfence()
+
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define CT_SIMD_WIDTH 4
+
+#define CT_TRANSPOSE_TILE(in, is, out, os)				\
+  {									\
+    __m128 r0, r1, r2, r3;						\
+    r0 = _mm_loadu_ps(in);          r1 = _mm_loadu_ps(in + (is));	\
+    r2 = _mm_loadu_ps(in + 2*(is)); r3 = _mm_loadu_ps(in + 3*(is));	\
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);					\
+    _mm_storeu_ps(out, r0);          _mm_storeu_ps(out + (os), r1);	\
+    _mm_storeu_ps(out + 2*(os), r2); _mm_storeu_ps(out + 3*(os), r3);	\
+  }
+
+#define CT_SIMD_STREAM 1
+#define CT_STREAM_TILE(in, is, out, os)					\
+  {									\
+    __m128 r0, r1, r2, r3;						\
+    r0 = _mm_loadu_ps(in);          r1 = _mm_loadu_ps(in + (is));	\
+    r2 = _mm_loadu_ps(in + 2*(is)); r3 = _mm_loadu_ps(in + 3*(is));	\
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);					\
+    _mm_stream_ps(out, r0);          _mm_stream_ps(out + (os), r1);	\
+    _mm_stream_ps(out + 2*(os), r2); _mm_stream_ps(out + 3*(os), r3);	\
+  }
+#define CT_STREAM_FENCE() _mm_sfence()
+
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CT_SIMD_WIDTH 4
+
+/* vtrnq pairs rows 0,1 and 2,3; the halves are then recombined. */
+#define CT_TRANSPOSE_TILE(in, is, out, os)				\
+  {									\
+    float32x4x2_t p01, p23;						\
+    p01 = vtrnq_f32(vld1q_f32(in), vld1q_f32(in + (is)));		\
+    p23 = vtrnq_f32(vld1q_f32(in + 2*(is)), vld1q_f32(in + 3*(is)));	\
+    vst1q_f32(out,          vcombine_f32(vget_low_f32(p01.val[0]),	\
+					 vget_low_f32(p23.val[0])));	\
+    vst1q_f32(out + (os),   vcombine_f32(vget_low_f32(p01.val[1]),	\
+					 vget_low_f32(p23.val[1])));	\
+    vst1q_f32(out + 2*(os), vcombine_f32(vget_high_f32(p01.val[0]),	\
+					 vget_high_f32(p23.val[0])));	\
+    vst1q_f32(out + 3*(os), vcombine_f32(vget_high_f32(p01.val[1]),	\
+					 vget_high_f32(p23.val[1])));	\
+  }
+
+#else
+#define CT_SIMD_WIDTH 4
+
+#define CT_TRANSPOSE_TILE(in, is, out, os)				\
+  {									\
+    int tr_, tc_;							\
+    for (tr_ = 0; tr_ < 4; tr_++)					\
+      for (tc_ = 0; tc_ < 4; tc_++)					\
+	(out)[tc_ * (os) + tr_] = (in)[tr_ * (is) + tc_];		\
+  }
+
+#endif
+
+#define CT_HALF_WIDTH 8
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+
+#define CT_TRANSPOSE_HALF_TILE(in, is, out, os)				\
+  {									\
+    __m128i r0, r1, r2, r3, r4, r5, r6, r7;				\
+    __m128i t0, t1, t2, t3, t4, t5, t6, t7;				\
+    r0 = _mm_loadu_si128((const __m128i *)(in));			\
+    r1 = _mm_loadu_si128((const __m128i *)(in + (is)));			\
+    r2 = _mm_loadu_si128((const __m128i *)(in + 2*(is)));		\
+    r3 = _mm_loadu_si128((const __m128i *)(in + 3*(is)));		\
+    r4 = _mm_loadu_si128((const __m128i *)(in + 4*(is)));		\
+    r5 = _mm_loadu_si128((const __m128i *)(in + 5*(is)));		\
+    r6 = _mm_loadu_si128((const __m128i *)(in + 6*(is)));		\
+    r7 = _mm_loadu_si128((const __m128i *)(in + 7*(is)));		\
+    t0 = _mm_unpacklo_epi16(r0, r1);   t1 = _mm_unpackhi_epi16(r0, r1);	\
+    t2 = _mm_unpacklo_epi16(r2, r3);   t3 = _mm_unpackhi_epi16(r2, r3);	\
+    t4 = _mm_unpacklo_epi16(r4, r5);   t5 = _mm_unpackhi_epi16(r4, r5);	\
+    t6 = _mm_unpacklo_epi16(r6, r7);   t7 = _mm_unpackhi_epi16(r6, r7);	\
+    r0 = _mm_unpacklo_epi32(t0, t2);   r1 = _mm_unpackhi_epi32(t0, t2);	\
+    r2 = _mm_unpacklo_epi32(t1, t3);   r3 = _mm_unpackhi_epi32(t1, t3);	\
+    r4 = _mm_unpacklo_epi32(t4, t6);   r5 = _mm_unpackhi_epi32(t4, t6);	\
+    r6 = _mm_unpacklo_epi32(t5, t7);   r7 = _mm_unpackhi_epi32(t5, t7);	\
+    _mm_storeu_si128((__m128i *)(out),          _mm_unpacklo_epi64(r0, r4)); \
+    _mm_storeu_si128((__m128i *)(out + (os)),   _mm_unpackhi_epi64(r0, r4)); \
+    _mm_storeu_si128((__m128i *)(out + 2*(os)), _mm_unpacklo_epi64(r1, r5)); \
+    _mm_storeu_si128((__m128i *)(out + 3*(os)), _mm_unpackhi_epi64(r1, r5)); \
+    _mm_storeu_si128((__m128i *)(out + 4*(os)), _mm_unpacklo_epi64(r2, r6)); \
+    _mm_storeu_si128((__m128i *)(out + 5*(os)), _mm_unpackhi_epi64(r2, r6)); \
+    _mm_storeu_si128((__m128i *)(out + 6*(os)), _mm_unpacklo_epi64(r3, r7)); \
+    _mm_storeu_si128((__m128i *)(out + 7*(os)), _mm_unpackhi_epi64(r3, r7)); \
+  }
+
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+/* Rows k and k+4 of the transpose are the halves of one 32 bit vtrnq. */
+#define CT_NEON_HALF_ROWS_(out, os, k, a, b)				\
+    vst1q_u16(out + (k)*(os), vreinterpretq_u16_u32(			\
+      vcombine_u32(vget_low_u32(a), vget_low_u32(b))));			\
+    vst1q_u16(out + ((k)+4)*(os), vreinterpretq_u16_u32(		\
+      vcombine_u32(vget_high_u32(a), vget_high_u32(b))))
+
+#define CT_TRANSPOSE_HALF_TILE(in, is, out, os)				\
+  {									\
+    uint16x8x2_t p01, p23, p45, p67;					\
+    uint32x4x2_t q02, q13, q46, q57;					\
+    p01 = vtrnq_u16(vld1q_u16(in),          vld1q_u16(in + (is)));	\
+    p23 = vtrnq_u16(vld1q_u16(in + 2*(is)), vld1q_u16(in + 3*(is)));	\
+    p45 = vtrnq_u16(vld1q_u16(in + 4*(is)), vld1q_u16(in + 5*(is)));	\
+    p67 = vtrnq_u16(vld1q_u16(in + 6*(is)), vld1q_u16(in + 7*(is)));	\
+    q02 = vtrnq_u32(vreinterpretq_u32_u16(p01.val[0]),			\
+		    vreinterpretq_u32_u16(p23.val[0]));			\
+    q13 = vtrnq_u32(vreinterpretq_u32_u16(p01.val[1]),			\
+		    vreinterpretq_u32_u16(p23.val[1]));			\
+    q46 = vtrnq_u32(vreinterpretq_u32_u16(p45.val[0]),			\
+		    vreinterpretq_u32_u16(p67.val[0]));			\
+    q57 = vtrnq_u32(vreinterpretq_u32_u16(p45.val[1]),			\
+		    vreinterpretq_u32_u16(p67.val[1]));			\
+    CT_NEON_HALF_ROWS_(out, os, 0, q02.val[0], q46.val[0]);		\
+    CT_NEON_HALF_ROWS_(out, os, 1, q13.val[0], q57.val[0]);		\
+    CT_NEON_HALF_ROWS_(out, os, 2, q02.val[1], q46.val[1]);		\
+    CT_NEON_HALF_ROWS_(out, os, 3, q13.val[1], q57.val[1]);		\
+  }
+
+#else
+
+#define CT_TRANSPOSE_HALF_TILE(in, is, out, os)				\
+  {									\
+    int tr_, tc_;							\
+    for (tr_ = 0; tr_ < 8; tr_++)					\
+      for (tc_ = 0; tc_ < 8; tc_++)					\
+	(out)[tc_ * (os) + tr_] = (in)[tr_ * (is) + tc_];		\
+  }
+
+#endif
+
+#ifndef CT_SIMD_STREAM
+#define CT_SIMD_STREAM 0
+#define CT_STREAM_TILE(in, is, out, os) CT_TRANSPOSE_TILE(in, is, out, os)
+#define CT_STREAM_FENCE()
+#endif
+
+#if defined(__GNUC__)
+#define CT_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define CT_PREFETCH(p)
+#endif
+
+#endif
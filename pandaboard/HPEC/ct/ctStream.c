@@ -0,0 +1,99 @@
+/******************************************************************************
+** File: ctStream.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The measurements the corner turn is reported against: the STREAM
+**  copy, and the peak resident memory.
+**
+**  A corner turn reads and writes every element once, as a copy does, so
+**  the copy bandwidth of the machine bounds it.  ctStreamCopy copies
+**  'bytes' bytes, the size of the matrix, so that both see the same
+**  caches, and returns the best of CT_STREAM_TRIALS runs as STREAM counts
+**  it: bytes read plus bytes written, per second.  Copies are at most
+**  CT_STREAM_MAX_BYTES.  A run repeats the copy
+**  until it takes a millisecond, so that small matrices can be timed.
+**
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "ct.h"
+
+static double ctStreamSeconds(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+double ctStreamCopy(unsigned long bytes)
+{
+  unsigned long  count = bytes / sizeof(float), index;
+  unsigned long  repeats = 1, repeat;
+  int            trial;
+  double         start, seconds, best = 0.0;
+  float         *a, *b;
+  volatile float sink = 0.0f;
+
+  if (count > CT_STREAM_MAX_BYTES / sizeof(float))
+    count = CT_STREAM_MAX_BYTES / sizeof(float);
+  if (count == 0)
+    count = 1;
+  a = (float *)malloc(count * sizeof(float));
+  b = (float *)malloc(count * sizeof(float));
+  if (a == NULL || b == NULL) {
+    printf("ctStreamCopy: out of memory\n");
+    exit(-1);
+  }
+
+  /* Touch both arrays before timing. */
+  for (index = 0; index < count; index++) {
+    a[index] = (float)index;
+    b[index] = 0.0f;
+  }
+
+  for (trial = 0; trial < CT_STREAM_TRIALS; trial++) {
+    for (;;) {
+      start = ctStreamSeconds();
+      for (repeat = 0; repeat < repeats; repeat++) {
+	for (index = 0; index < count; index++)
+	  b[index] = a[index];
+	/* Keep each copy from being folded into the next. */
+	sink += b[repeat % count];
+	a[repeat % count] = (float)repeat;
+      }
+      seconds = ctStreamSeconds() - start;
+      if (seconds >= 1e-3)
+	break;
+      repeats *= 2;
+    }
+    seconds /= repeats;
+    if (best == 0.0 || seconds < best)
+      best = seconds;
+  }
+
+  free(a);
+  free(b);
+
+  return 2.0 * count * sizeof(float) / best;
+}
+
+/*
+  ctPeakKilobytes returns the largest resident set of the process so far
+  (getrusage: kilobytes on Linux), or 0 where it is not known.
+*/
+long ctPeakKilobytes(void)
+{
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return usage.ru_maxrss;
+}
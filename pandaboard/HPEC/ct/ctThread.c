@@ -0,0 +1,268 @@
+/******************************************************************************
+** File: ctThread.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The thread pool of the corner turn.  The threads are started once,
+**  before timing, and wait between jobs; ctThreadRun() runs one job on
+**  all of them and returns when every thread has finished it.
+**
+**  The NUMA nodes are read from CT_NODE_DIR.  With CT_PIN each thread is
+**  bound to the processors of one node, consecutive threads to the same
+**  node, so that the memory a thread touches first stays local to it.
+**  Elsewhere than Linux there is one node and no thread is pinned.
+**
+******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "ct.h"
+
+static int             ctThreadNum     = 1;
+static int             ctThreadStarted = 0;
+static pthread_t      *ctThreadIds     = NULL;
+static int            *ctThreadIndex   = NULL;
+static pthread_mutex_t ctThreadLock    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  ctThreadWake    = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  ctThreadDone    = PTHREAD_COND_INITIALIZER;
+
+/* The current job; written by thread 0 under the lock. */
+static ctJob ctThreadJob;
+static void *ctThreadArg;
+static int   ctThreadGeneration = 0;
+static int   ctThreadPending    = 0;
+static int   ctThreadQuit       = 0;
+
+/* The node of each processor, and the nodes that have processors. */
+static int ctCpuNode[CT_MAX_CPUS];
+static int ctNodeList[CT_MAX_NODES];
+static int ctNodeCount = 0;
+static int ctNodeMax   = 0;
+
+/*
+  ctThreadFindNodes reads the processors of each node from the cpulist
+  files ("0-3,8-11") of CT_NODE_DIR.  Without them all is node 0.
+*/
+static void ctThreadFindNodes(void)
+{
+  char  name[200];
+  int   node, first, last, cpu, found;
+  FILE *file;
+
+  memset(ctCpuNode, 0, sizeof(ctCpuNode));
+  ctNodeCount = 0;
+  ctNodeMax   = 1;
+
+  for (node = 0; node < CT_MAX_NODES; node++) {
+    sprintf(name, "%s/node%d/cpulist", CT_NODE_DIR, node);
+    if ((file = fopen(name, "r")) == NULL)
+      continue;
+    found = 0;
+    while (fscanf(file, "%d", &first) == 1) {
+      last = first;
+      if (fscanf(file, "-%d", &last) != 1)
+	last = first;
+      for (cpu = first; cpu <= last && cpu < CT_MAX_CPUS; cpu++)
+	ctCpuNode[cpu] = node;
+      found = 1;
+      if (fgetc(file) != ',')
+	break;
+    }
+    fclose(file);
+    if (found) {
+      ctNodeList[ctNodeCount++] = node;
+      ctNodeMax = node + 1;
+    }
+  }
+
+  if (ctNodeCount == 0)
+    ctNodeList[ctNodeCount++] = 0;
+}
+
+/* ctThreadPin binds the calling thread to the processors of its node. */
+static void ctThreadPin(int thread)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  int       node = ctNodeList[(thread * ctNodeCount) / ctThreadNum];
+  int       cpu, any = 0;
+
+  CPU_ZERO(&set);
+  for (cpu = 0; cpu < CT_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+    if (ctCpuNode[cpu] == node) {
+      CPU_SET(cpu, &set);
+      any = 1;
+    }
+  }
+  if (any && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    printf("ctThreadPin: cannot pin thread %d to node %d\n", thread, node);
+#endif
+}
+
+static void *ctThreadWorker(void *arg)
+{
+  int   index = *(int *)arg;
+  int   generation = 0;
+  ctJob job;
+  void *jobArg;
+
+  if (CT_PIN)
+    ctThreadPin(index);
+
+  pthread_mutex_lock(&ctThreadLock);
+  for (;;) {
+    while (generation == ctThreadGeneration && !ctThreadQuit)
+      pthread_cond_wait(&ctThreadWake, &ctThreadLock);
+    if (ctThreadQuit)
+      break;
+    generation = ctThreadGeneration;
+    job        = ctThreadJob;
+    jobArg     = ctThreadArg;
+    pthread_mutex_unlock(&ctThreadLock);
+
+    job(jobArg, index, ctThreadNum);
+
+    pthread_mutex_lock(&ctThreadLock);
+    if (--ctThreadPending == 0)
+      pthread_cond_signal(&ctThreadDone);
+  }
+  pthread_mutex_unlock(&ctThreadLock);
+
+  return NULL;
+}
+
+/*
+  The thread count to use for 'numThreads': itself, or one per online
+  processor when it is 0 or less.
+*/
+int ctThreadProcessors(int numThreads)
+{
+  long online = 1;
+
+  if (numThreads > 0)
+    return numThreads;
+#ifdef _SC_NPROCESSORS_ONLN
+  online = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return (online < 1) ? 1 : (int)online;
+}
+
+/*
+  Start numThreads-1 threads; the caller is thread 0 of the pool.
+*/
+void ctThreadStart(int numThreads)
+{
+  int thread;
+
+  ctThreadFindNodes();
+  ctThreadNum = numThreads > 1 ? numThreads : 1;
+  if (CT_PIN)
+    ctThreadPin(0);
+  if (ctThreadNum == 1)
+    return;
+
+  ctThreadIds   = (pthread_t *)malloc(ctThreadNum * sizeof(pthread_t));
+  ctThreadIndex = (int *)malloc(ctThreadNum * sizeof(int));
+  if (ctThreadIds == NULL || ctThreadIndex == NULL) {
+    printf("ctThreadStart: out of memory\n");
+    exit(-1);
+  }
+
+  ctThreadStarted = 1;
+  ctThreadQuit    = 0;
+  for (thread = 1; thread < ctThreadNum; thread++) {
+    ctThreadIndex[thread] = thread;
+    if (pthread_create(&ctThreadIds[thread], NULL, ctThreadWorker,
+		       &ctThreadIndex[thread]) != 0) {
+      printf("ctThreadStart: cannot start thread %d\n", thread);
+      exit(-1);
+    }
+  }
+}
+
+/*
+  ctThreadRun runs job(arg, thread, numThreads) on every thread of the
+  pool, and returns when all have returned.
+*/
+void ctThreadRun(ctJob job, void *arg)
+{
+  if (!ctThreadStarted) {
+    job(arg, 0, 1);
+    return;
+  }
+
+  pthread_mutex_lock(&ctThreadLock);
+  ctThreadJob     = job;
+  ctThreadArg     = arg;
+  ctThreadPending = ctThreadNum - 1;
+  ctThreadGeneration++;
+  pthread_cond_broadcast(&ctThreadWake);
+  pthread_mutex_unlock(&ctThreadLock);
+
+  job(arg, 0, ctThreadNum);
+
+  pthread_mutex_lock(&ctThreadLock);
+  while (ctThreadPending > 0)
+    pthread_cond_wait(&ctThreadDone, &ctThreadLock);
+  pthread_mutex_unlock(&ctThreadLock);
+}
+
+/* One more than the highest node with processors. */
+int ctThreadNodes(void)
+{
+  return ctNodeMax;
+}
+
+/* The node of the processor the calling thread is running on. */
+int ctThreadNode(void)
+{
+#ifdef __linux__
+  int cpu = sched_getcpu();
+
+  if (cpu >= 0 && cpu < CT_MAX_CPUS)
+    return ctCpuNode[cpu];
+#endif
+  return 0;
+}
+
+/* Wall clock seconds, for timing each thread. */
+double ctThreadSeconds(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* Stop the threads. */
+void ctThreadStop(void)
+{
+  int thread;
+
+  if (ctThreadStarted) {
+    pthread_mutex_lock(&ctThreadLock);
+    ctThreadQuit = 1;
+    pthread_cond_broadcast(&ctThreadWake);
+    pthread_mutex_unlock(&ctThreadLock);
+
+    for (thread = 1; thread < ctThreadNum; thread++)
+      pthread_join(ctThreadIds[thread], NULL);
+
+    free(ctThreadIds);
+    free(ctThreadIndex);
+    ctThreadStarted = 0;
+  }
+  ctThreadNum = 1;
+}
@@ -0,0 +1,408 @@
+/******************************************************************************
+** File: ctTile.c
+**
+** HPEC Challenge Benchmark Suite
+** CornerTurn Kernel Benchmark
+**
+** Contents:
+**  The cache-blocked and cache-oblivious corner turn engines.
+**
+**  The naive loop reads the input in rows and writes the output in
+**  columns, so every store touches a new cache line once the output
+**  columns outgrow the cache.  ctTiled instead turns the matrix in L2
+**  tiles, each in L1 tiles, each in CT_SIMD_WIDTH x CT_SIMD_WIDTH tiles
+**  transposed in registers: every cache line brought in is used whole
+**  before it is evicted.  An L1 tile edge is the largest multiple of
+**  CT_SIMD_WIDTH for which an input and an output tile take half of L1;
+**  an L2 tile edge is the largest multiple of that for which the two take
+**  half of L2.  The sizes are read from CT_CACHE_DIR, or set with
+**  -DCT_L1_BYTES= and -DCT_L2_BYTES=.
+**
+**  ctRecursive halves the larger dimension until a block has at most
+**  CT_RECURSIVE_BASE elements, which then fits every cache level without
+**  knowing their sizes.  ctTiled falls back on it when the L1 size is
+**  unknown.
+**
+**  ctTiledStream is ctTiled with non-temporal stores: the output is not
+**  read again by the corner turn, so it is written around the caches,
+**  without first reading each line for ownership or evicting the input.
+**  Register tiles whose output rows are not on a 16 byte boundary are
+**  stored as usual.  It also prefetches the input ctSetPrefetch() rows
+**  ahead within each L1 tile.
+**
+**  ctTiledHalfColumns turns a matrix of 2 byte elements (fp16 or bf16
+**  bits, moved but never converted) in L1 tiles sized for them, each in
+**  CT_HALF_WIDTH x CT_HALF_WIDTH tiles transposed in registers.
+**
+**  All of them leave the edges that do not fill a register tile to scalar
+**  code, so any matrix shape is turned.
+**
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ct.h"
+#include "ctSimd.h"
+
+static int           ctL1Tile  = -1;
+static int           ctL2Tile  = -1;
+static unsigned long ctL1Bytes = 0;
+static int           ctPrefetchRows = 0;
+
+/*
+  ctCacheBytes returns the size, in bytes, of the data (or unified) cache
+  of 'level' given in CT_CACHE_DIR, or 0.
+*/
+static unsigned long ctCacheBytes(int level)
+{
+  char          name[200], type[32], unit;
+  int           index, cacheLevel;
+  unsigned long size;
+  FILE         *file;
+
+  for (index = 0; index < 16; index++) {
+    sprintf(name, "%s/index%d/level", CT_CACHE_DIR, index);
+    if ((file = fopen(name, "r")) == NULL)
+      break;
+    cacheLevel = 0;
+    if (fscanf(file, "%d", &cacheLevel) != 1)
+      cacheLevel = 0;
+    fclose(file);
+    if (cacheLevel != level)
+      continue;
+
+    sprintf(name, "%s/index%d/type", CT_CACHE_DIR, index);
+    if ((file = fopen(name, "r")) == NULL)
+      continue;
+    if (fscanf(file, "%31s", type) != 1)
+      type[0] = '\0';
+    fclose(file);
+    if (strcmp(type, "Data") != 0 && strcmp(type, "Unified") != 0)
+      continue;
+
+    sprintf(name, "%s/index%d/size", CT_CACHE_DIR, index);
+    if ((file = fopen(name, "r")) == NULL)
+      continue;
+    unit = ' ';
+    if (fscanf(file, "%lu%c", &size, &unit) < 1)
+      size = 0;
+    fclose(file);
+    if (unit == 'K')
+      size *= 1024;
+    else if (unit == 'M')
+      size *= 1024 * 1024;
+    return size;
+  }
+
+  return 0;
+}
+
+/*
+  ctTileEdge returns the largest multiple of 'multiple' whose input and
+  output tiles of elements of 'elemBytes' together take at most half of
+  'bytes'.
+*/
+static int ctTileEdge(unsigned long bytes, int multiple, int elemBytes)
+{
+  unsigned long edge = 0;
+
+  while ((edge + multiple) * (edge + multiple) * 4 * elemBytes <= bytes)
+    edge += multiple;
+
+  return (int)edge;
+}
+
+/*
+  ctTileSizes returns the tile edges of ctTiled, finding them on the first
+  call; call it before timing.  l1Tile is 0 if the L1 size is unknown,
+  l2Tile is l1Tile if the L2 size is.
+*/
+void ctTileSizes(int *l1Tile, int *l2Tile)
+{
+  unsigned long l1Bytes = CT_L1_BYTES, l2Bytes = CT_L2_BYTES;
+
+  if (ctL1Tile < 0) {
+    if (l1Bytes == 0)
+      l1Bytes = ctCacheBytes(1);
+    if (l2Bytes == 0)
+      l2Bytes = ctCacheBytes(2);
+
+    ctL1Bytes = l1Bytes;
+    ctL1Tile  = ctTileEdge(l1Bytes, CT_SIMD_WIDTH, sizeof(float));
+    if (ctL1Tile > CT_L1_TILE_MAX)
+      ctL1Tile = CT_L1_TILE_MAX - CT_L1_TILE_MAX % CT_SIMD_WIDTH;
+
+    ctL2Tile = ctL1Tile;
+    if (ctL1Tile > 0 && ctTileEdge(l2Bytes, ctL1Tile, sizeof(float)) > ctL1Tile)
+      ctL2Tile = ctTileEdge(l2Bytes, ctL1Tile, sizeof(float));
+  }
+
+  *l1Tile = ctL1Tile;
+  *l2Tile = ctL2Tile;
+}
+
+/*
+  ctTileElements returns the L1 tile edge for elements of 'elemBytes', a
+  multiple of CT_SIMD_WIDTH of at most CT_L1_TILE_MAX, or CT_TILE_DEFAULT
+  if the L1 size is unknown.
+*/
+int ctTileElements(int elemBytes)
+{
+  int l1Tile, l2Tile, edge;
+
+  ctTileSizes(&l1Tile, &l2Tile);
+  if (l1Tile == 0)
+    return CT_TILE_DEFAULT;
+
+  edge = ctTileEdge(ctL1Bytes, CT_SIMD_WIDTH, elemBytes);
+  if (edge > CT_L1_TILE_MAX)
+    edge = CT_L1_TILE_MAX - CT_L1_TILE_MAX % CT_SIMD_WIDTH;
+  return edge > 0 ? edge : CT_SIMD_WIDTH;
+}
+
+/*
+  ctTransposeFloats turns the rows x cols block 'in', whose rows are
+  inStride floats apart, into the cols x rows block 'out', whose rows are
+  outStride floats apart: register tiles, then the scalar edges.
+*/
+void ctTransposeFloats(int rows, int cols, float *in, long inStride,
+		       float *out, long outStride)
+{
+  int i, j, k;
+  int rs = rows / CT_SIMD_WIDTH * CT_SIMD_WIDTH;
+  int cs = cols / CT_SIMD_WIDTH * CT_SIMD_WIDTH;
+
+  for (i = 0; i < rs; i += CT_SIMD_WIDTH) {
+    for (j = 0; j < cs; j += CT_SIMD_WIDTH)
+      CT_TRANSPOSE_TILE(in + i * inStride + j, inStride, out + j * outStride + i, outStride);
+    for (j = i; j < i + CT_SIMD_WIDTH; j++) {
+      for (k = cs; k < cols; k++)
+	out[k * outStride + j] = in[j * inStride + k];
+    }
+  }
+
+  for (i = rs; i < rows; i++) {
+    for (j = 0; j < cols; j++)
+      out[j * outStride + i] = in[i * inStride + j];
+  }
+}
+
+/*
+  ctStreamFloats is ctTransposeFloats with non-temporal stores, and the
+  input prefetched ctPrefetchRows rows ahead.  The register tiles are
+  taken in groups of rows that together fill CT_LINE_BYTES of each output
+  row, so that the write-combining buffers are flushed as whole lines.
+*/
+static void ctStreamFloats(int rows, int cols, float *in, long inStride,
+			   float *out, long outStride)
+{
+  int i, i0, iEnd, j, k;
+  int rs = rows / CT_SIMD_WIDTH * CT_SIMD_WIDTH;
+  int cs = cols / CT_SIMD_WIDTH * CT_SIMD_WIDTH;
+  int group = CT_LINE_BYTES / sizeof(float) > CT_SIMD_WIDTH ?
+	      CT_LINE_BYTES / sizeof(float) : CT_SIMD_WIDTH;
+
+  for (i0 = 0; i0 < rs; i0 += group) {
+    iEnd = i0 + group < rs ? i0 + group : rs;
+    for (j = 0; j < cs; j += CT_SIMD_WIDTH) {
+      for (i = i0; i < iEnd; i += CT_SIMD_WIDTH) {
+	if (ctPrefetchRows > 0 && i + ctPrefetchRows + CT_SIMD_WIDTH <= rows) {
+	  for (k = i + ctPrefetchRows; k < i + ctPrefetchRows + CT_SIMD_WIDTH; k++)
+	    CT_PREFETCH(in + k * inStride + j);
+	}
+	if (((unsigned long)(out + j * outStride + i) | outStride * sizeof(float)) % 16 == 0)
+	  CT_STREAM_TILE(in + i * inStride + j, inStride, out + j * outStride + i, outStride)
+	else
+	  CT_TRANSPOSE_TILE(in + i * inStride + j, inStride, out + j * outStride + i, outStride)
+      }
+    }
+  }
+
+  for (i = 0; i < rs; i++) {
+    for (k = cs; k < cols; k++)
+      out[k * outStride + i] = in[i * inStride + k];
+  }
+  for (i = rs; i < rows; i++) {
+    for (j = 0; j < cols; j++)
+      out[j * outStride + i] = in[i * inStride + j];
+  }
+}
+
+/*
+  ctSetPrefetch sets how many rows ahead ctTiledStream prefetches its
+  input; 0 is not at all.
+*/
+void ctSetPrefetch(int rows)
+{
+  ctPrefetchRows = rows;
+}
+
+/*
+  ctBlock turns rows r0 to r1-1 and columns c0 to c1-1 of the numrows x
+  numcols matrix 'in' into 'out', with non-temporal stores if 'stream'.
+*/
+static void ctBlock(int numrows, int numcols, float *in, float *out,
+		    int r0, int r1, int c0, int c1, int stream)
+{
+  if (stream)
+    ctStreamFloats(r1 - r0, c1 - c0, in + r0 * numcols + c0, numcols,
+		   out + c0 * numrows + r0, numrows);
+  else
+    ctTransposeFloats(r1 - r0, c1 - c0, in + r0 * numcols + c0, numcols,
+		      out + c0 * numrows + r0, numrows);
+}
+
+/*
+  ctTiles turns columns c0 to c1-1 of 'in' into rows c0 to c1-1 of 'out'
+  in L2 tiles of L1 tiles of l1Tile x l1Tile.
+*/
+static void ctTiles(int numrows, int numcols, float *in, float *out, int c0, int c1,
+		    int l1Tile, int l2Tile, int stream)
+{
+  int i2, j2, i1, j1, iEnd2, jEnd2, iEnd1, jEnd1;
+
+
+  for (i2 = 0; i2 < numrows; i2 += l2Tile) {
+    iEnd2 = i2 + l2Tile < numrows ? i2 + l2Tile : numrows;
+    for (j2 = c0; j2 < c1; j2 += l2Tile) {
+      jEnd2 = j2 + l2Tile < c1 ? j2 + l2Tile : c1;
+
+      for (i1 = i2; i1 < iEnd2; i1 += l1Tile) {
+	iEnd1 = i1 + l1Tile < iEnd2 ? i1 + l1Tile : iEnd2;
+	for (j1 = j2; j1 < jEnd2; j1 += l1Tile) {
+	  jEnd1 = j1 + l1Tile < jEnd2 ? j1 + l1Tile : jEnd2;
+	  ctBlock(numrows, numcols, in, out, i1, iEnd1, j1, jEnd1, stream);
+	}
+      }
+    }
+  }
+}
+
+void ctTiled(int numrows, int numcols, float *in, float *out)
+{
+  ctTiledColumns(numrows, numcols, in, out, 0, numcols);
+}
+
+/*
+  ctTiledColumns turns columns c0 to c1-1 of 'in' into rows c0 to c1-1 of
+  'out'.
+*/
+void ctTiledColumns(int numrows, int numcols, float *in, float *out, int c0, int c1)
+{
+  int l1Tile, l2Tile;
+
+  ctTileSizes(&l1Tile, &l2Tile);
+  if (l1Tile == 0)
+    ctRecursiveColumns(numrows, numcols, in, out, c0, c1);
+  else
+    ctTiles(numrows, numcols, in, out, c0, c1, l1Tile, l2Tile, 0);
+}
+
+void ctTiledStream(int numrows, int numcols, float *in, float *out)
+{
+  ctTiledStreamColumns(numrows, numcols, in, out, 0, numcols);
+}
+
+/*
+  ctTiledStreamColumns is ctTiledColumns with non-temporal stores; with
+  the L1 size unknown its tiles are CT_TILE_DEFAULT.  The stores are
+  fenced before it returns, so another thread may read them.
+*/
+void ctTiledStreamColumns(int numrows, int numcols, float *in, float *out, int c0, int c1)
+{
+  int l1Tile, l2Tile;
+
+  ctTileSizes(&l1Tile, &l2Tile);
+  if (l1Tile == 0)
+    l1Tile = l2Tile = CT_TILE_DEFAULT;
+  ctTiles(numrows, numcols, in, out, c0, c1, l1Tile, l2Tile, 1);
+  CT_STREAM_FENCE();
+}
+
+/*
+  ctTransposeHalves is ctTransposeFloats for 2 byte elements.
+*/
+static void ctTransposeHalves(int rows, int cols, unsigned short *in, long inStride,
+			      unsigned short *out, long outStride)
+{
+  int i, j, k;
+  int rs = rows / CT_HALF_WIDTH * CT_HALF_WIDTH;
+  int cs = cols / CT_HALF_WIDTH * CT_HALF_WIDTH;
+
+  for (i = 0; i < rs; i += CT_HALF_WIDTH) {
+    for (j = 0; j < cs; j += CT_HALF_WIDTH)
+      CT_TRANSPOSE_HALF_TILE(in + i * inStride + j, inStride, out + j * outStride + i, outStride);
+    for (j = i; j < i + CT_HALF_WIDTH; j++) {
+      for (k = cs; k < cols; k++)
+	out[k * outStride + j] = in[j * inStride + k];
+    }
+  }
+
+  for (i = rs; i < rows; i++) {
+    for (j = 0; j < cols; j++)
+      out[j * outStride + i] = in[i * inStride + j];
+  }
+}
+
+/*
+  ctTiledHalfColumns turns columns c0 to c1-1 of the numrows x numcols
+  matrix of 2 byte elements 'in' into rows c0 to c1-1 of 'out'.
+*/
+void ctTiledHalfColumns(int numrows, int numcols, unsigned short *in, unsigned short *out,
+			int c0, int c1)
+{
+  int i, j, iEnd, jEnd;
+  int tile = ctTileElements(sizeof(unsigned short)) / CT_HALF_WIDTH * CT_HALF_WIDTH;
+
+  if (tile == 0)
+    tile = CT_HALF_WIDTH;
+
+  for (i = 0; i < numrows; i += tile) {
+    iEnd = i + tile < numrows ? i + tile : numrows;
+    for (j = c0; j < c1; j += tile) {
+      jEnd = j + tile < c1 ? j + tile : c1;
+      ctTransposeHalves(iEnd - i, jEnd - j, in + (long)i * numcols + j, numcols,
+			out + (long)j * numrows + i, numrows);
+    }
+  }
+}
+
+/*
+  ctRecurse splits the block in two across its larger dimension, on a
+  multiple of CT_SIMD_WIDTH where it can, so that the register tiles of
+  the halves stay whole.
+*/
+static void ctRecurse(int numrows, int numcols, float *in, float *out,
+		      int r0, int r1, int c0, int c1)
+{
+  int mid;
+
+  if ((r1 - r0) * (c1 - c0) <= CT_RECURSIVE_BASE) {
+    ctBlock(numrows, numcols, in, out, r0, r1, c0, c1, 0);
+  }
+  else if (r1 - r0 >= c1 - c0) {
+    mid = r0 + (r1 - r0) / 2 / CT_SIMD_WIDTH * CT_SIMD_WIDTH;
+    if (mid == r0)
+      mid = r0 + (r1 - r0) / 2;
+    ctRecurse(numrows, numcols, in, out, r0, mid, c0, c1);
+    ctRecurse(numrows, numcols, in, out, mid, r1, c0, c1);
+  }
+  else {
+    mid = c0 + (c1 - c0) / 2 / CT_SIMD_WIDTH * CT_SIMD_WIDTH;
+    if (mid == c0)
+      mid = c0 + (c1 - c0) / 2;
+    ctRecurse(numrows, numcols, in, out, r0, r1, c0, mid);
+    ctRecurse(numrows, numcols, in, out, r0, r1, mid, c1);
+  }
+}
+
+void ctRecursive(int numrows, int numcols, float *in, float *out)
+{
+  ctRecurse(numrows, numcols, in, out, 0, numrows, 0, numcols);
+}
+
+void ctRecursiveColumns(int numrows, int numcols, float *in, float *out, int c0, int c1)
+{
+  ctRecurse(numrows, numcols, in, out, 0, numrows, c0, c1);
+}
@@ -13,8 +13,11 @@
 **  The output matrix is stored in file 
 **              "./<dataSetNum>-ct-outmatrix.dat".
 **
+**  With 'fp16' or 'bf16', the output of the same mode of ct, an element
+**  passes within the error of one conversion to that format (PcaCHalf.h).
+**
 ** Command:
-**   ctVerify <data set num> 
+**   ctVerify <data set num> [fp16 | bf16]
 **
 ** Author: Hector Chan
 **         MIT Lincoln Laboratory
@@ -23,10 +26,12 @@
 
 #include <stdio.h>
 #include "PcaCArray.h"
+#include "PcaCHalf.h"
 
-int verify(PcaCArrayFloat *truth, PcaCArrayFloat *out)
+int verify(PcaCArrayFloat *truth, PcaCArrayFloat *out, int format)
 {
   unsigned int i, j;
+  double       t, error, eps, tiny;
   unsigned int numrows = truth->size[0];
   unsigned int numcols = truth->size[1];
 
@@ -56,9 +61,20 @@ int verify(PcaCArrayFloat *truth, PcaCArrayFloat *out)
   printf("\n");
 #endif
 
+  eps  = format == PCA_FP16 ? PCA_FP16_EPS : PCA_BF16_EPS;
+  tiny = format == PCA_FP16 ? PCA_FP16_TINY : PCA_BF16_TINY;
+
   for (i=0; i<numrows; i++) {
     for (j=0; j<numcols; j++) {
-      if ( ((float**)(truth->datav))[i][j] != ((float**)(out->datav))[i][j] )
+      if (format) {
+	t     = ((float**)(truth->datav))[i][j];
+	error = t - ((float**)(out->datav))[i][j];
+	if (error < 0) error = -error;
+	if (t < 0) t = -t;
+	if (!(error <= eps * t + tiny))
+	  return 0;
+      }
+      else if ( ((float**)(truth->datav))[i][j] != ((float**)(out->datav))[i][j] )
 	return 0;
     }
   }
@@ -70,9 +86,12 @@ int main(int argc, char **argv)
 {
   PcaCArrayFloat truthmatrix, outmatrix;
   char           truthmatrixfile[100], outmatrixfile[100];
+  int            format = 0;
 
-  if (argc != 2) {
-    printf("Usage: %s <data set num>\n", argv[0]);
+  if (argc == 3)
+    format = pca_half_format(argv[2]);
+  if ((argc != 2 && argc != 3) || (argc == 3 && format == 0)) {
+    printf("Usage: %s <data set num> [fp16 | bf16]\n", argv[0]);
     return -1;
   }
 
@@ -86,7 +105,7 @@ int main(int argc, char **argv)
 
   /* Run the verifier */
   printf("Verification: ");
-  if (verify(&truthmatrix, &outmatrix)) {
+  if (verify(&truthmatrix, &outmatrix, format)) {
     printf("PASS\n");
   }
   else {
@@ -20,25 +20,34 @@
 #include <math.h>  /* for sin() and cos() in createTwiddles()*/
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "fdFir.h"
 #include "PcaCTimer.h"
 
+struct fdFirVariables fdFirVars;
+
+static void fdFirThreadSetup(struct fdFirVariables *fdFirVars,
+			     struct fdFirTransform *transform);
+static void fdFirFilterJob(void *arg, int thread, int numThreads);
+static int  fdFirUnits(struct fdFirVariables *fdFirVars);
+
 int main(int argc, char **argv)
 {
   fdFirVars.arguments = argc;
   fdFirVars.dataSet = argv[1];
+  fdFirVars.modeName = (argc > 2) ? argv[2] : NULL;
+  fdFirVars.modeArg  = (argc > 3) ? argv[3] : NULL;
 
   /*
     I need to declare some variables:
       -pointers to data, filter, and twiddle factors.
       -inputLength;
-      -butterflies;
       -phases;
     These are all in the fdFirVariables structure in fdFir.h
-    Along with the structure definition, I also instantiate an 
-    instanced called fdFirVars.  This is the same as doing:
+    fdFir.h only declares the instance, fdFirVars; it is defined 
+    once, at the top of this file:
     
-    struct fdFirVaribles fdFirVars;
+    struct fdFirVariables fdFirVars;
   */
   
 
@@ -75,6 +84,13 @@ int main(int argc, char **argv)
   */
   fdFir(&fdFirVars);
 
+#if FDFIR_PROFILE
+  /*
+    With "make PROFILE=1", each stage of the kernel is run again and timed
+    alone, outside of the timed kernel (fdFirProfile.c).
+  */
+  fdFirProfile(&fdFirVars);
+#endif
 
 
 
@@ -119,14 +135,48 @@ void fdFirSetup(struct fdFirVariables *fdFirVars)
   int inputLength;
   char dataSetString[100];
   char filterSetString[100];
+  char freqFilterString[100];
+  float *freqFilterPtr;
+  int cached;
 
   if(fdFirVars->arguments == 1)
     {
       printf("No dataset provided\n");
-      printf("Usage: fdFir <dataset> \n");
+      printf("Usage: fdFir <dataset> [ols [fftLength] | ola [fftLength] | real | fused | batch]\n");
       exit(-1); /*return ;*/
     }
 
+  fdFirVars->mode = FDFIR_MODE_BLOCK;
+  if(fdFirVars->modeName != NULL)
+    {
+      if(strcmp(fdFirVars->modeName, "ols") == 0)
+	{
+	  fdFirVars->mode = FDFIR_MODE_OLS;
+	}
+      else if(strcmp(fdFirVars->modeName, "ola") == 0)
+	{
+	  fdFirVars->mode = FDFIR_MODE_OLA;
+	}
+      else if(strcmp(fdFirVars->modeName, "real") == 0)
+	{
+	  fdFirVars->mode = FDFIR_MODE_REAL;
+	}
+      else if(strcmp(fdFirVars->modeName, "fused") == 0)
+	{
+	  fdFirVars->mode = FDFIR_MODE_FUSED;
+	}
+      else if(strcmp(fdFirVars->modeName, "batch") == 0)
+	{
+	  fdFirVars->mode = FDFIR_MODE_BATCH;
+	}
+      else
+	{
+	  printf("Unknown mode: %s\n", fdFirVars->modeName);
+	  printf("Usage: fdFir <dataset> [ols [fftLength] | ola [fftLength] | real | fused | batch]\n");
+	  exit(-1);
+	}
+    }
+
 
   sprintf(  dataSetString,"./data/%s-fdFir-input.dat",fdFirVars->dataSet);
   sprintf(filterSetString,"./data/%s-fdFir-filter.dat",fdFirVars->dataSet);
@@ -144,39 +194,116 @@ void fdFirSetup(struct fdFirVariables *fdFirVars)
   fdFirVars->inputLength = fdFirVars->input.size[1];
   fdFirVars->numFilters  = fdFirVars->filter.size[0];
   fdFirVars->filterLength= fdFirVars->filter.size[1];
-  fdFirVars->butterflies = fdFirVars->inputLength / RADIX;  /* Radix 4*/
-  fdFirVars->stride      = fdFirVars->butterflies * 2;      /* cplx data */
   fdFirVars->phases      = computeNumPhases(inputLength);
+  fdFirVars->plan        = NULL;
+  fdFirVars->streams     = NULL;
+  fdFirVars->numThreads  = fdFirThreadProcessors(FDFIR_THREADS);
+#if FDFIR_PROFILE
+  fdFirProfileSetup(fdFirVars);
+#endif
 
-
-  /*  Verify length is a power of 4. */
-  if( !verifyLength(fdFirVars->inputLength) )  /* invalid length*/
+  /*
+    With fewer filters than threads, the threads are started now, so that
+    one long transform may use them all, and its variant is measured on
+    them.  Otherwise each thread filters whole inputs with transforms of
+    its own, and the threads are started after the transforms are made.
+  */
+  if(fdFirUnits(fdFirVars) < fdFirVars->numThreads)
     {
-#ifdef VERBOSE
-      printf("Length is not a power of 4. FFT & iFFT do not \n");
-      printf("non powers of 4. \n");
-#endif
+      fdFirThreadStart(fdFirVars->numThreads);
     }
 
 
   /*
-    allocate some space at twiddlePtr for the twiddle factors
-    I'm about to compute.
+    The block modes transform blocks of a length chosen from the filter,
+    not the whole input, so none of the whole-input setup below is done.
+    The stream of each filter is primed with the end of its input, which
+    needs filterLength-1 <= inputLength.
   */
-  fdFirVars->twiddlePtr      = malloc((2*(inputLength)*sizeof(float)));
-  fdFirVars->twiddleConjPtr  = malloc((2*(inputLength)*sizeof(float)));
+  if(fdFirVars->mode == FDFIR_MODE_OLS || fdFirVars->mode == FDFIR_MODE_OLA)
+    {
+      int filter;
+      int fftLength = (fdFirVars->modeArg != NULL) ? atoi(fdFirVars->modeArg) :
+	fdFirStreamFftLength(fdFirVars->filterLength, inputLength);
+
+      if(fftLength <= 0)
+	{
+	  printf("Invalid FFT length: %s\n", fdFirVars->modeArg);
+	  exit(-1);
+	}
+      if(fdFirVars->filterLength > inputLength + 1)
+	{
+	  printf("Filter (%d taps) is longer than the input\n",
+		 fdFirVars->filterLength);
+	  exit(-1);
+	}
+
+      /*
+	The transformed filters are read from the data set's cache when it
+	matches, else transformed by the streams and saved there.
+      */
+      fdFirVars->blockTransform = fdFirTransformGet(fftLength);
+      sprintf(freqFilterString, "./data/%s-fdFir-freq-%d.dat",
+	      fdFirVars->dataSet, fftLength);
+      freqFilterPtr = malloc(2 * fdFirVars->numFilters * fftLength * sizeof(float));
+      cached = fdFirFreqFilterLoad(freqFilterString, fdFirVars->blockTransform,
+				   fdFirVars->filter.data, fdFirVars->numFilters,
+				   fdFirVars->filterLength, freqFilterPtr);
+
+      fdFirVars->streams = malloc(fdFirVars->numFilters * sizeof(struct fdFirStream));
+      for(filter = 0; filter < fdFirVars->numFilters; filter++)
+	{
+	  fdFirStreamSetup(&fdFirVars->streams[filter], fdFirVars->blockTransform,
+			   fdFirVars->filter.data + (2 * fdFirVars->filterLength * filter),
+			   fdFirVars->filterLength,
+			   fdFirVars->mode == FDFIR_MODE_OLA,
+			   cached ? freqFilterPtr + (2 * fftLength * filter) : NULL);
+	  memcpy(freqFilterPtr + (2 * fftLength * filter),
+		 fdFirVars->streams[filter].freqFilterPtr,
+		 2 * fftLength * sizeof(float));
+	}
+      if(!cached)
+	{
+	  fdFirFreqFilterSave(freqFilterString, fdFirVars->blockTransform,
+			      fdFirVars->filter.data, fdFirVars->numFilters,
+			      fdFirVars->filterLength, freqFilterPtr);
+	}
+      free(freqFilterPtr);
+      fdFirThreadSetup(fdFirVars, fdFirVars->blockTransform);
+      return;
+    }
 
 
   /*
-    Let's create the twiddle factors, and put them at twiddlePtr
+    Get the transform of the whole input from the cache.  Lengths that
+    are not powers of 4 cannot use the radix 4 fft & ifft and always get a
+    mixed-radix plan; for powers of 4 the faster of the two is taken, as
+    measured once and remembered in the wisdom file.  The transform holds
+    the twiddle factors:
          for jj = 0:inputLength-1
             val(jj+1) = (-i*2*pi*jj)/inputLength;
          end
-    This will be done in createTwiddles().  The declaration for this
-    function can be found in fdFir.h while the definition can be
-    found here in fdFir.c
+    laid out per phase by createTwiddles().
   */
-  createTwiddles(fdFirVars->twiddlePtr, fdFirVars->twiddleConjPtr, inputLength);
+  if(fdFirVars->mode == FDFIR_MODE_BATCH && inputLength >= RADIX &&
+     verifyLength(inputLength))
+    {
+      /* The batched butterflies are those of the radix 4 fft & ifft. */
+      fdFirVars->transform  = fdFirTransformGetVariant(inputLength, FDFIR_FFT_RADIX4);
+    }
+  else
+    {
+      fdFirVars->transform  = fdFirTransformGet(inputLength);
+    }
+  fdFirVars->plan           = fdFirVars->transform->plan;
+  fdFirVars->twiddlePtr     = fdFirVars->transform->twiddlePtr;
+  fdFirVars->twiddleConjPtr = fdFirVars->transform->twiddleConjPtr;
+#ifdef VERBOSE
+  if(fdFirVars->plan != NULL)
+    {
+      printf("Using the mixed-radix FFT. \n");
+    }
+#endif
 
 
 
@@ -186,6 +313,78 @@ void fdFirSetup(struct fdFirVariables *fdFirVars)
   */
   createFreqFilter(fdFirVars);
 
+  if(fdFirVars->mode == FDFIR_MODE_REAL)
+    {
+      fdFirRealSetup(fdFirVars);
+    }
+  if(fdFirVars->mode == FDFIR_MODE_FUSED)
+    {
+      fdFirFusedSetup(fdFirVars);
+    }
+  if(fdFirVars->mode == FDFIR_MODE_BATCH)
+    {
+      fdFirBatchSetup(fdFirVars);
+    }
+
+  fdFirThreadSetup(fdFirVars, fdFirVars->transform);
+}
+
+
+
+/*
+  The units of work spread over the threads: the filters, or in the real
+  mode the pairs of filters, or in the batch mode the groups of filters
+  transformed together.
+*/
+static int fdFirUnits(struct fdFirVariables *fdFirVars)
+{
+  if(fdFirVars->mode == FDFIR_MODE_REAL)
+    {
+      return (fdFirVars->numFilters + 1) / 2;
+    }
+  if(fdFirVars->mode == FDFIR_MODE_BATCH)
+    {
+      return (fdFirVars->numFilters + fdFirBatchWidth() - 1) / fdFirBatchWidth();
+    }
+  return fdFirVars->numFilters;
+}
+
+
+
+/*
+  Start the threads, if not started yet, and give each thread the mode's
+  transform.  A transform that keeps scratch of its own (Bluestein's) is
+  copied for every thread but the first.
+*/
+static void fdFirThreadSetup(struct fdFirVariables *fdFirVars,
+			     struct fdFirTransform *transform)
+{
+  int thread;
+
+  fdFirThreadStart(fdFirVars->numThreads);
+
+  fdFirVars->threadTransforms = malloc(fdFirVars->numThreads *
+				       sizeof(struct fdFirTransform *));
+  if(fdFirVars->threadTransforms == NULL)
+    {
+      printf("fdFirThreadSetup: out of memory\n");
+      exit(-1);
+    }
+  for(thread = 0; thread < fdFirVars->numThreads; thread++)
+    {
+      fdFirVars->threadTransforms[thread] = transform;
+      if(thread > 0 && !fdFirTransformShared(transform))
+	{
+	  fdFirVars->threadTransforms[thread] = malloc(sizeof(struct fdFirTransform));
+	  if(fdFirVars->threadTransforms[thread] == NULL)
+	    {
+	      printf("fdFirThreadSetup: out of memory\n");
+	      exit(-1);
+	    }
+	  fdFirTransformSetup(fdFirVars->threadTransforms[thread],
+			      transform->length, transform->variant);
+	}
+    }
 }
 
 
@@ -210,11 +409,6 @@ void fdFirSetup(struct fdFirVariables *fdFirVars)
 */
 void fdFir(struct fdFirVariables *fdFirVars)
 {
-  int filter = 0;
-  float * filterPtr = fdFirVars->freqFilterPtr;
-  float * resultPtrSave = fdFirVars->input.data;
-  float * resultPtr = fdFirVars->input.data;
-
   /*
     I will need a timer to evaluate my functions.  The
     pca_timer_t is located in PcaCTimer.h
@@ -222,9 +416,87 @@ void fdFir(struct fdFirVariables *fdFirVars)
   pca_timer_t t;
   t = startTimer();
 
-  for (filter = 0; filter < fdFirVars->numFilters; filter++)
+  /*
+    The filters are spread over the threads, unless there are fewer of
+    them than threads and the transform is a four-step FFT, which then
+    spreads each transform over the threads instead.
+  */
+  if(fdFirVars->threadTransforms[0]->variant == FDFIR_FFT_FOURSTEP &&
+     fdFirUnits(fdFirVars) < fdFirVars->numThreads)
+    {
+      fdFirFilterJob(fdFirVars, 0, 1);
+    }
+  else
+    {
+      fdFirThreadRun(fdFirFilterJob, fdFirVars);
+    }
+
+  fdFirVars->time.data[0] = stopTimer(t);
+  
+  printf("Done.  Latency: %f s.\n", fdFirVars->time.data[0]);
+  
+
+}
+
+
+
+
+
+
+/*
+  fdFirFilterJob filters this thread's share of the bank with the mode's
+  kernel.
+*/
+static void fdFirFilterJob(void *arg, int thread, int numThreads)
+{
+  struct fdFirVariables *fdFirVars = arg;
+  struct fdFirTransform *transform = fdFirVars->threadTransforms[thread];
+  int first, last;
+
+  fdFirThreadRange(fdFirUnits(fdFirVars), thread, numThreads, &first, &last);
+
+  switch(fdFirVars->mode)
+    {
+    case FDFIR_MODE_OLS:
+    case FDFIR_MODE_OLA:
+      fdFirStreamRun(fdFirVars, transform, first, last);
+      break;
+    case FDFIR_MODE_REAL:
+      last = (2 * last < fdFirVars->numFilters) ? 2 * last : fdFirVars->numFilters;
+      fdFirReal(fdFirVars, transform, 2 * first, last);
+      break;
+    case FDFIR_MODE_FUSED:
+      fdFirFused(fdFirVars, transform, first, last);
+      break;
+    case FDFIR_MODE_BATCH:
+      fdFirBatch(fdFirVars, transform, first, last);
+      break;
+    default:
+      fdFirBlock(fdFirVars, transform, first, last);
+      break;
+    }
+}
+
+
+
+
+
+
+/*
+  fdFirBlock filters the input vectors of filters first to last-1 with
+  their filters in the bank, with one FFT of the whole input through
+  'transform' (fdFirVars->transform, or this thread's copy of it).
+*/
+void fdFirBlock(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+		int first, int last)
+{
+  int filter = 0;
+  float * filterPtr = fdFirVars->freqFilterPtr + (2 * fdFirVars->inputLength * first);
+  float * resultPtrSave = fdFirVars->input.data;
+  float * resultPtr = fdFirVars->input.data;
+
+  for (filter = first; filter < last; filter++)
     {
-      fdFirVars->currentFilter = filter;
       resultPtr = resultPtrSave + (2 * fdFirVars->inputLength * (filter));
   /*
     fft does a fast fourier transform on the input.  This input of 
@@ -234,9 +506,15 @@ void fdFir(struct fdFirVariables *fdFirVars)
     fdFirVars  -  pointer to an instance of the fdFirVars class.  See fdFir.h
                 for a definition of the fdFirVars class.
   */
-      fft(fdFirVars->currentFilter, fdFirVars->inputLength, fdFirVars->phases,
-	  fdFirVars->butterflies, fdFirVars->stride, fdFirVars->input.data,
-	  fdFirVars->twiddlePtr);
+      if(transform->variant == FDFIR_FFT_RADIX4)
+	{
+	  fft(filter, fdFirVars->inputLength, transform->phases,
+	      fdFirVars->input.data, transform->twiddlePtr);
+	}
+      else
+	{
+	  fdFirTransformForward(transform, resultPtr);
+	}
 
 
   /*
@@ -273,7 +551,15 @@ void fdFir(struct fdFirVariables *fdFirVars)
       routine.  
   */
   
-  ifft(fdFirVars);
+  if(transform->variant == FDFIR_FFT_RADIX4)
+    {
+      ifft(filter, fdFirVars->inputLength, transform->phases,
+	   fdFirVars->input.data, transform->twiddleConjPtr);
+    }
+  else
+    {
+      fdFirTransformInverse(transform, resultPtr);
+    }
   elDiv(resultPtr,  fdFirVars->inputLength);
 
 
@@ -289,10 +575,6 @@ void fdFir(struct fdFirVariables *fdFirVars)
   
 
     }/*end for filters*/
-  fdFirVars->time.data[0] = stopTimer(t);
-  
-  printf("Done.  Latency: %f s.\n", fdFirVars->time.data[0]);
-  
 
 }
 
@@ -307,6 +589,7 @@ void fdFir(struct fdFirVariables *fdFirVars)
 */
 void fdFirComplete(struct fdFirVariables *fdFirVars)
 {
+  int thread;
   char timeString[100];
   char outputString[100];
   
@@ -320,17 +603,48 @@ void fdFirComplete(struct fdFirVariables *fdFirVars)
   clean_mem(float, fdFirVars->input);
   clean_mem(float, fdFirVars->filter);
   clean_mem(float, fdFirVars->time);
+
+  if(fdFirVars->streams != NULL)
+    {
+      int filter;
+
+      for(filter = 0; filter < fdFirVars->numFilters; filter++)
+	{
+	  fdFirStreamComplete(&fdFirVars->streams[filter]);
+	}
+      free(fdFirVars->streams);
+    }
+  if(fdFirVars->mode == FDFIR_MODE_REAL)
+    {
+      fdFirRealComplete(fdFirVars);
+    }
+  if(fdFirVars->mode == FDFIR_MODE_BATCH)
+    {
+      fdFirBatchComplete(fdFirVars);
+    }
+
+  fdFirThreadStop();
+  for(thread = 1; thread < fdFirVars->numThreads; thread++)
+    {
+      if(fdFirVars->threadTransforms[thread] != fdFirVars->threadTransforms[0])
+	{
+	  fdFirTransformComplete(fdFirVars->threadTransforms[thread]);
+	  free(fdFirVars->threadTransforms[thread]);
+	}
+    }
+  free(fdFirVars->threadTransforms);
+  fdFirTransformCacheFree();
 }
 
 void createFreqFilter(struct fdFirVariables *fdFirVars)
 {
 
   int cnt,cnt2;
-  int butterflies, stride, phases, paddedFilterLength, paddedZeros;
+  int paddedFilterLength, paddedZeros;
   int numFilters   = fdFirVars->filter.size[0];
   int filterLength = fdFirVars->filter.size[1];
   int inputLength  = fdFirVars->input.size[1];
-  float paddedPhases;
+  char freqFilterString[100];
   float* paddedFilterPtr;
   float* paddedFilterPtrSave;
   float* inPtr;
@@ -340,6 +654,22 @@ void createFreqFilter(struct fdFirVariables *fdFirVars)
   /* calculate the length of the new freqFilter.  */
   paddedFilterLength = inputLength;
   paddedZeros = paddedFilterLength - filterLength;
+
+  /*
+    An earlier run on this data set may have saved the frequency domain
+    filters (fdFirFreqFilterSave() below); use them when they were made
+    from the same taps with the same transform.
+  */
+  fdFirVars->freqFilterPtr = malloc((2*numFilters*paddedFilterLength*sizeof(float)));
+  sprintf(freqFilterString, "./data/%s-fdFir-freq-%d.dat",
+	  fdFirVars->dataSet, paddedFilterLength);
+  if(fdFirFreqFilterLoad(freqFilterString, fdFirVars->transform, filterPtr,
+			 numFilters, filterLength, fdFirVars->freqFilterPtr))
+    {
+      fdFirVars->filterLength = paddedFilterLength;
+      return;
+    }
+
   paddedFilterPtr = malloc((2*(numFilters * paddedFilterLength)*sizeof(float)));
   paddedFilterPtrSave = paddedFilterPtr;
   
@@ -367,27 +697,18 @@ void createFreqFilter(struct fdFirVariables *fdFirVars)
   fdFirVars->filterLength = paddedFilterLength;
 
 
-  /* create twiddle factors for this filter fft. */
-  fdFirVars->freqFilterPtr = malloc((2*numFilters*(fdFirVars->filterLength)*sizeof(float)));
-  createFftTwiddles(fdFirVars->freqFilterPtr, fdFirVars->filterLength);
-
-  butterflies = fdFirVars->filterLength / RADIX;  /* Radix 4*/
-  stride      = butterflies * 2;                /* cplx data */
-  phases      = computeNumPhases(fdFirVars->filterLength);
-
-
+  /* the filters are transformed like the inputs. */
   for(cnt = 0; cnt < numFilters; cnt++)
     {
-      fft(cnt, fdFirVars->filterLength, phases,
-	  butterflies, stride, paddedFilterPtr,
-	  fdFirVars->freqFilterPtr);
+      fdFirTransformForward(fdFirVars->transform,
+			    paddedFilterPtr + (cnt*inputLength*2));
     }
   /* The fft results are stored back in paddedFilterPtr.  */
 
   /* 
      We now have freq domain filters of length <inputLength> in paddedFilterPtr.  
-     Remember, the fft's output is base-4 reversed; therefore, a hand base-4 
-     reversal is not necessary.  We do need to copy this into fdFirVars however.
+     Remember, the fft's output is base-4 reversed (digit reversed for the
+     mixed-radix plan); therefore, a hand base-4 reversal is not necessary.  We do need to copy this into fdFirVars however.
   */
 
   for(cnt = 0; cnt < numFilters; cnt++)
@@ -401,7 +722,11 @@ void createFreqFilter(struct fdFirVariables *fdFirVars)
 	  outPtr[(2*cnt2)+1] = inPtr[2*cnt2+1];
 	}
     }
+  free(paddedFilterPtr);
 
+  fdFirFreqFilterSave(freqFilterString, fdFirVars->transform,
+		      fdFirVars->filter.data, numFilters, filterLength,
+		      fdFirVars->freqFilterPtr);
 
 }
 
@@ -411,31 +736,31 @@ void createFreqFilter(struct fdFirVariables *fdFirVars)
 
   /*
     Here, we create the twiddle factors required by the fft & ifft.  These 
-    are depended on the length of the input vector.
-         for jj = 0:inputLength-1
-            val(jj+1) = (-i*2*pi*jj)/inputLength;
+    are depended on the length of the input vector.  They are laid out
+    one phase after another, from the phase whose blocks span the whole
+    input down to the phase whose blocks span 4 elements.  For a block
+    span s with m = s/4 butterflies per block, the phase holds
+         for k = 1:3
+           for jj = 0:m-1
+              val = exp((-i*2*pi*k*jj)/s);
+           end
          end
+    so that fft() and ifft() read the twiddles of consecutive butterflies
+    from consecutive addresses.  The tables of all phases hold
+    2*(inputLength-1) floats.
   */
 void createTwiddles(float *twiddlePtr, float * twiddleConjPtr, int inputLength)
 {
 
   int index;
-  float exponent;
   float * ptrSave = twiddlePtr;
- 
+
   /*  fft twiddle factors */
-  for(index = 0; index < inputLength; index++)
-    {
-      exponent = (2*PI*index)/inputLength; /* w/out the i of course */
-      *twiddlePtr = (float)cos((double)exponent);
-      twiddlePtr++;
-      *twiddlePtr = (float)sin((double)exponent) * -1;
-      twiddlePtr++;
-    }
+  createFftTwiddles(twiddlePtr, inputLength);
 
   twiddlePtr = ptrSave;
   /*  ifft twiddle factors */
-  for(index = 0; index < inputLength; index++)
+  for(index = 0; index < inputLength - 1; index++)
     {
       /*   real  */
       *twiddleConjPtr = *twiddlePtr;
@@ -451,17 +776,23 @@ void createTwiddles(float *twiddlePtr, float * twiddleConjPtr, int inputLength)
 void createFftTwiddles(float *twiddlePtr, int inputLength)
 {
 
-  int index;
-  float exponent;
+  int span, k, index;
+  double exponent;
  
   /*  fft twiddle factors */
-  for(index = 0; index < inputLength; index++)
+  for(span = inputLength; span >= RADIX; span = span / RADIX)
     {
-      exponent = (2*PI*index)/inputLength; /* w/out the i of course */
-      *twiddlePtr = (float)cos((double)exponent);
-      twiddlePtr++;
-      *twiddlePtr = (float)sin((double)exponent) * -1;
-      twiddlePtr++;
+      for(k = 1; k < RADIX; k++)
+	{
+	  for(index = 0; index < span / RADIX; index++)
+	    {
+	      exponent = (2*PI*k*index)/span; /* w/out the i of course */
+	      *twiddlePtr = (float)cos(exponent);
+	      twiddlePtr++;
+	      *twiddlePtr = (float)sin(exponent) * -1;
+	      twiddlePtr++;
+	    }
+	}
     }
 
 }
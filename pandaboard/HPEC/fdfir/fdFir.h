@@ -17,40 +17,213 @@
 #define FDFIR_FREQ_H_
 
 #include "PcaCArray.h"
+#include "fftPlan.h"
 
 /*
   This implementation has only been tested as a RADIX 4.
-  Other RADIX may not work.
+  Other RADIX may not work.  Input lengths that are not powers of 4
+  use the mixed-radix fftPlan instead (fftPlan.c).
 */
 #define RADIX 4
 #define PI 3.1415926535897932384
 
+/*
+  Kernel modes, selected by the optional second command line argument.
+    FDFIR_MODE_BLOCK - each input is transformed as a whole: the FFT
+                       length is inputLength.
+    FDFIR_MODE_OLS   - each input is filtered in blocks through an
+                       fdFirStream, by overlap-save (fdFirStream.c).
+    FDFIR_MODE_OLA   - as FDFIR_MODE_OLS, by overlap-add.
+    FDFIR_MODE_REAL  - as FDFIR_MODE_BLOCK, for real inputs: the inputs
+                       of two filters share one fft (fdFirReal.c).
+    FDFIR_MODE_FUSED - as FDFIR_MODE_BLOCK, with the filter multiply
+                       between the last fft and first ifft phases, and
+                       1/N folded into the filters (fdFirFused.c).
+    FDFIR_MODE_BATCH - as FDFIR_MODE_BLOCK, transforming several filters
+                       at once, one per vector lane (fdFirBatch.c).
+  The ols and ola modes take an optional FFT length as the third argument;
+  by default it is chosen from filterLength (fdFirStreamFftLength()).
+*/
+#define FDFIR_MODE_BLOCK 0
+#define FDFIR_MODE_OLS   1
+#define FDFIR_MODE_OLA   2
+#define FDFIR_MODE_REAL  3
+#define FDFIR_MODE_FUSED 4
+#define FDFIR_MODE_BATCH 5
+
+/*
+  FFT variants.  A length that is a power of 4 may use either; any other
+  length uses FDFIR_FFT_MIXED.  The variants leave their output in
+  different digit-reversed orders, so frequency-domain data is only valid
+  with the variant that produced it.  A long length with a factor near
+  its square root may also use FDFIR_FFT_FOURSTEP, which splits it into
+  short transforms that stay in cache and can run on several threads.
+  FDFIR_FFT_FFTW, the FFTW3 library in natural order, is offered for
+  every length when built with "make FFTW=1".
+*/
+#define FDFIR_FFT_RADIX4   0  /* fft.c & ifft.c   */
+#define FDFIR_FFT_MIXED    1  /* fftPlan.c        */
+#define FDFIR_FFT_FOURSTEP 2  /* fdFirFourStep.c  */
+#define FDFIR_FFT_FFTW     3  /* fdFirFftw.c      */
+#define FDFIR_FFT_VARIANTS 4
+
+#ifndef FDFIR_FFTW
+#define FDFIR_FFTW 0
+#endif
+
+/*
+  The four-step FFT is offered for lengths of FDFIR_FOURSTEP_MIN points
+  or more.  Its column transforms gather FDFIR_FOURSTEP_BATCH columns at a
+  time, so every row it reads is at least one cache line.
+*/
+#define FDFIR_FOURSTEP_MIN   65536
+#define FDFIR_FOURSTEP_BATCH 8
+
+/*
+  The number of threads fdFir runs on; 0 is one per online processor.
+  Set with "make THREADS=n".
+*/
+#ifndef FDFIR_THREADS
+#define FDFIR_THREADS 0
+#endif
+
+/*
+  A job run by every thread of the pool (fdFirThread.c): 'thread' is 0 to
+  numThreads-1, and the caller of fdFirThreadRun() is thread 0.
+*/
+typedef void (*fdFirJob)(void *arg, int thread, int numThreads);
+
+/*
+  The fastest variant of each length that allows several is measured once
+  for each thread count and recorded in FDFIR_WISDOM_FILE
+  (fdFirTransform.c); each variant is timed for FDFIR_MEASURE_SECONDS.
+*/
+#ifndef FDFIR_WISDOM_FILE
+#define FDFIR_WISDOM_FILE "./data/fdFir-wisdom.dat"
+#endif
+#define FDFIR_WISDOM_MAX      64
+#define FDFIR_MEASURE_SECONDS 0.02
+
+/*
+  "make PROFILE=1" times each stage of the kernel alone after the timed
+  run, for at least FDFIR_PROFILE_SECONDS, and prints its flops, bytes
+  and rates (fdFirProfile.c).
+*/
+#ifndef FDFIR_PROFILE
+#define FDFIR_PROFILE 0
+#endif
+#define FDFIR_PROFILE_SECONDS 0.2
+
+/* FFTW keeps its own wisdom, of the plans it measured, next to ours. */
+#ifndef FDFIR_FFTW_WISDOM_FILE
+#define FDFIR_FFTW_WISDOM_FILE "./data/fdFir-fftw-wisdom.dat"
+#endif
+
+/*
+  An FFT of one length and variant: the radix 4 fft & ifft with their
+  twiddle tables, a mixed-radix plan, or a four-step FFT of length1 *
+  length2 points through the transforms sub1 and sub2.  The four-step
+  twiddlePtr holds exp(-2*pi*i*n2*k1/length) for each column n2 and
+  each position of sub1's output, and frequency1Ptr the frequency k1 of
+  that position.  A library backend keeps its plans in backendPtr.
+  fdFirTransformGet() keeps one per length, linked through 'next'.
+*/
+struct fdFirTransform{
+  int   length;
+  int   variant;
+  int   phases;
+  float *twiddlePtr;
+  float *twiddleConjPtr;
+  struct fftPlan *plan;  /* FDFIR_FFT_MIXED only */
+  int   length1;
+  int   length2;
+  struct fdFirTransform *sub1;  /* FDFIR_FFT_FOURSTEP only, not owned */
+  struct fdFirTransform *sub2;
+  int   *frequency1Ptr;
+  void  *backendPtr;     /* FDFIR_FFT_FFTW only */
+  struct fdFirTransform *next;
+};
+
+/*
+  The FFT backend of each variant (fdFirTransform.c): 'accepts' tells the
+  lengths it can plan, 'plan' prepares a transform of one of them,
+  'forward' and 'inverse' run it on one interleaved complex vector in
+  place, and 'destroy' frees what 'plan' allocated.  The inverse takes the
+  forward output back to natural order and is not scaled.
+*/
+struct fdFirFftBackend{
+  const char *name;
+  int  (*accepts)(int length);
+  void (*plan)(struct fdFirTransform *transform, int length);
+  void (*forward)(struct fdFirTransform *transform, float *dataPtr);
+  void (*inverse)(struct fdFirTransform *transform, float *dataPtr);
+  void (*destroy)(struct fdFirTransform *transform);
+};
+
+/*
+  A frequency-domain FIR filter for continuous, block by block filtering.
+  Each call to fdFirStreamProcess() consumes up to blockLength samples and
+  produces as many; the filter is transformed once, at fftLength, in
+  fdFirStreamSetup() and reused by every block.
+    overlap-save - the last filterLength-1 input samples are carried in
+                   historyPtr and transformed again in front of each new
+                   block; the first filterLength-1 outputs are discarded.
+    overlap-add  - each block is zero padded and transformed alone; the
+                   filterLength-1 outputs that run past its end are
+                   carried in historyPtr and added to the next block.
+*/
+struct fdFirStream{
+  struct fdFirTransform *transform;  /* fftLength transform (not owned) */
+  float *freqFilterPtr;  /* fftLength complex: the transformed filter    */
+  float *historyPtr;     /* filterLength-1 complex samples               */
+  float *workPtr;        /* fftLength complex of scratch                 */
+  int   filterLength;
+  int   fftLength;
+  int   blockLength;     /* fftLength - filterLength + 1                 */
+  int   overlapAdd;      /* 0: overlap-save, 1: overlap-add              */
+};
+
 struct fdFirVariables{
   PcaCArrayFloat input;
   PcaCArrayFloat filter;
   PcaCArrayFloat time;
   float *freqFilterPtr;
-  float *twiddlePtr;
+  struct fdFirTransform *transform;  /* the FFT of the whole input      */
+  float *twiddlePtr;                 /* transform's, when radix 4       */
   float *twiddleConjPtr;
+  struct fftPlan *plan;              /* transform's, NULL when radix 4 */
   int   inputLength;
   int   numFilters;
   int   filterLength;
-  int   currentFilter;
-  int   butterflies;
   int   phases;
-  int   stride;
   int   arguments;
+  int   mode;
+  struct fdFirTransform *blockTransform; /* the FFT of the block modes */
+  struct fdFirStream *streams;           /* one per filter             */
+  int   numThreads;
+  struct fdFirTransform **threadTransforms; /* the mode's FFT, per thread */
+  int   *mirrorPtr;    /* real mode: position of frequency N-k          */
+  int   *realPairPtr;  /* real mode: 1 when both filters of a pair are real */
+  float *batchFilterPtr; /* batch mode: the filters, interleaved & scaled */
+  float *profileInputPtr; /* FDFIR_PROFILE: a copy of the inputs        */
   char  *dataSet;
-}fdFirVars; 
+  char  *modeName;
+  char  *modeArg;
+};
+
+/* Defined in the file with main. */
+extern struct fdFirVariables fdFirVars;
 
 void fdFirSetup(struct fdFirVariables *fdFirVars);
 void fdFir(struct fdFirVariables *fdFirVars);
+void fdFirBlock(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+		int first, int last);
 void fdFirComplete(struct fdFirVariables *fdFirVars);
 void fft(int filter, int inputLength, int phases,
-	 int butterflies, int stride, float * inputData,
-	 float * twiddlePtr);
+	 float * inputData, float * twiddlePtr);
 void elMul(float *dataPtr, float *filterPtr, int inputLength);
-void ifft(struct fdFirVariables *fdFirVars);
+void ifft(int filter, int inputLength, int phases,
+	  float * inputData, float * twiddleConjPtr);
 void elDiv(float *dataPtr, int inputLength);
 void createTwiddles(float * twiddlePtr, float * twiddleConjPtr, int inputLength);
 void createFftTwiddles(float *twiddlePtr, int inputLength);
@@ -58,6 +231,74 @@ void createFreqFilter(struct fdFirVariables *fdFirVars);
 int  computeNumPhases(int inputLength);
 int verifyLength(int inputLength);
 
+void fdFirTransformSetup(struct fdFirTransform *transform, int length,
+			 int variant);
+void fdFirTransformForward(struct fdFirTransform *transform, float *dataPtr);
+void fdFirTransformInverse(struct fdFirTransform *transform, float *dataPtr);
+void fdFirTransformComplete(struct fdFirTransform *transform);
+int  fdFirTransformFrequency(struct fdFirTransform *transform, int position);
+int  fdFirTransformShared(struct fdFirTransform *transform);
+struct fdFirTransform *fdFirTransformGet(int length);
+struct fdFirTransform *fdFirTransformGetVariant(int length, int variant);
+void fdFirTransformCacheFree(void);
+int  fdFirFreqFilterLoad(char *fileName, struct fdFirTransform *transform,
+			 float *filterPtr, int numFilters, int filterLength,
+			 float *freqFilterPtr);
+void fdFirFreqFilterSave(char *fileName, struct fdFirTransform *transform,
+			 float *filterPtr, int numFilters, int filterLength,
+			 float *freqFilterPtr);
+int  fdFirStreamFftLength(int filterLength, int inputLength);
+void fdFirStreamSetup(struct fdFirStream *stream, struct fdFirTransform *transform,
+		      float *filterPtr, int filterLength, int overlapAdd,
+		      float *freqFilterPtr);
+void fdFirStreamReset(struct fdFirStream *stream);
+void fdFirStreamPrime(struct fdFirStream *stream, float *samplePtr);
+void fdFirStreamProcess(struct fdFirStream *stream, float *blockPtr,
+			float *resultPtr, int count);
+void fdFirStreamComplete(struct fdFirStream *stream);
+void fdFirStreamRun(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+		    int first, int last);
+void fdFirRealSetup(struct fdFirVariables *fdFirVars);
+void fdFirReal(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+	       int first, int last);
+void fdFirRealComplete(struct fdFirVariables *fdFirVars);
+void fdFirFusedSetup(struct fdFirVariables *fdFirVars);
+void fftFused(int inputLength, int phases, float *dataPtr, float *twiddlePtr,
+	      float *twiddleConjPtr, float *filterPtr);
+void fdFirFused(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+		int first, int last);
+int  fdFirBatchWidth(void);
+void fdFirBatchSetup(struct fdFirVariables *fdFirVars);
+void fftBatch(int inputLength, int phases, float *dataPtr, float *twiddlePtr);
+void ifftBatch(int inputLength, int phases, float *dataPtr, float *twiddleConjPtr);
+void elMulBatch(float *dataPtr, float *filterPtr, int inputLength);
+void fdFirBatch(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+		int first, int last);
+void fdFirBatchComplete(struct fdFirVariables *fdFirVars);
+int  fdFirFourStepSplit(int length);
+void fdFirFourStepSetup(struct fdFirTransform *transform, int length);
+void fdFirFourStepForward(struct fdFirTransform *transform, float *dataPtr);
+void fdFirFourStepInverse(struct fdFirTransform *transform, float *dataPtr);
+void fdFirFourStepComplete(struct fdFirTransform *transform);
+int  fdFirFftwAccepts(int length);
+void fdFirFftwSetup(struct fdFirTransform *transform, int length);
+void fdFirFftwForward(struct fdFirTransform *transform, float *dataPtr);
+void fdFirFftwInverse(struct fdFirTransform *transform, float *dataPtr);
+void fdFirFftwComplete(struct fdFirTransform *transform);
+double fdFirProfileFlops(struct fdFirTransform *transform);
+double fdFirProfileBytes(struct fdFirTransform *transform);
+void fdFirProfileSetup(struct fdFirVariables *fdFirVars);
+void fdFirProfile(struct fdFirVariables *fdFirVars);
+int  fdFirThreadProcessors(int numThreads);
+void fdFirThreadStart(int numThreads);
+int  fdFirThreadCount(void);
+void fdFirThreadRun(fdFirJob job, void *arg);
+void fdFirThreadRange(int count, int thread, int numThreads, int *first, int *last);
+void fdFirThreadReserve(int floats);
+float *fdFirThreadScratch(void);
+double fdFirThreadSeconds(void);
+void fdFirThreadStop(void);
+
 
 #define CPLX_MUL(ar,ai,br,bi) { \
 float temp_r = ar;              \
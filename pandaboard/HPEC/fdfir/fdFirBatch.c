@@ -0,0 +1,327 @@
+/******************************************************************************
+** File: fdFirBatch.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the batched mode of the FDFIR filter bank,
+**           for many short transforms.  The butterflies of fft.c and
+**           ifft.c are vectorized within one transform, which leaves
+**           little to do in parallel when the transform is short.  Here
+**           FFT_BATCH_WIDTH filters are transformed together instead: the
+**           group's inputs are interleaved so that element n holds the
+**           real parts of every filter of the group, then the imaginary
+**           parts,
+**             [re0 re1 .. reW-1 im0 im1 .. imW-1]
+**           and each butterfly does all W lanes with one vector
+**           instruction per operation, the twiddle factors being the same
+**           in every lane (fftSimd.h).  The multiply by the filters is
+**           vectorized the same way, and the 1/N of the ifft is folded
+**           into the filters in setup, as in the fused mode.
+**
+**           The order of the outputs is that of fft() and ifft(), so the
+**           frequency-domain filters of createFreqFilter() are used as
+**           they are, only interleaved.
+**
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "fdFir.h"
+#include "fftSimd.h"
+
+#define W FFT_BATCH_WIDTH
+
+
+/*
+  fdFirBatchSetup interleaves the frequency-domain filters, W to a group,
+  and scales them by 1/inputLength.  Lanes past the last filter are zero.
+  Without a radix 4 transform the mode filters one input at a time.
+  Runs after createFreqFilter().
+*/
+void fdFirBatchSetup(struct fdFirVariables *fdFirVars)
+{
+  int group, lane, index, filter;
+  int inputLength = fdFirVars->inputLength;
+  int numGroups   = (fdFirVars->numFilters + W - 1) / W;
+  float *groupPtr, *filterPtr;
+
+  fdFirVars->batchFilterPtr = NULL;
+  if(fdFirVars->transform->variant != FDFIR_FFT_RADIX4)
+    {
+      return;
+    }
+
+  fdFirVars->batchFilterPtr = calloc(2 * W * numGroups * inputLength, sizeof(float));
+  if(fdFirVars->batchFilterPtr == NULL)
+    {
+      printf("fdFirBatchSetup: out of memory\n");
+      exit(-1);
+    }
+
+  for(group = 0; group < numGroups; group++)
+    {
+      groupPtr = fdFirVars->batchFilterPtr + (2 * W * inputLength * group);
+      for(lane = 0; lane < W; lane++)
+	{
+	  filter = group * W + lane;
+	  if(filter >= fdFirVars->numFilters)
+	    {
+	      break;
+	    }
+	  filterPtr = fdFirVars->freqFilterPtr + (2 * inputLength * filter);
+	  for(index = 0; index < inputLength; index++)
+	    {
+	      groupPtr[2 * W * index + lane]     = filterPtr[2 * index] / inputLength;
+	      groupPtr[2 * W * index + W + lane] = filterPtr[2 * index + 1] / inputLength;
+	    }
+	}
+    }
+
+  /* One group of inputs, interleaved, per thread. */
+  fdFirThreadReserve(2 * W * inputLength);
+}
+
+
+
+/*
+  fftBatch is fft() on W interleaved vectors: the same phases, blocks and
+  twiddle factors, each lane a different vector.
+*/
+void fftBatch(int inputLength, int phases, float *dataPtr, float *twiddlePtr)
+{
+  int span = inputLength;
+  int m, phase, block, j;
+  float *ptr;
+  float *w1Ptr, *w2Ptr, *w3Ptr;
+  fftBatchVec ar, ai, br, bi, cr, ci, dr, di;
+  fftBatchVec t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
+
+  for(phase = 0; phase < phases; phase++)
+    {
+      m     = span / RADIX;
+      w1Ptr = twiddlePtr;
+      w2Ptr = w1Ptr + 2 * m;
+      w3Ptr = w2Ptr + 2 * m;
+
+      for(block = 0; block < inputLength; block += span)
+	{
+	  for(j = 0; j < m; j++)
+	    {
+	      ptr = dataPtr + 2 * W * (block + j);
+	      ar = FFT_BATCH_LOAD(ptr);
+	      ai = FFT_BATCH_LOAD(ptr + W);
+	      br = FFT_BATCH_LOAD(ptr + 2 * W * m);
+	      bi = FFT_BATCH_LOAD(ptr + 2 * W * m + W);
+	      cr = FFT_BATCH_LOAD(ptr + 4 * W * m);
+	      ci = FFT_BATCH_LOAD(ptr + 4 * W * m + W);
+	      dr = FFT_BATCH_LOAD(ptr + 6 * W * m);
+	      di = FFT_BATCH_LOAD(ptr + 6 * W * m + W);
+
+	      t1r = FFT_BATCH_ADD(ar, cr);
+	      t1i = FFT_BATCH_ADD(ai, ci);
+	      t2r = FFT_BATCH_ADD(br, dr);
+	      t2i = FFT_BATCH_ADD(bi, di);
+	      t3r = FFT_BATCH_SUB(ar, cr);
+	      t3i = FFT_BATCH_SUB(ai, ci);
+	      t4r = FFT_BATCH_SUB(bi, di);
+	      t4i = FFT_BATCH_SUB(dr, br);
+
+	      ar = FFT_BATCH_ADD(t1r, t2r);
+	      ai = FFT_BATCH_ADD(t1i, t2i);
+	      br = FFT_BATCH_ADD(t3r, t4r);
+	      bi = FFT_BATCH_ADD(t3i, t4i);
+	      cr = FFT_BATCH_SUB(t1r, t2r);
+	      ci = FFT_BATCH_SUB(t1i, t2i);
+	      dr = FFT_BATCH_SUB(t3r, t4r);
+	      di = FFT_BATCH_SUB(t3i, t4i);
+
+	      if(m > 1)
+		{
+		  FFT_BATCH_CMUL(br, bi, FFT_BATCH_SPLAT(w1Ptr[2 * j]),
+				 FFT_BATCH_SPLAT(w1Ptr[2 * j + 1]));
+		  FFT_BATCH_CMUL(cr, ci, FFT_BATCH_SPLAT(w2Ptr[2 * j]),
+				 FFT_BATCH_SPLAT(w2Ptr[2 * j + 1]));
+		  FFT_BATCH_CMUL(dr, di, FFT_BATCH_SPLAT(w3Ptr[2 * j]),
+				 FFT_BATCH_SPLAT(w3Ptr[2 * j + 1]));
+		}
+
+	      FFT_BATCH_STORE(ptr, ar);
+	      FFT_BATCH_STORE(ptr + W, ai);
+	      FFT_BATCH_STORE(ptr + 2 * W * m, br);
+	      FFT_BATCH_STORE(ptr + 2 * W * m + W, bi);
+	      FFT_BATCH_STORE(ptr + 4 * W * m, cr);
+	      FFT_BATCH_STORE(ptr + 4 * W * m + W, ci);
+	      FFT_BATCH_STORE(ptr + 6 * W * m, dr);
+	      FFT_BATCH_STORE(ptr + 6 * W * m + W, di);
+	    }
+	}
+
+      twiddlePtr = twiddlePtr + 6 * m;
+      span = m;
+    }
+}
+
+
+
+/*
+  ifftBatch is ifft() on W interleaved vectors.
+*/
+void ifftBatch(int inputLength, int phases, float *dataPtr, float *twiddleConjPtr)
+{
+  int span = RADIX;
+  int m, phase, block, j;
+  float *ptr;
+  float *w1Ptr, *w2Ptr, *w3Ptr;
+  fftBatchVec ar, ai, br, bi, cr, ci, dr, di;
+  fftBatchVec t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
+
+  for(phase = phases - 1; phase >= 0; phase--)
+    {
+      m     = span / RADIX;
+      w1Ptr = twiddleConjPtr + 2 * (inputLength - span);
+      w2Ptr = w1Ptr + 2 * m;
+      w3Ptr = w2Ptr + 2 * m;
+
+      for(block = 0; block < inputLength; block += span)
+	{
+	  for(j = 0; j < m; j++)
+	    {
+	      ptr = dataPtr + 2 * W * (block + j);
+	      ar = FFT_BATCH_LOAD(ptr);
+	      ai = FFT_BATCH_LOAD(ptr + W);
+	      br = FFT_BATCH_LOAD(ptr + 2 * W * m);
+	      bi = FFT_BATCH_LOAD(ptr + 2 * W * m + W);
+	      cr = FFT_BATCH_LOAD(ptr + 4 * W * m);
+	      ci = FFT_BATCH_LOAD(ptr + 4 * W * m + W);
+	      dr = FFT_BATCH_LOAD(ptr + 6 * W * m);
+	      di = FFT_BATCH_LOAD(ptr + 6 * W * m + W);
+
+	      if(m > 1)
+		{
+		  FFT_BATCH_CMUL(br, bi, FFT_BATCH_SPLAT(w1Ptr[2 * j]),
+				 FFT_BATCH_SPLAT(w1Ptr[2 * j + 1]));
+		  FFT_BATCH_CMUL(cr, ci, FFT_BATCH_SPLAT(w2Ptr[2 * j]),
+				 FFT_BATCH_SPLAT(w2Ptr[2 * j + 1]));
+		  FFT_BATCH_CMUL(dr, di, FFT_BATCH_SPLAT(w3Ptr[2 * j]),
+				 FFT_BATCH_SPLAT(w3Ptr[2 * j + 1]));
+		}
+
+	      t1r = FFT_BATCH_ADD(ar, cr);
+	      t1i = FFT_BATCH_ADD(ai, ci);
+	      t2r = FFT_BATCH_ADD(br, dr);
+	      t2i = FFT_BATCH_ADD(bi, di);
+	      t3r = FFT_BATCH_SUB(ar, cr);
+	      t3i = FFT_BATCH_SUB(ai, ci);
+	      t4r = FFT_BATCH_SUB(bi, di);
+	      t4i = FFT_BATCH_SUB(dr, br);
+
+	      FFT_BATCH_STORE(ptr, FFT_BATCH_ADD(t1r, t2r));
+	      FFT_BATCH_STORE(ptr + W, FFT_BATCH_ADD(t1i, t2i));
+	      FFT_BATCH_STORE(ptr + 2 * W * m, FFT_BATCH_SUB(t3r, t4r));
+	      FFT_BATCH_STORE(ptr + 2 * W * m + W, FFT_BATCH_SUB(t3i, t4i));
+	      FFT_BATCH_STORE(ptr + 4 * W * m, FFT_BATCH_SUB(t1r, t2r));
+	      FFT_BATCH_STORE(ptr + 4 * W * m + W, FFT_BATCH_SUB(t1i, t2i));
+	      FFT_BATCH_STORE(ptr + 6 * W * m, FFT_BATCH_ADD(t3r, t4r));
+	      FFT_BATCH_STORE(ptr + 6 * W * m + W, FFT_BATCH_ADD(t3i, t4i));
+	    }
+	}
+
+      span = span * RADIX;
+    }
+}
+
+
+
+/*
+  elMulBatch is elMul() on W interleaved vectors and filters.
+*/
+void elMulBatch(float *dataPtr, float *filterPtr, int inputLength)
+{
+  int index;
+  fftBatchVec ar, ai;
+
+  for(index = 0; index < inputLength; index++)
+    {
+      ar = FFT_BATCH_LOAD(dataPtr);
+      ai = FFT_BATCH_LOAD(dataPtr + W);
+      FFT_BATCH_CMUL(ar, ai, FFT_BATCH_LOAD(filterPtr), FFT_BATCH_LOAD(filterPtr + W));
+      FFT_BATCH_STORE(dataPtr, ar);
+      FFT_BATCH_STORE(dataPtr + W, ai);
+
+      dataPtr   = dataPtr + 2 * W;
+      filterPtr = filterPtr + 2 * W;
+    }
+}
+
+
+
+/*
+  fdFirBatch filters groups first to last-1 of W inputs each, in place.
+  Each group is interleaved into the thread's scratch, filtered, and
+  written back; lanes past the last filter carry zeros.
+*/
+void fdFirBatch(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+		int first, int last)
+{
+  int group, lane, lanes, index;
+  int inputLength = fdFirVars->inputLength;
+  float *batchPtr = fdFirThreadScratch();
+  float *inputPtr;
+
+  if(fdFirVars->batchFilterPtr == NULL)
+    {
+      first = first * W;
+      last  = (last * W < fdFirVars->numFilters) ? last * W : fdFirVars->numFilters;
+      fdFirBlock(fdFirVars, transform, first, last);
+      return;
+    }
+
+  for(group = first; group < last; group++)
+    {
+      lanes = fdFirVars->numFilters - group * W;
+      lanes = (lanes < W) ? lanes : W;
+      inputPtr = fdFirVars->input.data + (2 * inputLength * W * group);
+
+      for(index = 0; index < inputLength; index++)
+	{
+	  for(lane = 0; lane < W; lane++)
+	    {
+	      batchPtr[2 * W * index + lane] = (lane < lanes) ?
+		inputPtr[2 * (lane * inputLength + index)] : 0;
+	      batchPtr[2 * W * index + W + lane] = (lane < lanes) ?
+		inputPtr[2 * (lane * inputLength + index) + 1] : 0;
+	    }
+	}
+
+      fftBatch(inputLength, transform->phases, batchPtr, transform->twiddlePtr);
+      elMulBatch(batchPtr, fdFirVars->batchFilterPtr + (2 * W * inputLength * group),
+		 inputLength);
+      ifftBatch(inputLength, transform->phases, batchPtr, transform->twiddleConjPtr);
+
+      for(index = 0; index < inputLength; index++)
+	{
+	  for(lane = 0; lane < lanes; lane++)
+	    {
+	      inputPtr[2 * (lane * inputLength + index)]     = batchPtr[2 * W * index + lane];
+	      inputPtr[2 * (lane * inputLength + index) + 1] = batchPtr[2 * W * index + W + lane];
+	    }
+	}
+    }
+}
+
+
+
+void fdFirBatchComplete(struct fdFirVariables *fdFirVars)
+{
+  free(fdFirVars->batchFilterPtr);
+}
+
+
+
+/* The number of filters transformed together. */
+int fdFirBatchWidth(void)
+{
+  return W;
+}
@@ -0,0 +1,158 @@
+/******************************************************************************
+** File: fdFirFftw.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the FFTW3 backend of the FDFIR filter bank,
+**           built when FDFIR_FFTW is 1 ("make FFTW=1", which links
+**           libfftw3f).  It accepts every length, and is measured against
+**           the in-house transforms like any other variant, so the wisdom
+**           file records, per length, whether the library or fft.c and
+**           ifft.c is faster on this machine; VERBOSE prints the times.
+**
+**           Each transform holds four in-place plans: forward and inverse,
+**           for vectors with the alignment FFTW's SIMD code wants and for
+**           any other.  They are made with FDFIR_FFTW_FLAGS in setup, and
+**           run with fftwf_execute_dft(), which may be called from several
+**           threads at once.  FFTW's own wisdom is kept in
+**           FDFIR_FFTW_WISDOM_FILE, so only the first run measures plans.
+**           FFTW's output is in natural order, and its inverse is not
+**           scaled, as for the other variants.
+**
+**           Without FDFIR_FFTW the backend accepts no length.
+**
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "fdFir.h"
+
+#if FDFIR_FFTW
+
+#include <fftw3.h>
+
+#ifndef FDFIR_FFTW_FLAGS
+#define FDFIR_FFTW_FLAGS FFTW_MEASURE
+#endif
+
+/* The plans of one transform, in backendPtr. */
+struct fdFirFftwPlans{
+  fftwf_plan forward;
+  fftwf_plan inverse;
+  fftwf_plan forwardUnaligned;
+  fftwf_plan inverseUnaligned;
+};
+
+static int fdFirFftwWisdomLoaded = 0;
+
+
+
+int fdFirFftwAccepts(int length)
+{
+  return length > 0;
+}
+
+
+
+/*
+  fdFirFftwSetup plans a transform of 'length' points.  Planning may
+  overwrite the array it plans on, so it plans on its own.
+*/
+void fdFirFftwSetup(struct fdFirTransform *transform, int length)
+{
+  struct fdFirFftwPlans *plans = malloc(sizeof(struct fdFirFftwPlans));
+  fftwf_complex *dataPtr = fftwf_malloc(length * sizeof(fftwf_complex));
+
+  if(plans == NULL || dataPtr == NULL)
+    {
+      printf("fdFirFftwSetup: out of memory\n");
+      exit(-1);
+    }
+
+  if(!fdFirFftwWisdomLoaded)
+    {
+      fdFirFftwWisdomLoaded = 1;
+      fftwf_import_wisdom_from_filename(FDFIR_FFTW_WISDOM_FILE);
+    }
+
+  plans->forward = fftwf_plan_dft_1d(length, dataPtr, dataPtr, FFTW_FORWARD,
+				     FDFIR_FFTW_FLAGS);
+  plans->inverse = fftwf_plan_dft_1d(length, dataPtr, dataPtr, FFTW_BACKWARD,
+				     FDFIR_FFTW_FLAGS);
+  plans->forwardUnaligned = fftwf_plan_dft_1d(length, dataPtr, dataPtr, FFTW_FORWARD,
+					      FDFIR_FFTW_FLAGS | FFTW_UNALIGNED);
+  plans->inverseUnaligned = fftwf_plan_dft_1d(length, dataPtr, dataPtr, FFTW_BACKWARD,
+					      FDFIR_FFTW_FLAGS | FFTW_UNALIGNED);
+  fftwf_free(dataPtr);
+
+  /* Failing to write FFTW's wisdom only means the next run plans again. */
+  fftwf_export_wisdom_to_filename(FDFIR_FFTW_WISDOM_FILE);
+
+  if(plans->forward == NULL || plans->inverse == NULL ||
+     plans->forwardUnaligned == NULL || plans->inverseUnaligned == NULL)
+    {
+      printf("fdFirFftwSetup: FFTW cannot plan length %d\n", length);
+      exit(-1);
+    }
+  transform->backendPtr = plans;
+}
+
+
+
+void fdFirFftwForward(struct fdFirTransform *transform, float *dataPtr)
+{
+  struct fdFirFftwPlans *plans = transform->backendPtr;
+
+  fftwf_execute_dft(fftwf_alignment_of(dataPtr) == 0 ? plans->forward :
+		    plans->forwardUnaligned,
+		    (fftwf_complex *)dataPtr, (fftwf_complex *)dataPtr);
+}
+
+void fdFirFftwInverse(struct fdFirTransform *transform, float *dataPtr)
+{
+  struct fdFirFftwPlans *plans = transform->backendPtr;
+
+  fftwf_execute_dft(fftwf_alignment_of(dataPtr) == 0 ? plans->inverse :
+		    plans->inverseUnaligned,
+		    (fftwf_complex *)dataPtr, (fftwf_complex *)dataPtr);
+}
+
+void fdFirFftwComplete(struct fdFirTransform *transform)
+{
+  struct fdFirFftwPlans *plans = transform->backendPtr;
+
+  fftwf_destroy_plan(plans->forward);
+  fftwf_destroy_plan(plans->inverse);
+  fftwf_destroy_plan(plans->forwardUnaligned);
+  fftwf_destroy_plan(plans->inverseUnaligned);
+  free(plans);
+}
+
+#else /* FDFIR_FFTW */
+
+int fdFirFftwAccepts(int length)
+{
+  return 0;
+}
+
+void fdFirFftwSetup(struct fdFirTransform *transform, int length)
+{
+  printf("fdFirFftwSetup: built without FFTW (make FFTW=1)\n");
+  exit(-1);
+}
+
+void fdFirFftwForward(struct fdFirTransform *transform, float *dataPtr)
+{
+}
+
+void fdFirFftwInverse(struct fdFirTransform *transform, float *dataPtr)
+{
+}
+
+void fdFirFftwComplete(struct fdFirTransform *transform)
+{
+}
+
+#endif /* FDFIR_FFTW */
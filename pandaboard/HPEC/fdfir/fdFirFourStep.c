@@ -0,0 +1,260 @@
+/******************************************************************************
+** File: fdFirFourStep.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the four-step FFT of the FDFIR filter bank,
+**           for single transforms too long to stay in cache.  A length
+**           N = N1*N2 is viewed as an N1 x N2 matrix, x[n1][n2] =
+**           x[N2*n1 + n2], and
+**             1. each column is transformed (N1 points),
+**             2. element [k1][n2] is multiplied by exp(-2*pi*i*n2*k1/N),
+**             3. each row is transformed (N2 points),
+**           which leaves X[k1 + N1*k2] at [k1][k2].  N1 is the largest
+**           factor of N no greater than its square root, so every short
+**           transform fits in L1 or L2.  The columns are gathered
+**           FDFIR_FOURSTEP_BATCH at a time into the thread's scratch and
+**           scattered back; the rows are transformed in place.  The
+**           columns of step 1 and the rows of step 3 are independent, and
+**           each step is spread over the thread pool (fdFirThread.c).
+**
+**           As with the other variants the output is not reordered: k1
+**           and k2 are in the digit-reversed orders of the short
+**           transforms, the inverse takes them back to natural order, and
+**           the inverse is not scaled.
+**
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "fdFir.h"
+
+/* One step of one transform, as passed to every thread. */
+struct fdFirFourStepJob{
+  struct fdFirTransform *transform;
+  float *dataPtr;
+  int   inverse;
+};
+
+
+
+/*
+  fdFirFourStepSplit returns N1 for a four-step FFT of 'length', or 0 when
+  the length is too short or has a prime factor that would need
+  Bluestein's algorithm in a short transform.
+*/
+int fdFirFourStepSplit(int length)
+{
+  int factor, remainder = length;
+  int length1 = 0;
+
+  if(length < FDFIR_FOURSTEP_MIN)
+    {
+      return 0;
+    }
+
+  for(factor = 2; factor * factor <= remainder; factor++)
+    {
+      while(remainder % factor == 0)
+	{
+	  if(factor > FFTPLAN_MAX_RADIX)
+	    {
+	      return 0;
+	    }
+	  remainder = remainder / factor;
+	}
+    }
+  if(remainder > FFTPLAN_MAX_RADIX)
+    {
+      return 0;
+    }
+
+  for(factor = 1; factor * factor <= length; factor++)
+    {
+      if(length % factor == 0)
+	{
+	  length1 = factor;
+	}
+    }
+  return length1;
+}
+
+
+
+/*
+  fdFirFourStepSetup prepares a four-step FFT of 'length' points.  The
+  short transforms come from the transform cache, and are shared.
+*/
+void fdFirFourStepSetup(struct fdFirTransform *transform, int length)
+{
+  int n2, position;
+  int length1 = fdFirFourStepSplit(length);
+  int length2 = length / length1;
+  double angle;
+
+  transform->length1 = length1;
+  transform->length2 = length2;
+  transform->sub1    = fdFirTransformGet(length1);
+  transform->sub2    = fdFirTransformGet(length2);
+
+  transform->frequency1Ptr = malloc(length1 * sizeof(int));
+  transform->twiddlePtr    = malloc(2 * length * sizeof(float));
+  if(transform->frequency1Ptr == NULL || transform->twiddlePtr == NULL)
+    {
+      printf("fdFirFourStepSetup: out of memory\n");
+      exit(-1);
+    }
+
+  for(position = 0; position < length1; position++)
+    {
+      transform->frequency1Ptr[position] =
+	fdFirTransformFrequency(transform->sub1, position);
+    }
+
+  /* Stored column by column, in the order step 2 reads it. */
+  for(n2 = 0; n2 < length2; n2++)
+    {
+      for(position = 0; position < length1; position++)
+	{
+	  angle = (2 * PI * (double)n2 * transform->frequency1Ptr[position]) / length;
+	  transform->twiddlePtr[2 * (n2 * length1 + position)]     = (float)cos(angle);
+	  transform->twiddlePtr[2 * (n2 * length1 + position) + 1] = (float)sin(angle) * -1;
+	}
+    }
+
+  fdFirThreadReserve(2 * FDFIR_FOURSTEP_BATCH * length1);
+}
+
+
+
+/*
+  Steps 1 and 2, or their inverse, on this thread's share of the columns.
+*/
+static void fdFirFourStepColumns(void *arg, int thread, int numThreads)
+{
+  struct fdFirFourStepJob *job = arg;
+  struct fdFirTransform *transform = job->transform;
+  int length1 = transform->length1;
+  int length2 = transform->length2;
+  int numBatches = (length2 + FDFIR_FOURSTEP_BATCH - 1) / FDFIR_FOURSTEP_BATCH;
+  int batch, first, last, column, width, n1, b, index;
+  float *scratchPtr = fdFirThreadScratch();
+  float *dataPtr, *columnPtr, *twiddlePtr;
+
+  fdFirThreadRange(numBatches, thread, numThreads, &first, &last);
+
+  for(batch = first; batch < last; batch++)
+    {
+      column = batch * FDFIR_FOURSTEP_BATCH;
+      width  = length2 - column;
+      if(width > FDFIR_FOURSTEP_BATCH)
+	{
+	  width = FDFIR_FOURSTEP_BATCH;
+	}
+
+      /* Each row of the batch is one or more whole cache lines. */
+      for(n1 = 0; n1 < length1; n1++)
+	{
+	  dataPtr = job->dataPtr + 2 * (n1 * length2 + column);
+	  for(b = 0; b < width; b++)
+	    {
+	      scratchPtr[2 * (b * length1 + n1)]     = dataPtr[2 * b];
+	      scratchPtr[2 * (b * length1 + n1) + 1] = dataPtr[2 * b + 1];
+	    }
+	}
+
+      for(b = 0; b < width; b++)
+	{
+	  columnPtr  = scratchPtr + 2 * b * length1;
+	  twiddlePtr = transform->twiddlePtr + 2 * (column + b) * length1;
+	  if(!job->inverse)
+	    {
+	      fdFirTransformForward(transform->sub1, columnPtr);
+	      elMul(columnPtr, twiddlePtr, length1);
+	    }
+	  else
+	    {
+	      for(index = 0; index < length1; index++)
+		{
+		  CPLX_MUL(columnPtr[2 * index], columnPtr[2 * index + 1],
+			   twiddlePtr[2 * index], -twiddlePtr[2 * index + 1]);
+		}
+	      fdFirTransformInverse(transform->sub1, columnPtr);
+	    }
+	}
+
+      for(n1 = 0; n1 < length1; n1++)
+	{
+	  dataPtr = job->dataPtr + 2 * (n1 * length2 + column);
+	  for(b = 0; b < width; b++)
+	    {
+	      dataPtr[2 * b]     = scratchPtr[2 * (b * length1 + n1)];
+	      dataPtr[2 * b + 1] = scratchPtr[2 * (b * length1 + n1) + 1];
+	    }
+	}
+    }
+}
+
+
+
+/*
+  Step 3, or its inverse, on this thread's share of the rows.
+*/
+static void fdFirFourStepRows(void *arg, int thread, int numThreads)
+{
+  struct fdFirFourStepJob *job = arg;
+  struct fdFirTransform *transform = job->transform;
+  int row, first, last;
+  float *rowPtr;
+
+  fdFirThreadRange(transform->length1, thread, numThreads, &first, &last);
+
+  for(row = first; row < last; row++)
+    {
+      rowPtr = job->dataPtr + 2 * row * transform->length2;
+      if(!job->inverse)
+	{
+	  fdFirTransformForward(transform->sub2, rowPtr);
+	}
+      else
+	{
+	  fdFirTransformInverse(transform->sub2, rowPtr);
+	}
+    }
+}
+
+
+
+void fdFirFourStepForward(struct fdFirTransform *transform, float *dataPtr)
+{
+  struct fdFirFourStepJob job;
+
+  job.transform = transform;
+  job.dataPtr   = dataPtr;
+  job.inverse   = 0;
+  fdFirThreadRun(fdFirFourStepColumns, &job);
+  fdFirThreadRun(fdFirFourStepRows, &job);
+}
+
+void fdFirFourStepInverse(struct fdFirTransform *transform, float *dataPtr)
+{
+  struct fdFirFourStepJob job;
+
+  job.transform = transform;
+  job.dataPtr   = dataPtr;
+  job.inverse   = 1;
+  fdFirThreadRun(fdFirFourStepRows, &job);
+  fdFirThreadRun(fdFirFourStepColumns, &job);
+}
+
+
+
+/* The short transforms belong to the transform cache. */
+void fdFirFourStepComplete(struct fdFirTransform *transform)
+{
+  free(transform->twiddlePtr);
+  free(transform->frequency1Ptr);
+}
@@ -0,0 +1,141 @@
+/******************************************************************************
+** File: fdFirFused.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the fused mode of the FDFIR filter bank.
+**           fdFirBlock() sweeps each vector with every phase of the fft,
+**           once more in elMul(), with every phase of the ifft, and once
+**           more in elDiv().  Here the last phase of the fft, the multiply
+**           by the filter and the first phase of the ifft are done in one
+**           sweep, on four elements at a time, and the 1/N of the ifft is
+**           folded into the filters in setup: three sweeps fewer per
+**           filter.
+**
+******************************************************************************/
+
+#include "fdFir.h"
+
+
+/*
+  fdFirFusedSetup scales the frequency-domain filters by 1/inputLength,
+  once, so that no elDiv() is needed.  Runs after createFreqFilter().
+*/
+void fdFirFusedSetup(struct fdFirVariables *fdFirVars)
+{
+  int index;
+  int count = 2 * fdFirVars->numFilters * fdFirVars->inputLength;
+  float scale = 1.0f / fdFirVars->inputLength;
+
+  for(index = 0; index < count; index++)
+    {
+      fdFirVars->freqFilterPtr[index] = fdFirVars->freqFilterPtr[index] * scale;
+    }
+}
+
+
+
+/*
+  fftFused filters one vector in place: the fft, a multiply by filterPtr
+  (already scaled by 1/inputLength), and the ifft.  The last fft phase and
+  the first ifft phase have blocks of 4 elements and no twiddle factors,
+  so each block is taken through both, and the multiply between them,
+  while it is in registers.
+*/
+void fftFused(int inputLength, int phases, float *dataPtr, float *twiddlePtr,
+	      float *twiddleConjPtr, float *filterPtr)
+{
+  int block;
+  float *ptr, *fPtr;
+  float ar,ai,br,bi,cr,ci,dr,di;
+  float t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
+
+  fft(0, inputLength, phases - 1, dataPtr, twiddlePtr);
+
+  for(block = 0; block < inputLength; block += RADIX)
+    {
+      ptr  = dataPtr + 2 * block;
+      fPtr = filterPtr + 2 * block;
+
+      /* The last fft butterfly. */
+      t1r = ptr[0] + ptr[4];
+      t1i = ptr[1] + ptr[5];
+      t2r = ptr[2] + ptr[6];
+      t2i = ptr[3] + ptr[7];
+      t3r = ptr[0] - ptr[4];
+      t3i = ptr[1] - ptr[5];
+      t4r = ptr[3] - ptr[7];
+      t4i = ptr[6] - ptr[2];
+
+      ar = t1r + t2r;
+      ai = t1i + t2i;
+      br = t3r + t4r;
+      bi = t3i + t4i;
+      cr = t1r - t2r;
+      ci = t1i - t2i;
+      dr = t3r - t4r;
+      di = t3i - t4i;
+
+      /* The filter. */
+      CPLX_MUL(ar, ai, fPtr[0], fPtr[1]);
+      CPLX_MUL(br, bi, fPtr[2], fPtr[3]);
+      CPLX_MUL(cr, ci, fPtr[4], fPtr[5]);
+      CPLX_MUL(dr, di, fPtr[6], fPtr[7]);
+
+      /* The first ifft butterfly. */
+      t1r = ar + cr;
+      t1i = ai + ci;
+      t2r = br + dr;
+      t2i = bi + di;
+      t3r = ar - cr;
+      t3i = ai - ci;
+      t4r = bi - di;
+      t4i = dr - br;
+
+      ptr[0] = t1r + t2r;
+      ptr[1] = t1i + t2i;
+      ptr[2] = t3r - t4r;
+      ptr[3] = t3i - t4i;
+      ptr[4] = t1r - t2r;
+      ptr[5] = t1i - t2i;
+      ptr[6] = t3r + t4r;
+      ptr[7] = t3i + t4i;
+    }
+
+  ifft(0, inputLength, phases - 1, dataPtr, twiddleConjPtr);
+}
+
+
+
+/*
+  fdFirFused filters the input vectors of filters first to last-1 in
+  place.  The mixed-radix and four-step transforms have no fused stage;
+  they still leave out elDiv().
+*/
+void fdFirFused(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+		int first, int last)
+{
+  int filter;
+  int inputLength = fdFirVars->inputLength;
+  float *dataPtr, *filterPtr;
+
+  for(filter = first; filter < last; filter++)
+    {
+      dataPtr   = fdFirVars->input.data + (2 * inputLength * filter);
+      filterPtr = fdFirVars->freqFilterPtr + (2 * inputLength * filter);
+
+      if(transform->variant == FDFIR_FFT_RADIX4)
+	{
+	  fftFused(inputLength, transform->phases, dataPtr, transform->twiddlePtr,
+		   transform->twiddleConjPtr, filterPtr);
+	}
+      else
+	{
+	  fdFirTransformForward(transform, dataPtr);
+	  elMul(dataPtr, filterPtr, inputLength);
+	  fdFirTransformInverse(transform, dataPtr);
+	}
+    }
+}
@@ -4,14 +4,17 @@
 % HPEC Challenge Benchmark Suite
 % FDFIR Dataset Generator Matlab Function 
 %
-% function fdFirGenerator(dataSet, inputSize, filterSize, numFilters)
+% function fdFirGenerator(dataSet, inputSize, filterSize, numFilters, realData)
 %   Generates input data and filters for the generic C kernel
 %   Frequency-domain FIR Filter Bank.
 %
 %   dataSet    - dataSet index to be used to name file
-%   inputSize  - number of input samples (must be a power of 4).
+%   inputSize  - number of input samples (powers of 4 use the radix 4 fft,
+%                other lengths the mixed-radix fftPlan).
 %   filterSize - filter length
 %   numFilters - number of filters in filter bank
+%   realData   - optional; when 1, the inputs and filters are real, for
+%                the real-input mode (fdFir <dataSet> real).  Default 0.
 %
 %   outputs: 1) ./data/<dataSet>-fdFir-input.dat
 %            2) ./data/<dataSet>-fdFir-filter.dat
@@ -22,7 +25,11 @@
 %
 
 
-function fdFirGenerator(dataSet, inputSize, filterSize, numFilters)
+function fdFirGenerator(dataSet, inputSize, filterSize, numFilters, realData)
+
+if nargin < 5
+  realData = 0;
+end
 
 oldpath = path;
 addpath ../matlab;
@@ -50,7 +57,11 @@ disp(['Input  stored in file ' inputFileName]);         %
 INPUT = zeros(numFilters,filterSize);                   %
 for xx = 1:numFilters                                   %
   for yy = 1:inputSize                                  %
-    INPUT(xx,yy) = rand + i*rand;                       %
+    if realData                                         %
+      INPUT(xx,yy) = rand;                              %
+    else                                                %
+      INPUT(xx,yy) = rand + i*rand;                     %
+    end                                                 %
   end                                                   %
 end                                                     %
 writeFile(inputFileName, INPUT, 'float32');             %
@@ -67,7 +78,11 @@ disp(['   of size ' num2str(filterSize)]);                 %
 disp(['Filters stored in file ' filterFileName]);          %
 for yy = 1:numFilters					   %
   for xx=1:filterSize                                      %
-    filter(xx)=rand + i*rand;                              %
+    if realData                                            %
+      filter(xx)=rand;                                     %
+    else                                                   %
+      filter(xx)=rand + i*rand;                            %
+    end                                                    %
   end                                                      %
   filters(yy,:) = filter;                                  %
 end                                                        %
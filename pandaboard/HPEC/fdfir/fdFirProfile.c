@@ -0,0 +1,333 @@
+/******************************************************************************
+** File: fdFirProfile.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the stage profile of the FDFIR filter bank,
+**           built when FDFIR_PROFILE is 1 ("make PROFILE=1").  After the
+**           timed kernel, the four stages of fdFirBlock(), fft, elMul,
+**           ifft and elDiv, are run again one at a time over the whole
+**           bank, on a copy of the inputs and on the threads of the
+**           kernel, and each is timed alone.  For each stage it prints
+**           the flops it executes, the bytes it moves, its time, and the
+**           Mflops and MB/s achieved, so that the time of the FFTs can be
+**           told from that of the element-wise passes.
+**
+**           The flops are those of the current transform as written: each
+**           butterfly with its twiddle multiplies, including those by 1,
+**           and each complex multiply as 6 flops.  FFTW's are not known,
+**           and 5 N log2(N) is used.  The bytes assume that nothing stays
+**           in cache from one pass over a vector to the next: every fft
+**           phase, mixed-radix stage, elMul and elDiv reads and writes the
+**           whole vector, and elMul also reads the filter.  They bound the
+**           memory traffic from above for vectors that fit in cache, and
+**           are close to it for vectors that do not.
+**
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "fdFir.h"
+
+/* The stages, in the order fdFirBlock() runs them. */
+#define FDFIR_STAGE_FFT   0
+#define FDFIR_STAGE_MUL   1
+#define FDFIR_STAGE_IFFT  2
+#define FDFIR_STAGE_DIV   3
+#define FDFIR_STAGES      4
+
+static const char *fdFirStageNames[FDFIR_STAGES] = {"fft", "elMul", "ifft", "elDiv"};
+
+/* One stage over the bank, as passed to every thread. */
+struct fdFirProfileJob{
+  struct fdFirVariables *fdFirVars;
+  float *workPtr;
+  int   length;          /* of each transform          */
+  int   numTransforms;
+  int   numBlocks;       /* per filter, in the ols & ola modes */
+  int   stage;
+};
+
+
+
+/*
+  The flops of one butterfly of a mixed-radix stage of 'radix', its
+  radix-1 twiddle multiplies included (fftPlan.c).
+*/
+static double fdFirProfileButterfly(int radix)
+{
+  switch(radix)
+    {
+    case 2:
+      return 4 + 6;
+    case 3:
+      return 16 + 2 * 6;
+    case 4:
+      return 18 + 3 * 6;
+    case 5:
+      return 52 + 4 * 6;
+    case 8:
+      return 2 * 18 + 14 + 4 * 4 + 7 * 6;
+    default:
+      return 8.0 * radix * radix + (radix - 1) * 6;
+    }
+}
+
+static double fdFirProfilePlanFlops(struct fftPlan *plan)
+{
+  int stage;
+  double flops = 0;
+
+  if(plan->subPlan != NULL)
+    {
+      /* Two chirps, and a convolution through the sub plan. */
+      return 12.0 * plan->length + 2 * fdFirProfilePlanFlops(plan->subPlan) +
+	6.0 * plan->subPlan->length;
+    }
+  for(stage = 0; stage < plan->numFactors; stage++)
+    {
+      flops = flops + ((double)plan->length / plan->factors[stage]) *
+	fdFirProfileButterfly(plan->factors[stage]);
+    }
+  return flops;
+}
+
+static double fdFirProfilePlanBytes(struct fftPlan *plan)
+{
+  double vector = 8.0 * plan->length;
+
+  if(plan->subPlan != NULL)
+    {
+      /* Chirp in and out, the convolution, and elMul with chirpFreqPtr. */
+      return 2 * 3 * vector + 2 * fdFirProfilePlanBytes(plan->subPlan) +
+	3 * 8.0 * plan->subPlan->length;
+    }
+  return plan->numFactors * 2 * vector + vector;
+}
+
+
+
+/*
+  The flops of one forward or inverse transform.  A radix 4 butterfly of
+  fft.c and ifft.c is 16 adds and 3 complex multiplies.
+*/
+double fdFirProfileFlops(struct fdFirTransform *transform)
+{
+  double length = transform->length;
+
+  switch(transform->variant)
+    {
+    case FDFIR_FFT_RADIX4:
+      return transform->phases * (length / RADIX) * (16 + 3 * 6);
+    case FDFIR_FFT_FOURSTEP:
+      return transform->length2 * fdFirProfileFlops(transform->sub1) +
+	6 * length + transform->length1 * fdFirProfileFlops(transform->sub2);
+    case FDFIR_FFT_FFTW:
+      return 5 * length * log(length) / log(2.0);
+    default:
+      return fdFirProfilePlanFlops(transform->plan);
+    }
+}
+
+/*
+  The bytes one forward or inverse transform moves: the vector read and
+  written once per phase or stage, and the twiddles read once.  The
+  four-step FFT also gathers and scatters its columns; FFTW is counted
+  as one pass.
+*/
+double fdFirProfileBytes(struct fdFirTransform *transform)
+{
+  double vector = 8.0 * transform->length;
+
+  switch(transform->variant)
+    {
+    case FDFIR_FFT_RADIX4:
+      return transform->phases * 2 * vector + vector;
+    case FDFIR_FFT_FOURSTEP:
+      return transform->length2 * fdFirProfileBytes(transform->sub1) +
+	transform->length1 * fdFirProfileBytes(transform->sub2) + 5 * vector;
+    case FDFIR_FFT_FFTW:
+      return 2 * vector;
+    default:
+      return fdFirProfilePlanBytes(transform->plan);
+    }
+}
+
+
+
+/*
+  fdFirProfileSetup keeps a copy of the inputs for the profile, since the
+  kernel filters them in place.  Runs in fdFirSetup(), once the inputs
+  are read.
+*/
+void fdFirProfileSetup(struct fdFirVariables *fdFirVars)
+{
+  int count = 2 * fdFirVars->numFilters * fdFirVars->inputLength;
+
+  fdFirVars->profileInputPtr = malloc(count * sizeof(float));
+  if(fdFirVars->profileInputPtr == NULL)
+    {
+      printf("fdFirProfileSetup: out of memory\n");
+      exit(-1);
+    }
+  memcpy(fdFirVars->profileInputPtr, fdFirVars->input.data, count * sizeof(float));
+}
+
+
+
+/*
+  This thread's share of the transforms, through one stage.
+*/
+static void fdFirProfileStage(void *arg, int thread, int numThreads)
+{
+  struct fdFirProfileJob *job = arg;
+  struct fdFirVariables *fdFirVars = job->fdFirVars;
+  struct fdFirTransform *transform = fdFirVars->threadTransforms[thread];
+  int index, first, last;
+  float *dataPtr, *filterPtr;
+
+  fdFirThreadRange(job->numTransforms, thread, numThreads, &first, &last);
+
+  for(index = first; index < last; index++)
+    {
+      dataPtr = job->workPtr + (2 * job->length * index);
+      switch(job->stage)
+	{
+	case FDFIR_STAGE_FFT:
+	  fdFirTransformForward(transform, dataPtr);
+	  break;
+	case FDFIR_STAGE_MUL:
+	  filterPtr = (fdFirVars->streams != NULL) ?
+	    fdFirVars->streams[index / job->numBlocks].freqFilterPtr :
+	    fdFirVars->freqFilterPtr + (2 * job->length * index);
+	  elMul(dataPtr, filterPtr, job->length);
+	  break;
+	case FDFIR_STAGE_IFFT:
+	  fdFirTransformInverse(transform, dataPtr);
+	  break;
+	default:
+	  elDiv(dataPtr, job->length);
+	  break;
+	}
+    }
+}
+
+
+
+/*
+  fdFirProfile times each stage over the bank, repeating the four until
+  they have run for FDFIR_PROFILE_SECONDS, and prints the breakdown, with
+  the kernel's Mflops by fdFirWorkload.m, and by the stage count in the
+  default mode, the only one that runs the stages as profiled.  The ols
+  and ola modes are profiled through their block transform, one per
+  block of each input.
+*/
+void fdFirProfile(struct fdFirVariables *fdFirVars)
+{
+  struct fdFirProfileJob job;
+  struct fdFirTransform *transform = fdFirVars->threadTransforms[0];
+  int stage, index, reps = 0;
+  int copyCount = 2 * fdFirVars->numFilters * fdFirVars->inputLength;
+  double start, total = 0;
+  double seconds[FDFIR_STAGES], flops[FDFIR_STAGES], bytes[FDFIR_STAGES];
+  double allFlops = 0, allBytes = 0, nominal;
+  double length = transform->length;
+  int serial;
+
+  job.fdFirVars = fdFirVars;
+  job.length    = transform->length;
+  job.numBlocks = 1;
+  if(fdFirVars->streams != NULL)
+    {
+      job.numBlocks = (fdFirVars->inputLength + fdFirVars->streams[0].blockLength - 1) /
+	fdFirVars->streams[0].blockLength;
+    }
+  job.numTransforms = fdFirVars->numFilters * job.numBlocks;
+  job.workPtr = malloc(2 * job.numTransforms * job.length * sizeof(float));
+  if(job.workPtr == NULL)
+    {
+      printf("fdFirProfile: out of memory\n");
+      exit(-1);
+    }
+
+  /* As in fdFir(): a lone four-step transform spreads itself instead. */
+  serial = (transform->variant == FDFIR_FFT_FOURSTEP &&
+	    job.numTransforms < fdFirVars->numThreads);
+
+  for(stage = 0; stage < FDFIR_STAGES; stage++)
+    {
+      seconds[stage] = 0;
+    }
+
+  do
+    {
+      for(index = 0; index < 2 * job.numTransforms * job.length; index++)
+	{
+	  job.workPtr[index] = fdFirVars->profileInputPtr[index % copyCount];
+	}
+      for(stage = 0; stage < FDFIR_STAGES; stage++)
+	{
+	  job.stage = stage;
+	  start = fdFirThreadSeconds();
+	  if(serial)
+	    {
+	      fdFirProfileStage(&job, 0, 1);
+	    }
+	  else
+	    {
+	      fdFirThreadRun(fdFirProfileStage, &job);
+	    }
+	  seconds[stage] = seconds[stage] + (fdFirThreadSeconds() - start);
+	  total = total + (fdFirThreadSeconds() - start);
+	}
+      reps++;
+    }
+  while(total < FDFIR_PROFILE_SECONDS);
+
+  flops[FDFIR_STAGE_FFT]  = fdFirProfileFlops(transform);
+  flops[FDFIR_STAGE_MUL]  = 6 * length;
+  flops[FDFIR_STAGE_IFFT] = fdFirProfileFlops(transform);
+  flops[FDFIR_STAGE_DIV]  = 2 * length;
+  bytes[FDFIR_STAGE_FFT]  = fdFirProfileBytes(transform);
+  bytes[FDFIR_STAGE_MUL]  = 3 * 8 * length;
+  bytes[FDFIR_STAGE_IFFT] = fdFirProfileBytes(transform);
+  bytes[FDFIR_STAGE_DIV]  = 2 * 8 * length;
+
+  printf("Stage profile: %d transforms of %d points, %d threads, %d repetitions\n",
+	 job.numTransforms, job.length, fdFirVars->numThreads, reps);
+  printf("  stage       Mflop        MB    time (s)     Mflops       MB/s\n");
+  for(stage = 0; stage < FDFIR_STAGES; stage++)
+    {
+      flops[stage]   = flops[stage] * job.numTransforms;
+      bytes[stage]   = bytes[stage] * job.numTransforms;
+      seconds[stage] = seconds[stage] / reps;
+      allFlops = allFlops + flops[stage];
+      allBytes = allBytes + bytes[stage];
+      printf("  %-6s %10.3f %9.3f %11.6f %10.1f %10.1f\n", fdFirStageNames[stage],
+	     flops[stage] * 1e-6, bytes[stage] * 1e-6, seconds[stage],
+	     flops[stage] * 1e-6 / seconds[stage], bytes[stage] * 1e-6 / seconds[stage]);
+    }
+  printf("  %-6s %10.3f %9.3f %11.6f %10.1f %10.1f\n", "total",
+	 allFlops * 1e-6, allBytes * 1e-6, total / reps,
+	 allFlops * 1e-6 / (total / reps), allBytes * 1e-6 / (total / reps));
+
+  /* fdFirWorkload.m: 2 radix 2 FFTs and 8 flops per point, per filter. */
+  length  = fdFirVars->inputLength;
+  nominal = (2 * 5 * length * log(length) / log(2.0) + 8 * length) *
+    fdFirVars->numFilters;
+  printf("Kernel: %f s, %.1f Mflops by fdFirWorkload.m (%.3f Mflop)\n",
+	 fdFirVars->time.data[0], nominal * 1e-6 / fdFirVars->time.data[0],
+	 nominal * 1e-6);
+  if(fdFirVars->mode == FDFIR_MODE_BLOCK)
+    {
+      printf("        %.1f Mflops by the stage count\n",
+	     allFlops * 1e-6 / fdFirVars->time.data[0]);
+    }
+
+  free(job.workPtr);
+  free(fdFirVars->profileInputPtr);
+}
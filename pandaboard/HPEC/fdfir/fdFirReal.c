@@ -0,0 +1,251 @@
+/******************************************************************************
+** File: fdFirReal.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the real-input mode of the FDFIR filter
+**           bank.  The inputs of two filters are packed into one complex
+**           vector, z = a + i*b, and transformed together.  The spectra of
+**           a and b are Hermitian, so both are recovered from Z and its
+**           mirror: A[k] = (Z[k] + conj(Z[N-k]))/2 and
+**           B[k] = (Z[k] - conj(Z[N-k]))/(2i).
+**
+**           When both filters of a pair are real their outputs are real as
+**           well, and they are packed back into one complex vector for a
+**           single ifft: one fft and one ifft per two filters.  Otherwise
+**           the two filtered spectra are inverted separately: one fft and
+**           two iffts per two filters.
+**
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "fdFir.h"
+
+
+/*
+  fdFirRealSetup checks that the inputs are real, and prepares the filter
+  pairs.  Runs after createFreqFilter().
+
+  mirrorPtr[p] is the position of frequency N-k, where position p holds
+  frequency k, in the order the forward transform leaves its output.  For
+  a pair of real filters Ha, Hb the packed output spectrum is
+    W[k] = A[k]*Ha[k] + i*B[k]*Hb[k]
+         = Z[k]*(Ha[k]+Hb[k])/2 + conj(Z[N-k])*(Ha[k]-Hb[k])/2,
+  so the two frequency-domain filters are replaced, here, by their half
+  sum and half difference.
+*/
+void fdFirRealSetup(struct fdFirVariables *fdFirVars)
+{
+  int index, filter, tap, real;
+  int inputLength  = fdFirVars->inputLength;
+  int numFilters   = fdFirVars->numFilters;
+  int filterLength = fdFirVars->filter.size[1];
+  int *frequencyPtr;
+  float *aPtr, *bPtr, tempR, tempI;
+
+  for(index = 0; index < numFilters * inputLength; index++)
+    {
+      if(fdFirVars->input.data[2 * index + 1] != 0)
+	{
+	  printf("fdFirRealSetup: real mode needs real inputs, but input %d "
+		 "has an imaginary part\n", index / inputLength);
+	  exit(-1);
+	}
+    }
+
+  frequencyPtr          = malloc(inputLength * sizeof(int));
+  fdFirVars->mirrorPtr  = malloc(inputLength * sizeof(int));
+  fdFirVars->realPairPtr = malloc((numFilters / 2 + 1) * sizeof(int));
+  if(frequencyPtr == NULL || fdFirVars->mirrorPtr == NULL ||
+     fdFirVars->realPairPtr == NULL)
+    {
+      printf("fdFirRealSetup: out of memory\n");
+      exit(-1);
+    }
+
+  for(index = 0; index < inputLength; index++)
+    {
+      frequencyPtr[fdFirTransformFrequency(fdFirVars->transform, index)] = index;
+    }
+  for(index = 0; index < inputLength; index++)
+    {
+      fdFirVars->mirrorPtr[index] =
+	frequencyPtr[(inputLength -
+		      fdFirTransformFrequency(fdFirVars->transform, index))
+		     % inputLength];
+    }
+  free(frequencyPtr);
+
+  for(filter = 0; filter + 1 < numFilters; filter += 2)
+    {
+      /* The taps of filters 'filter' and 'filter'+1 are consecutive. */
+      real = 1;
+      for(tap = 0; tap < 2 * filterLength; tap++)
+	{
+	  if(fdFirVars->filter.data[filter * 2 * filterLength + 2 * tap + 1] != 0)
+	    {
+	      real = 0;
+	    }
+	}
+      fdFirVars->realPairPtr[filter / 2] = real;
+      if(!real)
+	{
+	  continue;
+	}
+
+      aPtr = fdFirVars->freqFilterPtr + (2 * inputLength * filter);
+      bPtr = aPtr + 2 * inputLength;
+      for(index = 0; index < 2 * inputLength; index++)
+	{
+	  tempR   = aPtr[index];
+	  tempI   = bPtr[index];
+	  aPtr[index] = (tempR + tempI) / 2;
+	  bPtr[index] = (tempR - tempI) / 2;
+	}
+    }
+}
+
+
+
+static void fdFirRealInverse(struct fdFirTransform *transform, float *dataPtr)
+{
+  fdFirTransformInverse(transform, dataPtr);
+  elDiv(dataPtr, transform->length);
+}
+
+
+
+/*
+  fdFirReal filters the inputs of filters first to last-1 two at a time,
+  in place, through 'transform' (the whole-input transform, or a copy of
+  it for this thread).  'first' is even.  With an odd number of filters
+  the last is filtered alone, as in fdFirBlock().
+*/
+void fdFirReal(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+	       int first, int last)
+{
+  int filter, index, mirror;
+  int inputLength = fdFirVars->inputLength;
+  int *mirrorPtr  = fdFirVars->mirrorPtr;
+  float *aPtr, *bPtr, *sPtr, *dPtr;
+  float zr, zi, yr, yi;      /* Z[k] and Z[N-k]                */
+  float ar, ai, br, bi;      /* A[k] and B[k]                  */
+  float cr, ci, dr, di;      /* A[N-k] and B[N-k]              */
+
+  for(filter = first; filter + 1 < last; filter += 2)
+    {
+      aPtr = fdFirVars->input.data + (2 * inputLength * filter);
+      bPtr = aPtr + 2 * inputLength;
+      sPtr = fdFirVars->freqFilterPtr + (2 * inputLength * filter);
+      dPtr = sPtr + 2 * inputLength;
+
+      /* z = a + i*b */
+      for(index = 0; index < inputLength; index++)
+	{
+	  aPtr[2 * index + 1] = bPtr[2 * index];
+	}
+
+      fdFirTransformForward(transform, aPtr);
+
+      if(fdFirVars->realPairPtr[filter / 2])
+	{
+	  /* W[k] = Z[k]*S[k] + conj(Z[N-k])*D[k], for k and N-k at once. */
+	  for(index = 0; index < inputLength; index++)
+	    {
+	      mirror = mirrorPtr[index];
+	      if(mirror < index)
+		{
+		  continue;
+		}
+	      zr = aPtr[2 * index];
+	      zi = aPtr[2 * index + 1];
+	      yr = aPtr[2 * mirror];
+	      yi = aPtr[2 * mirror + 1];
+
+	      aPtr[2 * index]     = zr * sPtr[2 * index] - zi * sPtr[2 * index + 1]
+		+ yr * dPtr[2 * index] + yi * dPtr[2 * index + 1];
+	      aPtr[2 * index + 1] = zr * sPtr[2 * index + 1] + zi * sPtr[2 * index]
+		+ yr * dPtr[2 * index + 1] - yi * dPtr[2 * index];
+	      aPtr[2 * mirror]     = yr * sPtr[2 * mirror] - yi * sPtr[2 * mirror + 1]
+		+ zr * dPtr[2 * mirror] + zi * dPtr[2 * mirror + 1];
+	      aPtr[2 * mirror + 1] = yr * sPtr[2 * mirror + 1] + yi * sPtr[2 * mirror]
+		+ zr * dPtr[2 * mirror + 1] - zi * dPtr[2 * mirror];
+	    }
+
+	  fdFirRealInverse(transform, aPtr);
+
+	  /* w = ya + i*yb */
+	  for(index = 0; index < inputLength; index++)
+	    {
+	      bPtr[2 * index]     = aPtr[2 * index + 1];
+	      bPtr[2 * index + 1] = 0;
+	      aPtr[2 * index + 1] = 0;
+	    }
+	  continue;
+	}
+
+      /*
+	Ya = A*Ha into a, Yb = B*Hb into b, for k and N-k at once; sPtr and
+	dPtr hold Ha and Hb unchanged for a pair that is not real.
+      */
+      for(index = 0; index < inputLength; index++)
+	{
+	  mirror = mirrorPtr[index];
+	  if(mirror < index)
+	    {
+	      continue;
+	    }
+	  zr = aPtr[2 * index];
+	  zi = aPtr[2 * index + 1];
+	  yr = aPtr[2 * mirror];
+	  yi = aPtr[2 * mirror + 1];
+
+	  ar = (zr + yr) / 2;   /* A[k]   = (Z[k] + conj(Z[N-k]))/2  */
+	  ai = (zi - yi) / 2;
+	  br = (zi + yi) / 2;   /* B[k]   = (Z[k] - conj(Z[N-k]))/2i */
+	  bi = (yr - zr) / 2;
+	  cr = ar;              /* A[N-k] = conj(A[k]) */
+	  ci = -ai;
+	  dr = br;              /* B[N-k] = conj(B[k]) */
+	  di = -bi;
+
+	  CPLX_MUL(ar, ai, sPtr[2 * index],  sPtr[2 * index + 1]);
+	  CPLX_MUL(cr, ci, sPtr[2 * mirror], sPtr[2 * mirror + 1]);
+	  CPLX_MUL(br, bi, dPtr[2 * index],  dPtr[2 * index + 1]);
+	  CPLX_MUL(dr, di, dPtr[2 * mirror], dPtr[2 * mirror + 1]);
+
+	  aPtr[2 * index]      = ar;
+	  aPtr[2 * index + 1]  = ai;
+	  aPtr[2 * mirror]     = cr;
+	  aPtr[2 * mirror + 1] = ci;
+	  bPtr[2 * index]      = br;
+	  bPtr[2 * index + 1]  = bi;
+	  bPtr[2 * mirror]     = dr;
+	  bPtr[2 * mirror + 1] = di;
+	}
+
+      fdFirRealInverse(transform, aPtr);
+      fdFirRealInverse(transform, bPtr);
+    }
+
+  /* The last filter of an odd bank. */
+  if(filter < last)
+    {
+      aPtr = fdFirVars->input.data + (2 * inputLength * filter);
+      fdFirTransformForward(transform, aPtr);
+      elMul(aPtr, fdFirVars->freqFilterPtr + (2 * inputLength * filter),
+	    inputLength);
+      fdFirRealInverse(transform, aPtr);
+    }
+}
+
+
+
+void fdFirRealComplete(struct fdFirVariables *fdFirVars)
+{
+  free(fdFirVars->mirrorPtr);
+  free(fdFirVars->realPairPtr);
+}
@@ -0,0 +1,274 @@
+/******************************************************************************
+** File: fdFirStream.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides a stateful, block streaming frequency-domain
+**           FIR filter, by overlap-save or overlap-add.  The FFT length is
+**           set by the filter rather than by the input, so a long or
+**           continuous signal is filtered through transforms that stay in
+**           cache, and each filter is transformed only once.  All memory is
+**           allocated in fdFirStreamSetup(), none per call.
+**
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "fdFir.h"
+
+
+/*
+  fdFirStreamFftLength picks the default FFT length of the block modes:
+  the smallest power of 4 that is at least 4*filterLength, so that three
+  quarters or more of every transform are new outputs, and no larger than
+  needed to take the whole input in one block.  For the 128 tap filters of
+  the pregenerated data sets that is 1024 points, 8 KB of complex data.
+*/
+int fdFirStreamFftLength(int filterLength, int inputLength)
+{
+  int fftLength = RADIX;
+  int wholeLength = RADIX;
+
+  while(fftLength < 4 * filterLength)
+    {
+      fftLength = fftLength * RADIX;
+    }
+  while(wholeLength < inputLength + filterLength - 1)
+    {
+      wholeLength = wholeLength * RADIX;
+    }
+
+  return (fftLength < wholeLength) ? fftLength : wholeLength;
+}
+
+
+
+/*
+  fdFirStreamSetup transforms one filter, zero padded to the length of
+  'transform', and allocates the history and scratch for one stream.  The
+  transform is shared by every stream of that length.  When freqFilterPtr
+  is not NULL it holds the filter already transformed (as cached by
+  fdFirFreqFilterSave()), and is copied instead.
+*/
+void fdFirStreamSetup(struct fdFirStream *stream, struct fdFirTransform *transform,
+		      float *filterPtr, int filterLength, int overlapAdd,
+		      float *freqFilterPtr)
+{
+  int fftLength = transform->length;
+
+  stream->transform    = transform;
+  stream->filterLength = filterLength;
+  stream->fftLength    = fftLength;
+  stream->blockLength  = fftLength - filterLength + 1;
+  stream->overlapAdd   = overlapAdd;
+
+  if(stream->blockLength < 1)
+    {
+      printf("FFT length %d is shorter than the filter (%d taps)\n",
+	     fftLength, filterLength);
+      exit(-1);
+    }
+
+  stream->freqFilterPtr = calloc(2 * fftLength, sizeof(float));
+  stream->workPtr       = malloc(2 * fftLength * sizeof(float));
+  stream->historyPtr    = malloc(2 * filterLength * sizeof(float));
+  if(stream->freqFilterPtr == NULL || stream->workPtr == NULL ||
+     stream->historyPtr == NULL)
+    {
+      printf("fdFirStreamSetup: out of memory\n");
+      exit(-1);
+    }
+
+  if(freqFilterPtr != NULL)
+    {
+      memcpy(stream->freqFilterPtr, freqFilterPtr, 2 * fftLength * sizeof(float));
+    }
+  else
+    {
+      memcpy(stream->freqFilterPtr, filterPtr, 2 * filterLength * sizeof(float));
+      fdFirTransformForward(transform, stream->freqFilterPtr);
+    }
+
+  fdFirStreamReset(stream);
+}
+
+
+
+/*
+  Forget all history; the next block is filtered as if it were preceded
+  by zeros.
+*/
+void fdFirStreamReset(struct fdFirStream *stream)
+{
+  memset(stream->historyPtr, 0, 2 * stream->filterLength * sizeof(float));
+}
+
+
+
+/*
+  Filter the zero padded contents of the work buffer: its transform is
+  multiplied by the filter and transformed back.
+*/
+static void fdFirStreamConvolve(struct fdFirStream *stream)
+{
+  fdFirTransformForward(stream->transform, stream->workPtr);
+  elMul(stream->workPtr, stream->freqFilterPtr, stream->fftLength);
+  fdFirTransformInverse(stream->transform, stream->workPtr);
+  elDiv(stream->workPtr, stream->fftLength);
+}
+
+
+
+/*
+  fdFirStreamProcess filters one block.  blockPtr and resultPtr may be the
+  same vector: the block is copied into the work buffer before any result
+  is written.
+  Input Parameters:
+  stream    - the filter state
+  blockPtr  - count complex input samples
+  resultPtr - space for count complex output samples, or NULL to only
+              update the history
+  count     - 1 to blockLength; a short block is continued by the next
+*/
+void fdFirStreamProcess(struct fdFirStream *stream, float *blockPtr,
+			float *resultPtr, int count)
+{
+  int index;
+  int overlap = stream->filterLength - 1;
+  float *workPtr    = stream->workPtr;
+  float *historyPtr = stream->historyPtr;
+
+  if(!stream->overlapAdd)
+    {
+      /* [ history | block | zeros ] */
+      memcpy(workPtr, historyPtr, 2 * overlap * sizeof(float));
+      memcpy(workPtr + 2 * overlap, blockPtr, 2 * count * sizeof(float));
+      memset(workPtr + 2 * (overlap + count), 0,
+	     2 * (stream->fftLength - overlap - count) * sizeof(float));
+
+      /* The newest filterLength-1 samples are the next block's history. */
+      memcpy(historyPtr, workPtr + 2 * count, 2 * overlap * sizeof(float));
+
+      fdFirStreamConvolve(stream);
+
+      /* The first filterLength-1 outputs wrapped around; discard them. */
+      if(resultPtr != NULL)
+	{
+	  memcpy(resultPtr, workPtr + 2 * overlap, 2 * count * sizeof(float));
+	}
+      return;
+    }
+
+  /* [ block | zeros ] */
+  memcpy(workPtr, blockPtr, 2 * count * sizeof(float));
+  memset(workPtr + 2 * count, 0,
+	 2 * (stream->fftLength - count) * sizeof(float));
+
+  fdFirStreamConvolve(stream);
+
+  /* Add the tail carried from earlier blocks. */
+  if(resultPtr != NULL)
+    {
+      for(index = 0; index < 2 * count; index++)
+	{
+	  resultPtr[index] = workPtr[index];
+	}
+      for(index = 0; index < 2 * overlap && index < 2 * count; index++)
+	{
+	  resultPtr[index] += historyPtr[index];
+	}
+    }
+
+  /*
+    The carry moves down by count samples, and this block's outputs past
+    count join it.  Reads stay ahead of writes, so this is done in place.
+  */
+  for(index = 0; index < 2 * overlap; index++)
+    {
+      historyPtr[index] = workPtr[2 * count + index] +
+	((index + 2 * count < 2 * overlap) ? historyPtr[index + 2 * count] : 0);
+    }
+}
+
+
+
+/*
+  fdFirStreamPrime sets the history as if the filterLength-1 samples at
+  samplePtr had just been filtered.  Priming with the end of a signal
+  makes the following blocks compute its circular convolution, which is
+  what fdFir computes with an FFT of the whole input.
+*/
+void fdFirStreamPrime(struct fdFirStream *stream, float *samplePtr)
+{
+  int position, count;
+  int overlap = stream->filterLength - 1;
+
+  if(!stream->overlapAdd)
+    {
+      memcpy(stream->historyPtr, samplePtr, 2 * overlap * sizeof(float));
+      return;
+    }
+
+  /* Only the carry is wanted; the outputs are not written. */
+  fdFirStreamReset(stream);
+  for(position = 0; position < overlap; position += count)
+    {
+      count = overlap - position;
+      if(count > stream->blockLength)
+	{
+	  count = stream->blockLength;
+	}
+      fdFirStreamProcess(stream, samplePtr + 2 * position, NULL, count);
+    }
+}
+
+
+
+void fdFirStreamComplete(struct fdFirStream *stream)
+{
+  free(stream->freqFilterPtr);
+  free(stream->workPtr);
+  free(stream->historyPtr);
+}
+
+
+
+/*
+  fdFirStreamRun filters the input vectors of filters first to last-1
+  with their filters, block by block, in place.  Each stream is primed
+  with the end of its input, so the result is the circular convolution the
+  whole-vector FFT computes.  The streams use 'transform', which is
+  blockTransform or this thread's copy of it.
+*/
+void fdFirStreamRun(struct fdFirVariables *fdFirVars, struct fdFirTransform *transform,
+		    int first, int last)
+{
+  int filter, position, count;
+  int inputLength = fdFirVars->inputLength;
+  int overlap     = fdFirVars->filterLength - 1;
+  float *inputPtr;
+  struct fdFirStream *stream;
+
+  for(filter = first; filter < last; filter++)
+    {
+      stream   = &fdFirVars->streams[filter];
+      stream->transform = transform;
+      inputPtr = fdFirVars->input.data + (2 * inputLength * filter);
+
+      fdFirStreamPrime(stream, inputPtr + 2 * (inputLength - overlap));
+
+      for(position = 0; position < inputLength; position += count)
+	{
+	  count = inputLength - position;
+	  if(count > stream->blockLength)
+	    {
+	      count = stream->blockLength;
+	    }
+	  fdFirStreamProcess(stream, inputPtr + 2 * position,
+			     inputPtr + 2 * position, count);
+	}
+    }
+}
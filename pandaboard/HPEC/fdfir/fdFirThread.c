@@ -0,0 +1,337 @@
+/******************************************************************************
+** File: fdFirThread.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the thread pool of the FDFIR filter bank.
+**           The threads are started once, in setup, and wait between jobs;
+**           fdFirThreadRun() runs one job on all of them and returns when
+**           every thread has finished it.  Each thread also owns a scratch
+**           buffer, allocated by the thread itself so that its pages are
+**           local to it, for transforms that need one (fdFirFourStep.c).
+**
+**           A job that calls fdFirThreadRun() again, from any thread, runs
+**           the inner job alone on the calling thread: the filters of a
+**           bank are spread over the threads, or the parts of one long
+**           transform are, but not both at once.
+**
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "fdFir.h"
+
+static int            fdFirThreadNum     = 1;
+static int            fdFirThreadStarted = 0;
+static pthread_t      *fdFirThreadIds    = NULL;
+static int            *fdFirThreadIndex  = NULL;
+static pthread_key_t  fdFirThreadKey;
+static pthread_mutex_t fdFirThreadLock   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  fdFirThreadWake   = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  fdFirThreadDone   = PTHREAD_COND_INITIALIZER;
+
+/* The current job; written by thread 0 under the lock. */
+static fdFirJob fdFirThreadJob;
+static void     *fdFirThreadArg;
+static int      fdFirThreadGeneration = 0;
+static int      fdFirThreadPending    = 0;
+static int      fdFirThreadBusy       = 0;
+static int      fdFirThreadQuit       = 0;
+
+/* Scratch of each thread, and the size reserved by fdFirThreadReserve(). */
+static float    **fdFirThreadScratchPtr  = NULL;
+static int      *fdFirThreadScratchSize  = NULL;
+static float    *fdFirThreadMainScratch  = NULL;
+static int      fdFirThreadMainSize      = 0;
+static int      fdFirThreadReserved      = 0;
+
+
+
+/*
+  The index of the calling thread; 0 for the thread that started the pool.
+*/
+static int fdFirThreadSelf(void)
+{
+  int *indexPtr;
+
+  if(!fdFirThreadStarted)
+    {
+      return 0;
+    }
+  indexPtr = pthread_getspecific(fdFirThreadKey);
+  return (indexPtr == NULL) ? 0 : *indexPtr;
+}
+
+
+
+/*
+  Grow the calling thread's scratch to the reserved size.  Only the
+  thread itself touches its scratch.
+*/
+static void fdFirThreadGrow(void)
+{
+  int thread = fdFirThreadSelf();
+  float **scratchPtr = (thread == 0) ? &fdFirThreadMainScratch :
+    &fdFirThreadScratchPtr[thread];
+  int *sizePtr = (thread == 0) ? &fdFirThreadMainSize :
+    &fdFirThreadScratchSize[thread];
+
+  if(*sizePtr >= fdFirThreadReserved)
+    {
+      return;
+    }
+
+  free(*scratchPtr);
+  *scratchPtr = malloc(fdFirThreadReserved * sizeof(float));
+  if(*scratchPtr == NULL)
+    {
+      printf("fdFirThreadGrow: out of memory\n");
+      exit(-1);
+    }
+  *sizePtr = fdFirThreadReserved;
+}
+
+static void fdFirThreadGrowJob(void *arg, int thread, int numThreads)
+{
+  fdFirThreadGrow();
+}
+
+
+
+static void *fdFirThreadWorker(void *arg)
+{
+  int *indexPtr = arg;
+  int generation = 0;
+  fdFirJob job;
+  void *jobArg;
+
+  pthread_setspecific(fdFirThreadKey, indexPtr);
+
+  pthread_mutex_lock(&fdFirThreadLock);
+  fdFirThreadGrow();
+  for(;;)
+    {
+      while(generation == fdFirThreadGeneration && !fdFirThreadQuit)
+	{
+	  pthread_cond_wait(&fdFirThreadWake, &fdFirThreadLock);
+	}
+      if(fdFirThreadQuit)
+	{
+	  break;
+	}
+      generation = fdFirThreadGeneration;
+      job        = fdFirThreadJob;
+      jobArg     = fdFirThreadArg;
+      pthread_mutex_unlock(&fdFirThreadLock);
+
+      job(jobArg, *indexPtr, fdFirThreadNum);
+
+      pthread_mutex_lock(&fdFirThreadLock);
+      fdFirThreadPending--;
+      if(fdFirThreadPending == 0)
+	{
+	  pthread_cond_signal(&fdFirThreadDone);
+	}
+    }
+  pthread_mutex_unlock(&fdFirThreadLock);
+
+  free(fdFirThreadScratchPtr[*indexPtr]);
+  return NULL;
+}
+
+
+
+/*
+  The thread count to use for 'numThreads': itself, or one per online
+  processor when it is 0 or less.
+*/
+int fdFirThreadProcessors(int numThreads)
+{
+  long online = 1;
+
+  if(numThreads > 0)
+    {
+      return numThreads;
+    }
+#ifdef _SC_NPROCESSORS_ONLN
+  online = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return (online < 1) ? 1 : (int)online;
+}
+
+
+
+/*
+  Start numThreads-1 threads; the caller is the first of the pool.  One
+  thread starts none.
+*/
+void fdFirThreadStart(int numThreads)
+{
+  int thread;
+
+  if(numThreads <= 1 || fdFirThreadStarted)
+    {
+      return;
+    }
+
+  fdFirThreadIds         = malloc(numThreads * sizeof(pthread_t));
+  fdFirThreadIndex       = malloc(numThreads * sizeof(int));
+  fdFirThreadScratchPtr  = calloc(numThreads, sizeof(float *));
+  fdFirThreadScratchSize = calloc(numThreads, sizeof(int));
+  if(fdFirThreadIds == NULL || fdFirThreadIndex == NULL ||
+     fdFirThreadScratchPtr == NULL || fdFirThreadScratchSize == NULL ||
+     pthread_key_create(&fdFirThreadKey, NULL) != 0)
+    {
+      printf("fdFirThreadStart: out of memory\n");
+      exit(-1);
+    }
+
+  fdFirThreadNum     = numThreads;
+  fdFirThreadStarted = 1;
+  fdFirThreadQuit    = 0;
+  for(thread = 1; thread < numThreads; thread++)
+    {
+      fdFirThreadIndex[thread] = thread;
+      if(pthread_create(&fdFirThreadIds[thread], NULL, fdFirThreadWorker,
+			&fdFirThreadIndex[thread]) != 0)
+	{
+	  printf("fdFirThreadStart: cannot start thread %d\n", thread);
+	  exit(-1);
+	}
+    }
+}
+
+
+
+/* The number of threads a job runs on, outside of any job. */
+int fdFirThreadCount(void)
+{
+  return fdFirThreadNum;
+}
+
+
+
+/*
+  fdFirThreadRun runs job(arg, thread, numThreads) on every thread of the
+  pool, and returns when all have returned.  Called from within a job, or
+  before the pool is started, it runs job(arg, 0, 1) on the caller.
+*/
+void fdFirThreadRun(fdFirJob job, void *arg)
+{
+  if(fdFirThreadSelf() != 0 || fdFirThreadBusy || fdFirThreadNum == 1)
+    {
+      job(arg, 0, 1);
+      return;
+    }
+
+  pthread_mutex_lock(&fdFirThreadLock);
+  fdFirThreadJob     = job;
+  fdFirThreadArg     = arg;
+  fdFirThreadPending = fdFirThreadNum - 1;
+  fdFirThreadBusy    = 1;
+  fdFirThreadGeneration++;
+  pthread_cond_broadcast(&fdFirThreadWake);
+  pthread_mutex_unlock(&fdFirThreadLock);
+
+  job(arg, 0, fdFirThreadNum);
+
+  pthread_mutex_lock(&fdFirThreadLock);
+  while(fdFirThreadPending > 0)
+    {
+      pthread_cond_wait(&fdFirThreadDone, &fdFirThreadLock);
+    }
+  fdFirThreadBusy = 0;
+  pthread_mutex_unlock(&fdFirThreadLock);
+}
+
+
+
+/*
+  The share [first, last) of 'count' items taken by 'thread'.  The shares
+  differ by at most one item.
+*/
+void fdFirThreadRange(int count, int thread, int numThreads, int *first, int *last)
+{
+  *first = (int)(((double)count * thread) / numThreads);
+  *last  = (int)(((double)count * (thread + 1)) / numThreads);
+}
+
+
+
+/*
+  Make the scratch of every thread at least 'floats' long.  Called in
+  setup, outside of any job, so that no job allocates.
+*/
+void fdFirThreadReserve(int floats)
+{
+  if(floats <= fdFirThreadReserved)
+    {
+      return;
+    }
+  pthread_mutex_lock(&fdFirThreadLock);
+  fdFirThreadReserved = floats;
+  pthread_mutex_unlock(&fdFirThreadLock);
+  fdFirThreadRun(fdFirThreadGrowJob, NULL);
+}
+
+
+
+/* The calling thread's scratch, of the size reserved. */
+float *fdFirThreadScratch(void)
+{
+  int thread = fdFirThreadSelf();
+
+  return (thread == 0) ? fdFirThreadMainScratch : fdFirThreadScratchPtr[thread];
+}
+
+
+
+/* Wall clock seconds, for measuring work spread over several threads. */
+double fdFirThreadSeconds(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+
+/* Stop the threads and free the scratch. */
+void fdFirThreadStop(void)
+{
+  int thread;
+
+  if(fdFirThreadStarted)
+    {
+      pthread_mutex_lock(&fdFirThreadLock);
+      fdFirThreadQuit = 1;
+      pthread_cond_broadcast(&fdFirThreadWake);
+      pthread_mutex_unlock(&fdFirThreadLock);
+
+      for(thread = 1; thread < fdFirThreadNum; thread++)
+	{
+	  pthread_join(fdFirThreadIds[thread], NULL);
+	}
+      pthread_key_delete(fdFirThreadKey);
+
+      free(fdFirThreadIds);
+      free(fdFirThreadIndex);
+      free(fdFirThreadScratchPtr);
+      free(fdFirThreadScratchSize);
+      fdFirThreadStarted = 0;
+      fdFirThreadNum     = 1;
+    }
+
+  free(fdFirThreadMainScratch);
+  fdFirThreadMainScratch = NULL;
+  fdFirThreadMainSize    = 0;
+  fdFirThreadReserved    = 0;
+}
@@ -0,0 +1,606 @@
+/******************************************************************************
+** File: fdFirTransform.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the FFTs of the FDFIR filter bank as
+**           transforms of one length, each planned and run by one of the
+**           backends of fdFirBackends[], and caches what setup would
+**           otherwise redo on every run:
+**             - each transform is built once per process, twiddle tables
+**               and plan included, and shared by every user of its length;
+**             - when a length has more than one FFT variant, the variants
+**               are timed once, on the threads a transform may use, and
+**               the fastest is recorded in a wisdom file
+**               (FDFIR_WISDOM_FILE), which later runs read instead of
+**               measuring again;
+**             - the frequency-domain filters of a data set are saved next
+**               to it, so later runs read them instead of transforming.
+**
+******************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "fdFir.h"
+
+/*
+  Transforms built so far, and the wisdom read from or measured for it:
+  the fastest variant of a length on a number of threads.
+*/
+static struct fdFirTransform *fdFirTransformCache = NULL;
+static int fdFirWisdomLength[FDFIR_WISDOM_MAX];
+static int fdFirWisdomThreads[FDFIR_WISDOM_MAX];
+static int fdFirWisdomVariant[FDFIR_WISDOM_MAX];
+static int fdFirWisdomCount  = 0;
+static int fdFirWisdomLoaded = 0;
+
+
+/*
+  The in-house backends: the radix 4 fft & ifft with their twiddle tables
+  (lengths that are powers of 4 only), and the mixed-radix plans.
+*/
+static int fdFirRadix4Accepts(int length)
+{
+  return length >= RADIX && verifyLength(length);
+}
+
+static void fdFirRadix4Setup(struct fdFirTransform *transform, int length)
+{
+  transform->phases         = computeNumPhases(length);
+  transform->twiddlePtr     = malloc(2 * length * sizeof(float));
+  transform->twiddleConjPtr = malloc(2 * length * sizeof(float));
+  if(transform->twiddlePtr == NULL || transform->twiddleConjPtr == NULL)
+    {
+      printf("fdFirTransformSetup: out of memory\n");
+      exit(-1);
+    }
+  createTwiddles(transform->twiddlePtr, transform->twiddleConjPtr, length);
+}
+
+static void fdFirRadix4Forward(struct fdFirTransform *transform, float *dataPtr)
+{
+  fft(0, transform->length, transform->phases, dataPtr, transform->twiddlePtr);
+}
+
+static void fdFirRadix4Inverse(struct fdFirTransform *transform, float *dataPtr)
+{
+  ifft(0, transform->length, transform->phases, dataPtr, transform->twiddleConjPtr);
+}
+
+static void fdFirRadix4Complete(struct fdFirTransform *transform)
+{
+  free(transform->twiddlePtr);
+  free(transform->twiddleConjPtr);
+}
+
+static int fdFirMixedAccepts(int length)
+{
+  return length > 0;
+}
+
+static void fdFirMixedSetup(struct fdFirTransform *transform, int length)
+{
+  transform->plan = fftPlanCreate(length);
+  if(transform->plan == NULL)
+    {
+      printf("Invalid FFT length: %d\n", length);
+      exit(-1);
+    }
+}
+
+static void fdFirMixedForward(struct fdFirTransform *transform, float *dataPtr)
+{
+  fftPlanForward(transform->plan, dataPtr);
+}
+
+static void fdFirMixedInverse(struct fdFirTransform *transform, float *dataPtr)
+{
+  fftPlanInverse(transform->plan, dataPtr);
+}
+
+static void fdFirMixedComplete(struct fdFirTransform *transform)
+{
+  fftPlanDestroy(transform->plan);
+}
+
+/*
+  The backend of each FDFIR_FFT_* variant, in that order.  The names are
+  those of the wisdom file.
+*/
+static const struct fdFirFftBackend fdFirBackends[FDFIR_FFT_VARIANTS] =
+  {
+    {"radix4", fdFirRadix4Accepts, fdFirRadix4Setup,
+     fdFirRadix4Forward, fdFirRadix4Inverse, fdFirRadix4Complete},
+    {"mixed", fdFirMixedAccepts, fdFirMixedSetup,
+     fdFirMixedForward, fdFirMixedInverse, fdFirMixedComplete},
+    {"fourstep", fdFirFourStepSplit, fdFirFourStepSetup,
+     fdFirFourStepForward, fdFirFourStepInverse, fdFirFourStepComplete},
+    {"fftw", fdFirFftwAccepts, fdFirFftwSetup,
+     fdFirFftwForward, fdFirFftwInverse, fdFirFftwComplete}
+  };
+
+
+
+/*
+  fdFirTransformSetup prepares an FFT of 'length' points with one variant,
+  which must accept the length.
+*/
+void fdFirTransformSetup(struct fdFirTransform *transform, int length,
+			 int variant)
+{
+  transform->length         = length;
+  transform->variant        = variant;
+  transform->phases         = 0;
+  transform->twiddlePtr     = NULL;
+  transform->twiddleConjPtr = NULL;
+  transform->plan           = NULL;
+  transform->length1        = 0;
+  transform->length2        = 0;
+  transform->sub1           = NULL;
+  transform->sub2           = NULL;
+  transform->frequency1Ptr  = NULL;
+  transform->backendPtr     = NULL;
+  transform->next           = NULL;
+
+  fdFirBackends[variant].plan(transform, length);
+}
+
+
+
+/*
+  Forward and inverse transforms of one vector in place.  As with fft()
+  and ifft(), the forward output is digit reversed and the inverse is not
+  scaled; elDiv() does that.  The digit order depends on the variant.
+*/
+void fdFirTransformForward(struct fdFirTransform *transform, float *dataPtr)
+{
+  fdFirBackends[transform->variant].forward(transform, dataPtr);
+}
+
+void fdFirTransformInverse(struct fdFirTransform *transform, float *dataPtr)
+{
+  fdFirBackends[transform->variant].inverse(transform, dataPtr);
+}
+
+void fdFirTransformComplete(struct fdFirTransform *transform)
+{
+  fdFirBackends[transform->variant].destroy(transform);
+}
+
+
+
+/*
+  The frequency held at 'position' of a forward transform.  The stages of
+  the radix 4 and mixed-radix transforms run from the whole vector down;
+  a stage of radix r splits each block into r sub-blocks, sub-block q
+  holding the frequencies congruent to q modulo r (in the sub-block's own
+  output order).  Bluestein's and FFTW's output is in natural order, and
+  the four-step output is described in fdFirFourStep.c.
+*/
+int fdFirTransformFrequency(struct fdFirTransform *transform, int position)
+{
+  int stage, radix, numStages;
+  int span = transform->length;
+  int frequency = 0, weight = 1;
+
+  if(transform->variant == FDFIR_FFT_FOURSTEP)
+    {
+      return transform->frequency1Ptr[position / transform->length2] +
+	transform->length1 *
+	fdFirTransformFrequency(transform->sub2, position % transform->length2);
+    }
+
+  if(transform->variant == FDFIR_FFT_FFTW)
+    {
+      return position;
+    }
+
+  numStages = (transform->variant == FDFIR_FFT_RADIX4) ? transform->phases :
+    (transform->plan->subPlan == NULL) ? transform->plan->numFactors : 0;
+
+  for(stage = 0; stage < numStages; stage++)
+    {
+      radix = (transform->variant == FDFIR_FFT_RADIX4) ? RADIX :
+	transform->plan->factors[stage];
+      span      = span / radix;
+      frequency = frequency + weight * (position / span);
+      position  = position % span;
+      weight    = weight * radix;
+    }
+
+  return frequency;
+}
+
+
+
+/*
+  Whether one transform may be used by several threads at once.  Only
+  Bluestein's algorithm keeps scratch in its plan; the four-step FFT uses
+  the scratch of the calling thread, and FFTW's new-array execute is
+  thread safe.
+*/
+int fdFirTransformShared(struct fdFirTransform *transform)
+{
+  return transform->plan == NULL || transform->plan->subPlan == NULL;
+}
+
+
+
+/*
+  Read FDFIR_WISDOM_FILE, once.  Each line after the header is a length,
+  a thread count and the name of the fastest variant.  A missing or
+  foreign file is no wisdom.
+*/
+static void fdFirWisdomLoad(void)
+{
+  FILE *file;
+  char header[32], name[32];
+  int length, threads, variant;
+
+  fdFirWisdomLoaded = 1;
+  file = fopen(FDFIR_WISDOM_FILE, "r");
+  if(file == NULL)
+    {
+      return;
+    }
+
+  if(fscanf(file, "%31s", header) == 1 && strcmp(header, "fdFir-wisdom-2") == 0)
+    {
+      while(fdFirWisdomCount < FDFIR_WISDOM_MAX &&
+	    fscanf(file, "%d %d %31s", &length, &threads, name) == 3)
+	{
+	  for(variant = 0; variant < FDFIR_FFT_VARIANTS; variant++)
+	    {
+	      if(strcmp(name, fdFirBackends[variant].name) == 0)
+		{
+		  fdFirWisdomLength[fdFirWisdomCount]  = length;
+		  fdFirWisdomThreads[fdFirWisdomCount] = threads;
+		  fdFirWisdomVariant[fdFirWisdomCount] = variant;
+		  fdFirWisdomCount++;
+		}
+	    }
+	}
+    }
+  fclose(file);
+}
+
+
+
+/*
+  Rewrite FDFIR_WISDOM_FILE with everything known.  Failing to write it
+  only means the next run measures again.
+*/
+static void fdFirWisdomSave(void)
+{
+  FILE *file;
+  int index;
+
+  file = fopen(FDFIR_WISDOM_FILE, "w");
+  if(file == NULL)
+    {
+      return;
+    }
+
+  fprintf(file, "fdFir-wisdom-2\n");
+  for(index = 0; index < fdFirWisdomCount; index++)
+    {
+      fprintf(file, "%d %d %s\n", fdFirWisdomLength[index],
+	      fdFirWisdomThreads[index],
+	      fdFirBackends[fdFirWisdomVariant[index]].name);
+    }
+  fclose(file);
+}
+
+
+
+/*
+  The time of one forward and inverse transform, averaged over enough
+  repetitions to last FDFIR_MEASURE_SECONDS.  Wall clock time, since a
+  four-step FFT may run on several threads.
+*/
+static double fdFirTransformMeasure(struct fdFirTransform *transform)
+{
+  int index, reps = 0;
+  double start, elapsed;
+  float *dataPtr = malloc(2 * transform->length * sizeof(float));
+
+  if(dataPtr == NULL)
+    {
+      printf("fdFirTransformMeasure: out of memory\n");
+      exit(-1);
+    }
+  for(index = 0; index < 2 * transform->length; index++)
+    {
+      dataPtr[index] = (float)(index % 7) - 3;
+    }
+
+  start = fdFirThreadSeconds();
+  do
+    {
+      fdFirTransformForward(transform, dataPtr);
+      fdFirTransformInverse(transform, dataPtr);
+      elDiv(dataPtr, transform->length);
+      reps++;
+      elapsed = fdFirThreadSeconds() - start;
+    }
+  while(elapsed < FDFIR_MEASURE_SECONDS);
+
+  free(dataPtr);
+  return elapsed / reps;
+}
+
+
+
+/*
+  fdFirTransformGet returns the transform of 'length', shared and owned by
+  the cache.  The variant is the only one the length allows, else the one
+  the wisdom records for the current thread count, else the fastest when
+  measured now, which is then added to the wisdom.
+*/
+struct fdFirTransform *fdFirTransformGet(int length)
+{
+  struct fdFirTransform *transform;
+  struct fdFirTransform candidate;
+  double seconds, bestSeconds = 0;
+  int index, variant = -1;
+  int threads = fdFirThreadCount();
+  int allowed[FDFIR_FFT_VARIANTS];
+  int numAllowed = 0;
+
+  for(transform = fdFirTransformCache; transform != NULL; transform = transform->next)
+    {
+      if(transform->length == length)
+	{
+	  return transform;
+	}
+    }
+
+  transform = malloc(sizeof(struct fdFirTransform));
+  if(transform == NULL)
+    {
+      printf("fdFirTransformGet: out of memory\n");
+      exit(-1);
+    }
+
+  for(index = 0; index < FDFIR_FFT_VARIANTS; index++)
+    {
+      allowed[index] = (fdFirBackends[index].accepts(length) != 0);
+      if(allowed[index])
+	{
+	  numAllowed++;
+	  variant = index;
+	}
+    }
+  if(numAllowed > 1)
+    {
+      variant = -1;
+    }
+
+  if(variant < 0)
+    {
+      if(!fdFirWisdomLoaded)
+	{
+	  fdFirWisdomLoad();
+	}
+      for(index = 0; index < fdFirWisdomCount; index++)
+	{
+	  if(fdFirWisdomLength[index] == length &&
+	     fdFirWisdomThreads[index] == threads &&
+	     allowed[fdFirWisdomVariant[index]])
+	    {
+	      variant = fdFirWisdomVariant[index];
+	    }
+	}
+    }
+
+  if(variant < 0)
+    {
+      for(index = 0; index < FDFIR_FFT_VARIANTS; index++)
+	{
+	  if(!allowed[index])
+	    {
+	      continue;
+	    }
+	  fdFirTransformSetup(&candidate, length, index);
+	  seconds = fdFirTransformMeasure(&candidate);
+	  fdFirTransformComplete(&candidate);
+#ifdef VERBOSE
+	  printf("FFT length %d, %d threads, %s: %g s\n", length, threads,
+		 fdFirBackends[index].name, seconds);
+#endif
+	  if(variant < 0 || seconds < bestSeconds)
+	    {
+	      variant     = index;
+	      bestSeconds = seconds;
+	    }
+	}
+      if(fdFirWisdomCount < FDFIR_WISDOM_MAX)
+	{
+	  fdFirWisdomLength[fdFirWisdomCount]  = length;
+	  fdFirWisdomThreads[fdFirWisdomCount] = threads;
+	  fdFirWisdomVariant[fdFirWisdomCount] = variant;
+	  fdFirWisdomCount++;
+	  fdFirWisdomSave();
+	}
+    }
+
+  fdFirTransformSetup(transform, length, variant);
+  transform->next = fdFirTransformCache;
+  fdFirTransformCache = transform;
+  return transform;
+}
+
+
+
+/*
+  fdFirTransformGetVariant returns the transform of 'length' with a given
+  variant, for kernels that depend on its butterflies or its order.  It
+  is cached like those of fdFirTransformGet(), and never measured.
+*/
+struct fdFirTransform *fdFirTransformGetVariant(int length, int variant)
+{
+  struct fdFirTransform *transform;
+
+  for(transform = fdFirTransformCache; transform != NULL; transform = transform->next)
+    {
+      if(transform->length == length && transform->variant == variant)
+	{
+	  return transform;
+	}
+    }
+
+  transform = malloc(sizeof(struct fdFirTransform));
+  if(transform == NULL)
+    {
+      printf("fdFirTransformGetVariant: out of memory\n");
+      exit(-1);
+    }
+  fdFirTransformSetup(transform, length, variant);
+  transform->next = fdFirTransformCache;
+  fdFirTransformCache = transform;
+  return transform;
+}
+
+
+
+/*
+  Free every cached transform.
+*/
+void fdFirTransformCacheFree(void)
+{
+  struct fdFirTransform *next;
+
+  while(fdFirTransformCache != NULL)
+    {
+      next = fdFirTransformCache->next;
+      fdFirTransformComplete(fdFirTransformCache);
+      free(fdFirTransformCache);
+      fdFirTransformCache = next;
+    }
+}
+
+
+
+/*
+  The frequency-domain filter cache.  A file holds a header of ints
+  (magic, FFT length, number of filters, filter length and the transform's
+  variants, below), the time-domain taps it was made from, and the
+  transformed filters, numFilters * fftLength complex values in the
+  transform's order.  It is used only when all of these match the current
+  run exactly.
+
+  The order of a radix 4 or mixed-radix transform follows from its length,
+  but that of a four-step transform also depends on the variants of its
+  short transforms, which the wisdom chooses.  The header therefore lists
+  the variants of the transform, then those of sub1 and of sub2, in turn
+  (-1 after the last).  A transform with more than FDFIR_FREQ_VARIANTS of
+  them is not cached.
+*/
+#define FDFIR_FREQ_MAGIC    0x46444632
+#define FDFIR_FREQ_VARIANTS 8
+#define FDFIR_FREQ_HEADER   (4 + FDFIR_FREQ_VARIANTS)
+
+/* Lists the variants of transform from variantPtr[count]; returns the new
+   count, more than FDFIR_FREQ_VARIANTS when they do not fit. */
+static int fdFirFreqFilterVariants(struct fdFirTransform *transform,
+				   int *variantPtr, int count)
+{
+  if(count >= FDFIR_FREQ_VARIANTS)
+    {
+      return FDFIR_FREQ_VARIANTS + 1;
+    }
+  variantPtr[count++] = transform->variant;
+  if(transform->variant == FDFIR_FFT_FOURSTEP)
+    {
+      count = fdFirFreqFilterVariants(transform->sub1, variantPtr, count);
+      count = fdFirFreqFilterVariants(transform->sub2, variantPtr, count);
+    }
+  return count;
+}
+
+/* Fills the header of a cache file; returns 0 when it cannot be cached. */
+static int fdFirFreqFilterHeader(int *header, struct fdFirTransform *transform,
+				 int numFilters, int filterLength)
+{
+  int count;
+
+  header[0] = FDFIR_FREQ_MAGIC;
+  header[1] = transform->length;
+  header[2] = numFilters;
+  header[3] = filterLength;
+  count = fdFirFreqFilterVariants(transform, header + 4, 0);
+  for(; count < FDFIR_FREQ_VARIANTS; count++)
+    {
+      header[4 + count] = -1;
+    }
+  return count == FDFIR_FREQ_VARIANTS;
+}
+
+int fdFirFreqFilterLoad(char *fileName, struct fdFirTransform *transform,
+			float *filterPtr, int numFilters, int filterLength,
+			float *freqFilterPtr)
+{
+  FILE *file;
+  int header[FDFIR_FREQ_HEADER];
+  int expected[FDFIR_FREQ_HEADER];
+  int taps  = 2 * numFilters * filterLength;
+  int count = 2 * numFilters * transform->length;
+  int match;
+  float *tapPtr;
+
+  if(!fdFirFreqFilterHeader(expected, transform, numFilters, filterLength))
+    {
+      return 0;
+    }
+  file = fopen(fileName, "rb");
+  if(file == NULL)
+    {
+      return 0;
+    }
+
+  match = (fread(header, sizeof(int), FDFIR_FREQ_HEADER, file) == FDFIR_FREQ_HEADER &&
+	   memcmp(header, expected, sizeof(header)) == 0);
+
+  if(match)
+    {
+      tapPtr = malloc(taps * sizeof(float));
+      match  = (tapPtr != NULL &&
+		fread(tapPtr, sizeof(float), taps, file) == (size_t)taps &&
+		memcmp(tapPtr, filterPtr, taps * sizeof(float)) == 0);
+      free(tapPtr);
+    }
+
+  if(match)
+    {
+      match = (fread(freqFilterPtr, sizeof(float), count, file) == (size_t)count);
+    }
+
+  fclose(file);
+  return match;
+}
+
+void fdFirFreqFilterSave(char *fileName, struct fdFirTransform *transform,
+			 float *filterPtr, int numFilters, int filterLength,
+			 float *freqFilterPtr)
+{
+  FILE *file;
+  int header[FDFIR_FREQ_HEADER];
+
+  if(!fdFirFreqFilterHeader(header, transform, numFilters, filterLength))
+    {
+      return;
+    }
+  file = fopen(fileName, "wb");
+  if(file == NULL)
+    {
+      return;
+    }
+
+  fwrite(header, sizeof(int), FDFIR_FREQ_HEADER, file);
+  fwrite(filterPtr, sizeof(float), 2 * numFilters * filterLength, file);
+  fwrite(freqFilterPtr, sizeof(float), 2 * numFilters * transform->length, file);
+  fclose(file);
+}
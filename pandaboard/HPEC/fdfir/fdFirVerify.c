@@ -24,6 +24,8 @@
   Need to include fdFir.h to used the fdFirVars structure.
 */
 
+struct fdFirVariables fdFirVars;
+
 void fdFirVerify(struct fdFirVariables *fdFirVars);
 void fdFirComplete(struct fdFirVariables *fdFirVars);
 
@@ -17,188 +17,202 @@
 ******************************************************************************/
 
 #include "fdFir.h"
+#include "fftSimd.h"
 
 
+/*
+  The twiddle factors are laid out by createTwiddles() one phase after
+  another.  A phase whose blocks hold 'span' elements has m = span/4
+  butterflies per block, and its table holds m complex values of each of
+  w^j, w^2j and w^3j (w = exp(-2*pi*i/span)), one array after the other,
+  so that the twiddles of consecutive butterflies are consecutive in 
+  memory and no exponent has to be computed.
+*/
 void fft(int filter, int inputLength, int phases,
-	 int butterflies, int stride, float * inputData,
-	 float * twiddlePtr)
+	 float * inputData, float * twiddlePtr)
 {
 
   /*int filter        which filter in the bank*/
   /*int inputLength   input length */
   /*int phases        number of phases in the fft */
-  /*int butterflies   number of butterflies per phase */
-  /*int stride        stride between elements in the butterfly */
-  /*float *twiddlePtr point to the start of the twiddle factors vector.  */
+  /*float *twiddlePtr point to the start of the per-phase twiddle tables. */
   /*float *inputData  point to the start of the input.  */
 
-
-  int inc           = inputLength; /*number of elements to increment after each butterfly */
-  int reset         = 1;  /* cntr determining how many butterflies to do before going 
-			     to the second element of the input vector.  */
-  int resetSave     = 1;  /*  reset needs to be saved as we decrement it's value.  */
-  int shift;   /*  Variable used to determine the exponent of the twiddle factors */
-  float *dataPtr1   = inputData + (inputLength * 2 * filter);  /* pointers */
-  float *dataPtr2   = inputData + (inputLength * 2 * filter);  /*    to    */
-  float *dataPtr3   = inputData + (inputLength * 2 * filter);  /*   data   */
+  int span = inputLength;  /* elements per block in the current phase */
+  int m;                   /* butterflies per block, and the distance
+			      between the elements of a butterfly */
+  int phase, block, j;
+  float *dataPtr = inputData + (inputLength * 2 * filter);
+  float *blockPtr;
+  float *ptr;
+  float *w1Ptr, *w2Ptr, *w3Ptr;
 
   float ar,ai,br,bi,cr,ci,dr,di;   /*  butterfly input variables  */
-  
-  int phase;  /*  current phase variable */
-  int butterfly;  /*  current butterfly variable  */
-  int exp1, exp2, exp3;  /* exponent variables for twiddle factors */
-  
-  float twiddle1_r, twiddle1_i;  /*  twiddle  */
-  float twiddle2_r, twiddle2_i;  /*  factor   */
-  float twiddle3_r, twiddle3_i;  /* variables */
-  float twiddle4_r, twiddle4_i;  /*           */
-
+  float t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
   float res1r, res1i, res2r, res2i; /* butterfly result */
   float res3r, res3i, res4r, res4i; /*   variables      */
 
-  int tmp1,tmp2,tmp3;  /* temporary variables for utility use. */
-  /*  
-      Temporary variables for butterfly optimization below.  These are
-      not needed unless the optimizations found below are uncommented.
-  */
-  /* float t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i; */
+#if defined(FFT_NEON)
+  float32x4x2_t a, b, c, d, w;
+  float32x4_t v1r, v1i, v2r, v2i, v3r, v3i, v4r, v4i;
+#elif defined(FFT_SSE)
+  __m128 a, b, c, d, w, v1, v2, v3, v4;
+  __m128 sign    = _mm_set_ps(1, -1, 1, -1);
+  __m128 negImag = _mm_set_ps(-1, 1, -1, 1);
+#endif
 
   for(phase = 0; phase < phases; phase++)
     {
-      dataPtr1 = dataPtr2 = dataPtr3;
+      m     = span / RADIX;
+      w1Ptr = twiddlePtr;
+      w2Ptr = w1Ptr + 2 * m;
+      w3Ptr = w2Ptr + 2 * m;
 
-      for(butterfly = 0; butterfly < butterflies; butterfly++)
+      for(block = 0; block < inputLength; block += span)
 	{
-	  if(reset == 0)
-	    {
-	      dataPtr2 = dataPtr2 + 2;
-	      dataPtr1 = dataPtr2;
-	      reset    = resetSave;
-	    }
+	  blockPtr = dataPtr + 2 * block;
+	  j = 0;
+
 	  /*
-	    Calculate the exponents for the twiddle factors.
+	    The butterflies of a block read consecutive elements at four
+	    offsets, and consecutive twiddles, so they are done
+	    FFT_SIMD_WIDTH at a time.
 	  */
-
-	  if (phase == 0)
+#if defined(FFT_NEON)
+	  for(; j + FFT_SIMD_WIDTH <= m; j += FFT_SIMD_WIDTH)
 	    {
-	      tmp1 = 1;
+	      ptr = blockPtr + 2 * j;
+	      a = vld2q_f32(ptr);
+	      b = vld2q_f32(ptr + 2 * m);
+	      c = vld2q_f32(ptr + 4 * m);
+	      d = vld2q_f32(ptr + 6 * m);
+
+	      v1r = vaddq_f32(a.val[0], c.val[0]);   /* t1 = a + c */
+	      v1i = vaddq_f32(a.val[1], c.val[1]);
+	      v2r = vaddq_f32(b.val[0], d.val[0]);   /* t2 = b + d */
+	      v2i = vaddq_f32(b.val[1], d.val[1]);
+	      v3r = vsubq_f32(a.val[0], c.val[0]);   /* t3 = a - c */
+	      v3i = vsubq_f32(a.val[1], c.val[1]);
+	      v4r = vsubq_f32(b.val[1], d.val[1]);   /* t4 = -i(b - d) */
+	      v4i = vsubq_f32(d.val[0], b.val[0]);
+
+	      a.val[0] = vaddq_f32(v1r, v2r);
+	      a.val[1] = vaddq_f32(v1i, v2i);
+	      b.val[0] = vaddq_f32(v3r, v4r);
+	      b.val[1] = vaddq_f32(v3i, v4i);
+	      c.val[0] = vsubq_f32(v1r, v2r);
+	      c.val[1] = vsubq_f32(v1i, v2i);
+	      d.val[0] = vsubq_f32(v3r, v4r);
+	      d.val[1] = vsubq_f32(v3i, v4i);
+
+	      w = vld2q_f32(w1Ptr + 2 * j);
+	      FFT_NEON_CMUL(b.val[0], b.val[1], w.val[0], w.val[1]);
+	      w = vld2q_f32(w2Ptr + 2 * j);
+	      FFT_NEON_CMUL(c.val[0], c.val[1], w.val[0], w.val[1]);
+	      w = vld2q_f32(w3Ptr + 2 * j);
+	      FFT_NEON_CMUL(d.val[0], d.val[1], w.val[0], w.val[1]);
+
+	      vst2q_f32(ptr, a);
+	      vst2q_f32(ptr + 2 * m, b);
+	      vst2q_f32(ptr + 4 * m, c);
+	      vst2q_f32(ptr + 6 * m, d);
 	    }
-	  else
+#elif defined(FFT_SSE)
+	  for(; j + FFT_SIMD_WIDTH <= m; j += FFT_SIMD_WIDTH)
 	    {
-	      shift = (phase - 1) * 2;
-	      tmp1 = 4<<shift;
-  	    }
-
-	  tmp2 = butterfly / tmp1;
-	  tmp3 = tmp1 * tmp2;
-	  exp1 = 2 * tmp3;
-	  exp2 = 4 * tmp3;
-	  exp3 = 6 * tmp3;
-
-	  /*
-	    The following elements a,b,c,d (r,i) are the four inputs
-	    to the butterfly operation below.
-	  */
-	  ar = *(dataPtr1);
-	  ai = *(dataPtr1 + 1);
-	  br = *(dataPtr1 + stride);
-	  bi = *(dataPtr1 + stride + 1);
-	  cr = *(dataPtr1 + 2 * stride);
-	  ci = *(dataPtr1 + 2 * stride + 1);
-	  dr = *(dataPtr1 + 3 * stride);
-	  di = *(dataPtr1 + 3 * stride + 1);
-
-	  /*
-	    The following for twiddle factors (r,i) are the four twiddle
-	    factors for the butterfly operation below.
-	  */
-	  twiddle1_r = 1;
-	  twiddle1_i = 0;
-	  twiddle2_r = *(twiddlePtr + exp1);
-	  twiddle2_i = *(twiddlePtr + exp1 + 1);
-	  twiddle3_r = *(twiddlePtr + exp2);
-	  twiddle3_i = *(twiddlePtr + exp2 + 1);
-	  twiddle4_r = *(twiddlePtr + exp3);
-	  twiddle4_i = *(twiddlePtr + exp3 + 1);
-	 
-
-	  /*
-	    The following operations make up a Radix 4 butterfly.
-	  */
-
-	  
-	  res1r = ar + br + cr + dr;
-	  res1i = ai + bi + ci + di;
-	  res2r = ar + bi - cr - di;
-	  res2i = ai - br - ci + dr;
-	  res3r = ar - br + cr - dr;
-	  res3i = ai - bi + ci - di;           
-	  res4r = ar - bi - cr + di;           
-	  res4i = ai + br - ci - dr;           
-	  
-	  /*
-	    The following code could be an optimization for the above 8
-	    operations. Below performs 16 adds/subtracts versus the code 
-	    above performing 24 add/subtracts.  Unfortunatly the code below
-	    did perform slower than the above code; however, this is often 
-	    an optimization made to various fft implementations.
-	    
-	    To use this code, the temporary variables (t1r, t1i...) must be
-	    uncommented above)
-	  */
-	  /* 
-	     t1r = ar + cr;
-	     t1i = ai + ci;
-	     t2r = br + dr;
-	     t2i = bi + di;
-	     t3r = ar - cr;
-	     t3i = ai - ci;
-	     t4r = br - dr;
-	     t4i = bi - di;
-	     
-	     res1r = t1r + t2r;
-	     res1i = t1i + t2i;
-	     res2r = t3r + t4i;
-	     res2i = t3i - t4r;
-	     res3r = t1r - t2r;
-	     res3i = t1i - t2i;
-	     res4r = t3r - t4i;
-	     res4i = t3i + t4r;
-	  */
-
-	  /* 
-	    The following complex multiplies perform multiplications
-	    of the butterfly results by the respective twiddle factors.
-	    the results of the complex multiplies are placed back in
-	    res#r and res#i.  The CPLX_MUL macro can be found in fdFir.h
-	  */
-	  CPLX_MUL(res1r, res1i, twiddle1_r, twiddle1_i );
-	  CPLX_MUL(res2r, res2i, twiddle2_r, twiddle2_i );
-	  CPLX_MUL(res3r, res3i, twiddle3_r, twiddle3_i );
-	  CPLX_MUL(res4r, res4i, twiddle4_r, twiddle4_i );
-
+	      ptr = blockPtr + 2 * j;
+	      a = _mm_loadu_ps(ptr);
+	      b = _mm_loadu_ps(ptr + 2 * m);
+	      c = _mm_loadu_ps(ptr + 4 * m);
+	      d = _mm_loadu_ps(ptr + 6 * m);
+
+	      v1 = _mm_add_ps(a, c);                                    /* t1 */
+	      v2 = _mm_add_ps(b, d);                                    /* t2 */
+	      v3 = _mm_sub_ps(a, c);                                    /* t3 */
+	      v4 = FFT_SSE_MUL_NEG_I(_mm_sub_ps(b, d), negImag);        /* t4 */
+
+	      a = _mm_add_ps(v1, v2);
+	      b = _mm_add_ps(v3, v4);
+	      c = _mm_sub_ps(v1, v2);
+	      d = _mm_sub_ps(v3, v4);
+
+	      w = _mm_loadu_ps(w1Ptr + 2 * j);
+	      FFT_SSE_CMUL(b, w, sign);
+	      w = _mm_loadu_ps(w2Ptr + 2 * j);
+	      FFT_SSE_CMUL(c, w, sign);
+	      w = _mm_loadu_ps(w3Ptr + 2 * j);
+	      FFT_SSE_CMUL(d, w, sign);
+
+	      _mm_storeu_ps(ptr, a);
+	      _mm_storeu_ps(ptr + 2 * m, b);
+	      _mm_storeu_ps(ptr + 4 * m, c);
+	      _mm_storeu_ps(ptr + 6 * m, d);
+	    }
+#endif
 
-	  /*
-	    store the results.
-	  */
-	  *(dataPtr1)                  = res1r;
-	  *(dataPtr1 + 1)              = res1i;
-	  *(dataPtr1 + stride)         = res2r;
-	  *(dataPtr1 + stride + 1)     = res2i;
-	  *(dataPtr1 + 2 * stride)     = res3r;
-	  *(dataPtr1 + 2 * stride + 1) = res3i;
-	  *(dataPtr1 + 3 * stride)     = res4r;
-	  *(dataPtr1 + 3 * stride + 1) = res4i;
-
-
-	  dataPtr1 = dataPtr1 + inc*2;
-	  reset--;
-	}/*end butterflies*/
-      stride    = stride    / RADIX;  /* 1/4 the stride for next phase */
-      inc       = inc       / RADIX;  /* 1/4 the # of elements to increments 
-					 after each butterfly    */
-      reset     = resetSave * RADIX;  /* reset 1/4 as often  */
-      resetSave = resetSave * RADIX;  /* reset 1/4 as often */
+	  for(; j < m; j++)
+	    {
+	      ptr = blockPtr + 2 * j;
+
+	      /*
+		The following elements a,b,c,d (r,i) are the four inputs
+		to the butterfly operation below.
+	      */
+	      ar = *(ptr);
+	      ai = *(ptr + 1);
+	      br = *(ptr + 2 * m);
+	      bi = *(ptr + 2 * m + 1);
+	      cr = *(ptr + 4 * m);
+	      ci = *(ptr + 4 * m + 1);
+	      dr = *(ptr + 6 * m);
+	      di = *(ptr + 6 * m + 1);
+
+	      /*
+		The following operations make up a Radix 4 butterfly.
+	      */
+	      t1r = ar + cr;
+	      t1i = ai + ci;
+	      t2r = br + dr;
+	      t2i = bi + di;
+	      t3r = ar - cr;
+	      t3i = ai - ci;
+	      t4r = bi - di;
+	      t4i = dr - br;
+
+	      res1r = t1r + t2r;
+	      res1i = t1i + t2i;
+	      res2r = t3r + t4r;
+	      res2i = t3i + t4i;
+	      res3r = t1r - t2r;
+	      res3i = t1i - t2i;
+	      res4r = t3r - t4r;
+	      res4i = t3i - t4i;
+
+	      /* 
+		The following complex multiplies perform multiplications
+		of the butterfly results by the respective twiddle factors.
+		The CPLX_MUL macro can be found in fdFir.h
+	      */
+	      CPLX_MUL(res2r, res2i, w1Ptr[2 * j], w1Ptr[2 * j + 1]);
+	      CPLX_MUL(res3r, res3i, w2Ptr[2 * j], w2Ptr[2 * j + 1]);
+	      CPLX_MUL(res4r, res4i, w3Ptr[2 * j], w3Ptr[2 * j + 1]);
+
+	      /*
+		store the results.
+	      */
+	      *(ptr)                 = res1r;
+	      *(ptr + 1)             = res1i;
+	      *(ptr + 2 * m)         = res2r;
+	      *(ptr + 2 * m + 1)     = res2i;
+	      *(ptr + 4 * m)         = res3r;
+	      *(ptr + 4 * m + 1)     = res3i;
+	      *(ptr + 6 * m)         = res4r;
+	      *(ptr + 6 * m + 1)     = res4i;
+	    }/*end butterflies*/
+	}/*end blocks*/
+
+      twiddlePtr = twiddlePtr + 6 * m;  /* the next phase's table */
+      span = m;                         /* 1/4 the block size for next phase */
     }/* end phases*/
 
 }
@@ -0,0 +1,715 @@
+/******************************************************************************
+** File: fftPlan.c
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides a mixed-radix FFT for input lengths that are
+**           not powers of four.  The length is factored into radix 8, 4, 2,
+**           3, 5 and small prime stages.  As in fft.c, the forward stages go
+**           from the largest butterflies to the smallest and leave the
+**           output digit reversed; as in ifft.c, the inverse stages undo
+**           them in the opposite order, so no reordering is needed.  A
+**           length with a prime factor above FFTPLAN_MAX_RADIX is handled
+**           with Bluestein's algorithm.
+**
+******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "fdFir.h"
+
+
+#define SQRT_HALF 0.70710678118654752440
+
+
+
+/*
+  Factors length into radices, largest butterflies first.  Returns the
+  number of factors, or 0 when a prime factor exceeds FFTPLAN_MAX_RADIX.
+*/
+static int fftPlanFactor(int length, int *factors)
+{
+  int numFactors = 0;
+  int radix;
+
+  while(length % 8 == 0)
+    {
+      factors[numFactors++] = 8;
+      length /= 8;
+    }
+  while(length % 4 == 0)
+    {
+      factors[numFactors++] = 4;
+      length /= 4;
+    }
+  while(length % 2 == 0)
+    {
+      factors[numFactors++] = 2;
+      length /= 2;
+    }
+  for(radix = 3; radix <= FFTPLAN_MAX_RADIX && length > 1; radix += 2)
+    {
+      while(length % radix == 0)
+	{
+	  factors[numFactors++] = radix;
+	  length /= radix;
+	}
+    }
+
+  if(length > 1)
+    {
+      return 0;
+    }
+  return numFactors;
+}
+
+
+
+/*
+  The smallest length 2^a 3^b 5^c that is at least minLength.
+*/
+static int fftPlanSmoothLength(int minLength)
+{
+  int length, rest;
+
+  for(length = minLength; ; length++)
+    {
+      rest = length;
+      while(rest % 2 == 0) rest /= 2;
+      while(rest % 3 == 0) rest /= 3;
+      while(rest % 5 == 0) rest /= 5;
+      if(rest == 1)
+	{
+	  return length;
+	}
+    }
+}
+
+
+
+static void *fftPlanAlloc(int bytes)
+{
+  void *ptr = malloc(bytes);
+
+  if(ptr == NULL)
+    {
+      printf("fftPlanCreate: out of memory\n");
+      exit(-1);
+    }
+  return ptr;
+}
+
+
+
+/*
+  fftPlanCreate factors 'length' and computes its twiddle factors, or,
+  for Bluestein's algorithm, its chirp and the plan of the convolution.
+  Returns NULL for a length below 1.
+*/
+struct fftPlan *fftPlanCreate(int length)
+{
+  int index, subLength;
+  double angle;
+  struct fftPlan *plan;
+
+  if(length < 1)
+    {
+      return NULL;
+    }
+
+  plan = fftPlanAlloc(sizeof(struct fftPlan));
+  plan->length       = length;
+  plan->subPlan      = NULL;
+  plan->chirpPtr     = NULL;
+  plan->chirpFreqPtr = NULL;
+  plan->workPtr      = NULL;
+  plan->twiddlePtr   = fftPlanAlloc(2 * length * sizeof(float));
+
+  for(index = 0; index < length; index++)
+    {
+      angle = (2 * PI * index) / length;
+      plan->twiddlePtr[2 * index]     = (float)cos(angle);
+      plan->twiddlePtr[2 * index + 1] = (float)sin(angle) * -1;
+    }
+
+  plan->numFactors = fftPlanFactor(length, plan->factors);
+  if(plan->numFactors > 0 || length == 1)
+    {
+      return plan;
+    }
+
+  /*
+    Bluestein: with w[n] = exp(-pi*i*n*n/length), nk = (n*n + k*k - (k-n)^2)/2
+    turns the transform into X[k] = w[k] * sum_n (x[n]*w[n]) * conj(w[k-n]),
+    a convolution, done circularly at subLength >= 2*length-1.  n*n is
+    reduced modulo 2*length before forming the angle, to keep it exact.
+  */
+  subLength = fftPlanSmoothLength(2 * length - 1);
+  plan->subPlan      = fftPlanCreate(subLength);
+  plan->chirpPtr     = fftPlanAlloc(2 * length * sizeof(float));
+  plan->chirpFreqPtr = fftPlanAlloc(2 * subLength * sizeof(float));
+  plan->workPtr      = fftPlanAlloc(2 * subLength * sizeof(float));
+
+  for(index = 0; index < length; index++)
+    {
+      angle = PI * fmod((double)index * index, 2.0 * length) / length;
+      plan->chirpPtr[2 * index]     = (float)cos(angle);
+      plan->chirpPtr[2 * index + 1] = (float)sin(angle) * -1;
+    }
+
+  for(index = 0; index < 2 * subLength; index++)
+    {
+      plan->chirpFreqPtr[index] = 0;
+    }
+  for(index = 0; index < length; index++)
+    {
+      /* conj(w[n]) at n and at -n, scaled by the inverse's 1/subLength. */
+      plan->chirpFreqPtr[2 * index]     =  plan->chirpPtr[2 * index] / subLength;
+      plan->chirpFreqPtr[2 * index + 1] = -plan->chirpPtr[2 * index + 1] / subLength;
+      if(index > 0)
+	{
+	  plan->chirpFreqPtr[2 * (subLength - index)]     = plan->chirpFreqPtr[2 * index];
+	  plan->chirpFreqPtr[2 * (subLength - index) + 1] = plan->chirpFreqPtr[2 * index + 1];
+	}
+    }
+  fftPlanForward(plan->subPlan, plan->chirpFreqPtr);
+
+  return plan;
+}
+
+
+
+void fftPlanDestroy(struct fftPlan *plan)
+{
+  if(plan == NULL)
+    {
+      return;
+    }
+  fftPlanDestroy(plan->subPlan);
+  free(plan->twiddlePtr);
+  free(plan->chirpPtr);
+  free(plan->chirpFreqPtr);
+  free(plan->workPtr);
+  free(plan);
+}
+
+
+
+/*
+  Butterflies on named complex scalars, in place, for sign -1 (forward)
+  or +1 (inverse): y[p] = sum_q x[q] * exp(sign*2*pi*i*p*q/radix).  They
+  use the temporaries t1r ... t4i declared by each stage.
+*/
+#define FFTPLAN_BFLY2(ar,ai,br,bi)					\
+  t1r = ar - br;  t1i = ai - bi;					\
+  ar  = ar + br;  ai  = ai + bi;					\
+  br  = t1r;      bi  = t1i;
+
+#define FFTPLAN_BFLY3(sign,ar,ai,br,bi,cr,ci)				\
+  t1r = br + cr;  t1i = bi + ci;					\
+  t2r = (br - cr) * (sign * (float)0.86602540378443864676);		\
+  t2i = (bi - ci) * (sign * (float)0.86602540378443864676);		\
+  t3r = ar - (float)0.5 * t1r;  t3i = ai - (float)0.5 * t1i;		\
+  ar  = ar + t1r;  ai = ai + t1i;					\
+  br  = t3r - t2i; bi = t3i + t2r;					\
+  cr  = t3r + t2i; ci = t3i - t2r;
+
+#define FFTPLAN_BFLY4(sign,ar,ai,br,bi,cr,ci,dr,di)			\
+  t1r = ar + cr;  t1i = ai + ci;					\
+  t2r = br + dr;  t2i = bi + di;					\
+  t3r = ar - cr;  t3i = ai - ci;					\
+  t4r = (br - dr) * sign;  t4i = (bi - di) * sign;			\
+  ar  = t1r + t2r; ai = t1i + t2i;					\
+  cr  = t1r - t2r; ci = t1i - t2i;					\
+  br  = t3r - t4i; bi = t3i + t4r;					\
+  dr  = t3r + t4i; di = t3i - t4r;
+
+#define FFTPLAN_C1 ((float)0.30901699437494742410)  /* cos(2*pi/5) */
+#define FFTPLAN_C2 ((float)0.80901699437494742410)  /* -cos(4*pi/5) */
+#define FFTPLAN_S1 ((float)0.95105651629515357212)  /* sin(2*pi/5) */
+#define FFTPLAN_S2 ((float)0.58778525229247312917)  /* sin(4*pi/5) */
+
+#define FFTPLAN_BFLY5(sign,ar,ai,br,bi,cr,ci,dr,di,er,ei)		\
+  t1r = br + er;  t1i = bi + ei;					\
+  t2r = cr + dr;  t2i = ci + di;					\
+  t3r = (br - er) * sign;  t3i = (bi - ei) * sign;			\
+  t4r = (cr - dr) * sign;  t4i = (ci - di) * sign;			\
+  m1r = ar + FFTPLAN_C1 * t1r - FFTPLAN_C2 * t2r;			\
+  m1i = ai + FFTPLAN_C1 * t1i - FFTPLAN_C2 * t2i;			\
+  m2r = ar - FFTPLAN_C2 * t1r + FFTPLAN_C1 * t2r;			\
+  m2i = ai - FFTPLAN_C2 * t1i + FFTPLAN_C1 * t2i;			\
+  n1r = FFTPLAN_S1 * t3r + FFTPLAN_S2 * t4r;				\
+  n1i = FFTPLAN_S1 * t3i + FFTPLAN_S2 * t4i;				\
+  n2r = FFTPLAN_S2 * t3r - FFTPLAN_S1 * t4r;				\
+  n2i = FFTPLAN_S2 * t3i - FFTPLAN_S1 * t4i;				\
+  ar  = ar + t1r + t2r;  ai = ai + t1i + t2i;				\
+  br  = m1r - n1i;  bi = m1i + n1r;					\
+  er  = m1r + n1i;  ei = m1i - n1r;					\
+  cr  = m2r - n2i;  ci = m2i + n2r;					\
+  dr  = m2r + n2i;  di = m2i - n2r;
+
+/*
+  Twiddle k of the stage: exp(-2*pi*i*k/length) forward, its conjugate
+  for the inverse.
+*/
+#define FFTPLAN_TWIDDLE(wr,wi,k)				\
+  wr = plan->twiddlePtr[2 * (k)];				\
+  wi = plan->twiddlePtr[2 * (k) + 1] * -sign;
+
+#define FFTPLAN_LOAD(xr,xi,q)  xr = ptr[2*(q)*m];  xi = ptr[2*(q)*m + 1];
+#define FFTPLAN_STORE(xr,xi,q) ptr[2*(q)*m] = xr;  ptr[2*(q)*m + 1] = xi;
+
+
+
+/*
+  The stages.  The data is split into blocks of 'span' samples; within a
+  block, butterfly j takes the radix samples j, j+m, j+2m, ... (m =
+  span/radix).  Forward, output p of the butterfly is multiplied by
+  exp(-2*pi*i*p*j/span) and written back to sample j+p*m, and the next
+  stage works within blocks of m samples.  The inverse undoes this up to
+  a factor of radix: input p is multiplied by the conjugate twiddle, then
+  the conjugate butterfly is applied, stages running in reverse order.
+*/
+static void fftPlanStage2(struct fftPlan *plan, float *dataPtr, int span,
+			  int forward)
+{
+  int m = span / 2, scale = plan->length / span, sign = forward ? -1 : 1;
+  int block, j;
+  float ar, ai, br, bi, w1r, w1i;
+  float t1r, t1i;
+  float *ptr;
+
+  for(j = 0; j < m; j++)
+    {
+      FFTPLAN_TWIDDLE(w1r, w1i, j * scale);
+      for(block = j; block < plan->length; block += span)
+	{
+	  ptr = dataPtr + 2 * block;
+	  FFTPLAN_LOAD(ar, ai, 0);
+	  FFTPLAN_LOAD(br, bi, 1);
+	  if(!forward)
+	    {
+	      CPLX_MUL(br, bi, w1r, w1i);
+	    }
+	  FFTPLAN_BFLY2(ar, ai, br, bi);
+	  if(forward)
+	    {
+	      CPLX_MUL(br, bi, w1r, w1i);
+	    }
+	  FFTPLAN_STORE(ar, ai, 0);
+	  FFTPLAN_STORE(br, bi, 1);
+	}
+    }
+}
+
+
+
+static void fftPlanStage3(struct fftPlan *plan, float *dataPtr, int span,
+			  int forward)
+{
+  int m = span / 3, scale = plan->length / span, sign = forward ? -1 : 1;
+  int block, j;
+  float ar, ai, br, bi, cr, ci, w1r, w1i, w2r, w2i;
+  float t1r, t1i, t2r, t2i, t3r, t3i;
+  float *ptr;
+
+  for(j = 0; j < m; j++)
+    {
+      FFTPLAN_TWIDDLE(w1r, w1i, j * scale);
+      FFTPLAN_TWIDDLE(w2r, w2i, 2 * j * scale);
+      for(block = j; block < plan->length; block += span)
+	{
+	  ptr = dataPtr + 2 * block;
+	  FFTPLAN_LOAD(ar, ai, 0);
+	  FFTPLAN_LOAD(br, bi, 1);
+	  FFTPLAN_LOAD(cr, ci, 2);
+	  if(!forward)
+	    {
+	      CPLX_MUL(br, bi, w1r, w1i);
+	      CPLX_MUL(cr, ci, w2r, w2i);
+	    }
+	  FFTPLAN_BFLY3(sign, ar, ai, br, bi, cr, ci);
+	  if(forward)
+	    {
+	      CPLX_MUL(br, bi, w1r, w1i);
+	      CPLX_MUL(cr, ci, w2r, w2i);
+	    }
+	  FFTPLAN_STORE(ar, ai, 0);
+	  FFTPLAN_STORE(br, bi, 1);
+	  FFTPLAN_STORE(cr, ci, 2);
+	}
+    }
+}
+
+
+
+static void fftPlanStage4(struct fftPlan *plan, float *dataPtr, int span,
+			  int forward)
+{
+  int m = span / 4, scale = plan->length / span, sign = forward ? -1 : 1;
+  int block, j;
+  float ar, ai, br, bi, cr, ci, dr, di;
+  float w1r, w1i, w2r, w2i, w3r, w3i;
+  float t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
+  float *ptr;
+
+  for(j = 0; j < m; j++)
+    {
+      FFTPLAN_TWIDDLE(w1r, w1i, j * scale);
+      FFTPLAN_TWIDDLE(w2r, w2i, 2 * j * scale);
+      FFTPLAN_TWIDDLE(w3r, w3i, 3 * j * scale);
+      for(block = j; block < plan->length; block += span)
+	{
+	  ptr = dataPtr + 2 * block;
+	  FFTPLAN_LOAD(ar, ai, 0);
+	  FFTPLAN_LOAD(br, bi, 1);
+	  FFTPLAN_LOAD(cr, ci, 2);
+	  FFTPLAN_LOAD(dr, di, 3);
+	  if(!forward)
+	    {
+	      CPLX_MUL(br, bi, w1r, w1i);
+	      CPLX_MUL(cr, ci, w2r, w2i);
+	      CPLX_MUL(dr, di, w3r, w3i);
+	    }
+	  FFTPLAN_BFLY4(sign, ar, ai, br, bi, cr, ci, dr, di);
+	  if(forward)
+	    {
+	      CPLX_MUL(br, bi, w1r, w1i);
+	      CPLX_MUL(cr, ci, w2r, w2i);
+	      CPLX_MUL(dr, di, w3r, w3i);
+	    }
+	  FFTPLAN_STORE(ar, ai, 0);
+	  FFTPLAN_STORE(br, bi, 1);
+	  FFTPLAN_STORE(cr, ci, 2);
+	  FFTPLAN_STORE(dr, di, 3);
+	}
+    }
+}
+
+
+
+static void fftPlanStage5(struct fftPlan *plan, float *dataPtr, int span,
+			  int forward)
+{
+  int m = span / 5, scale = plan->length / span, sign = forward ? -1 : 1;
+  int block, j;
+  float ar, ai, br, bi, cr, ci, dr, di, er, ei;
+  float w1r, w1i, w2r, w2i, w3r, w3i, w4r, w4i;
+  float t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
+  float m1r, m1i, m2r, m2i, n1r, n1i, n2r, n2i;
+  float *ptr;
+
+  for(j = 0; j < m; j++)
+    {
+      FFTPLAN_TWIDDLE(w1r, w1i, j * scale);
+      FFTPLAN_TWIDDLE(w2r, w2i, 2 * j * scale);
+      FFTPLAN_TWIDDLE(w3r, w3i, 3 * j * scale);
+      FFTPLAN_TWIDDLE(w4r, w4i, 4 * j * scale);
+      for(block = j; block < plan->length; block += span)
+	{
+	  ptr = dataPtr + 2 * block;
+	  FFTPLAN_LOAD(ar, ai, 0);
+	  FFTPLAN_LOAD(br, bi, 1);
+	  FFTPLAN_LOAD(cr, ci, 2);
+	  FFTPLAN_LOAD(dr, di, 3);
+	  FFTPLAN_LOAD(er, ei, 4);
+	  if(!forward)
+	    {
+	      CPLX_MUL(br, bi, w1r, w1i);
+	      CPLX_MUL(cr, ci, w2r, w2i);
+	      CPLX_MUL(dr, di, w3r, w3i);
+	      CPLX_MUL(er, ei, w4r, w4i);
+	    }
+	  FFTPLAN_BFLY5(sign, ar, ai, br, bi, cr, ci, dr, di, er, ei);
+	  if(forward)
+	    {
+	      CPLX_MUL(br, bi, w1r, w1i);
+	      CPLX_MUL(cr, ci, w2r, w2i);
+	      CPLX_MUL(dr, di, w3r, w3i);
+	      CPLX_MUL(er, ei, w4r, w4i);
+	    }
+	  FFTPLAN_STORE(ar, ai, 0);
+	  FFTPLAN_STORE(br, bi, 1);
+	  FFTPLAN_STORE(cr, ci, 2);
+	  FFTPLAN_STORE(dr, di, 3);
+	  FFTPLAN_STORE(er, ei, 4);
+	}
+    }
+}
+
+
+
+/*
+  Radix 8: 4 point butterflies on the even (x0,x2,x4,x6) and the odd
+  (x1,x3,x5,x7) samples, the odd results rotated by exp(sign*pi*i*p/4),
+  then 2 point butterflies, which leave y0..y7 in x0,x2,x4,x6,x1,x3,x5,x7.
+*/
+static void fftPlanStage8(struct fftPlan *plan, float *dataPtr, int span,
+			  int forward)
+{
+  int m = span / 8, scale = plan->length / span, sign = forward ? -1 : 1;
+  int block, j, p;
+  float x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+  float x4r, x4i, x5r, x5i, x6r, x6i, x7r, x7i;
+  float w[16];
+  float t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
+  float *ptr;
+  float half = (float)SQRT_HALF;
+
+  for(j = 0; j < m; j++)
+    {
+      for(p = 1; p < 8; p++)
+	{
+	  FFTPLAN_TWIDDLE(w[2 * p], w[2 * p + 1], p * j * scale);
+	}
+      for(block = j; block < plan->length; block += span)
+	{
+	  ptr = dataPtr + 2 * block;
+	  FFTPLAN_LOAD(x0r, x0i, 0);
+	  FFTPLAN_LOAD(x1r, x1i, 1);
+	  FFTPLAN_LOAD(x2r, x2i, 2);
+	  FFTPLAN_LOAD(x3r, x3i, 3);
+	  FFTPLAN_LOAD(x4r, x4i, 4);
+	  FFTPLAN_LOAD(x5r, x5i, 5);
+	  FFTPLAN_LOAD(x6r, x6i, 6);
+	  FFTPLAN_LOAD(x7r, x7i, 7);
+	  if(!forward)
+	    {
+	      CPLX_MUL(x1r, x1i, w[2],  w[3]);
+	      CPLX_MUL(x2r, x2i, w[4],  w[5]);
+	      CPLX_MUL(x3r, x3i, w[6],  w[7]);
+	      CPLX_MUL(x4r, x4i, w[8],  w[9]);
+	      CPLX_MUL(x5r, x5i, w[10], w[11]);
+	      CPLX_MUL(x6r, x6i, w[12], w[13]);
+	      CPLX_MUL(x7r, x7i, w[14], w[15]);
+	    }
+	  FFTPLAN_BFLY4(sign, x0r, x0i, x2r, x2i, x4r, x4i, x6r, x6i);
+	  FFTPLAN_BFLY4(sign, x1r, x1i, x3r, x3i, x5r, x5i, x7r, x7i);
+	  t1r = half * (x3r - sign * x3i);
+	  x3i = half * (x3i + sign * x3r);
+	  x3r = t1r;
+	  t1r = -sign * x5i;
+	  x5i =  sign * x5r;
+	  x5r = t1r;
+	  t1r = half * (-x7r - sign * x7i);
+	  x7i = half * (-x7i + sign * x7r);
+	  x7r = t1r;
+	  FFTPLAN_BFLY2(x0r, x0i, x1r, x1i);
+	  FFTPLAN_BFLY2(x2r, x2i, x3r, x3i);
+	  FFTPLAN_BFLY2(x4r, x4i, x5r, x5i);
+	  FFTPLAN_BFLY2(x6r, x6i, x7r, x7i);
+	  if(forward)
+	    {
+	      CPLX_MUL(x2r, x2i, w[2],  w[3]);
+	      CPLX_MUL(x4r, x4i, w[4],  w[5]);
+	      CPLX_MUL(x6r, x6i, w[6],  w[7]);
+	      CPLX_MUL(x1r, x1i, w[8],  w[9]);
+	      CPLX_MUL(x3r, x3i, w[10], w[11]);
+	      CPLX_MUL(x5r, x5i, w[12], w[13]);
+	      CPLX_MUL(x7r, x7i, w[14], w[15]);
+	    }
+	  FFTPLAN_STORE(x0r, x0i, 0);
+	  FFTPLAN_STORE(x2r, x2i, 1);
+	  FFTPLAN_STORE(x4r, x4i, 2);
+	  FFTPLAN_STORE(x6r, x6i, 3);
+	  FFTPLAN_STORE(x1r, x1i, 4);
+	  FFTPLAN_STORE(x3r, x3i, 5);
+	  FFTPLAN_STORE(x5r, x5i, 6);
+	  FFTPLAN_STORE(x7r, x7i, 7);
+	}
+    }
+}
+
+
+
+/*
+  Any other prime radix, up to FFTPLAN_MAX_RADIX, as a direct O(radix^2)
+  DFT.  exp(-2*pi*i*k/radix) is entry k*length/radix of the twiddle table.
+*/
+static void fftPlanStageGeneric(struct fftPlan *plan, float *dataPtr,
+				int radix, int span, int forward)
+{
+  int m = span / radix, scale = plan->length / span, sign = forward ? -1 : 1;
+  int step = plan->length / radix;
+  int block, j, p, q, k;
+  float x[2 * FFTPLAN_MAX_RADIX];
+  float y[2 * FFTPLAN_MAX_RADIX];
+  float w[2 * FFTPLAN_MAX_RADIX];
+  float wr, wi, t1r, t1i;
+  float *ptr;
+
+  for(j = 0; j < m; j++)
+    {
+      for(p = 1; p < radix; p++)
+	{
+	  FFTPLAN_TWIDDLE(w[2 * p], w[2 * p + 1], p * j * scale);
+	}
+      for(block = j; block < plan->length; block += span)
+	{
+	  ptr = dataPtr + 2 * block;
+	  for(q = 0; q < radix; q++)
+	    {
+	      FFTPLAN_LOAD(x[2 * q], x[2 * q + 1], q);
+	      if(!forward && q > 0)
+		{
+		  CPLX_MUL(x[2 * q], x[2 * q + 1], w[2 * q], w[2 * q + 1]);
+		}
+	    }
+	  for(p = 0; p < radix; p++)
+	    {
+	      t1r = 0;
+	      t1i = 0;
+	      for(q = 0, k = 0; q < radix; q++, k += p)
+		{
+		  if(k >= radix)
+		    {
+		      k -= radix;
+		    }
+		  FFTPLAN_TWIDDLE(wr, wi, k * step);
+		  t1r += x[2 * q] * wr - x[2 * q + 1] * wi;
+		  t1i += x[2 * q] * wi + x[2 * q + 1] * wr;
+		}
+	      if(forward && p > 0)
+		{
+		  CPLX_MUL(t1r, t1i, w[2 * p], w[2 * p + 1]);
+		}
+	      y[2 * p]     = t1r;
+	      y[2 * p + 1] = t1i;
+	    }
+	  for(p = 0; p < radix; p++)
+	    {
+	      FFTPLAN_STORE(y[2 * p], y[2 * p + 1], p);
+	    }
+	}
+    }
+}
+
+
+
+static void fftPlanStage(struct fftPlan *plan, float *dataPtr, int radix,
+			 int span, int forward)
+{
+  switch(radix)
+    {
+    case 2:
+      fftPlanStage2(plan, dataPtr, span, forward);
+      break;
+    case 3:
+      fftPlanStage3(plan, dataPtr, span, forward);
+      break;
+    case 4:
+      fftPlanStage4(plan, dataPtr, span, forward);
+      break;
+    case 5:
+      fftPlanStage5(plan, dataPtr, span, forward);
+      break;
+    case 8:
+      fftPlanStage8(plan, dataPtr, span, forward);
+      break;
+    default:
+      fftPlanStageGeneric(plan, dataPtr, radix, span, forward);
+      break;
+    }
+}
+
+
+
+/*
+  Bluestein's algorithm (see fftPlanCreate): chirp, convolve with the
+  conjugate chirp through the sub plan, chirp again.  The sub plan's
+  digit reversal cancels between its forward and inverse transforms, so
+  the result is in natural order.
+*/
+static void fftPlanBluestein(struct fftPlan *plan, float *dataPtr)
+{
+  int index;
+  int length    = plan->length;
+  int subLength = plan->subPlan->length;
+  float *workPtr  = plan->workPtr;
+  float *chirpPtr = plan->chirpPtr;
+
+  for(index = 0; index < length; index++)
+    {
+      workPtr[2 * index]     = dataPtr[2 * index];
+      workPtr[2 * index + 1] = dataPtr[2 * index + 1];
+      CPLX_MUL(workPtr[2 * index], workPtr[2 * index + 1],
+	       chirpPtr[2 * index], chirpPtr[2 * index + 1]);
+    }
+  for(index = 2 * length; index < 2 * subLength; index++)
+    {
+      workPtr[index] = 0;
+    }
+
+  fftPlanForward(plan->subPlan, workPtr);
+  elMul(workPtr, plan->chirpFreqPtr, subLength);
+  fftPlanInverse(plan->subPlan, workPtr);
+
+  for(index = 0; index < length; index++)
+    {
+      dataPtr[2 * index]     = workPtr[2 * index];
+      dataPtr[2 * index + 1] = workPtr[2 * index + 1];
+      CPLX_MUL(dataPtr[2 * index], dataPtr[2 * index + 1],
+	       chirpPtr[2 * index], chirpPtr[2 * index + 1]);
+    }
+}
+
+
+
+/*
+  Forward transform of plan->length complex samples, in place.  The output
+  is in the plan's digit-reversed order (natural order for Bluestein).
+*/
+void fftPlanForward(struct fftPlan *plan, float *dataPtr)
+{
+  int stage;
+  int span = plan->length;
+
+  if(plan->subPlan != NULL)
+    {
+      fftPlanBluestein(plan, dataPtr);
+      return;
+    }
+
+  for(stage = 0; stage < plan->numFactors; stage++)
+    {
+      fftPlanStage(plan, dataPtr, plan->factors[stage], span, 1);
+      span /= plan->factors[stage];
+    }
+}
+
+
+
+/*
+  Inverse transform, scaled by plan->length, of data in the order
+  fftPlanForward() leaves it; the output is in natural order.
+*/
+void fftPlanInverse(struct fftPlan *plan, float *dataPtr)
+{
+  int stage;
+  int index;
+  int span = 1;
+
+  if(plan->subPlan != NULL)
+    {
+      /* ifft(X) = conj(fft(conj(X))) */
+      for(index = 1; index < 2 * plan->length; index += 2)
+	{
+	  dataPtr[index] = -dataPtr[index];
+	}
+      fftPlanBluestein(plan, dataPtr);
+      for(index = 1; index < 2 * plan->length; index += 2)
+	{
+	  dataPtr[index] = -dataPtr[index];
+	}
+      return;
+    }
+
+  for(stage = plan->numFactors - 1; stage >= 0; stage--)
+    {
+      span *= plan->factors[stage];
+      fftPlanStage(plan, dataPtr, plan->factors[stage], span, 0);
+    }
+}
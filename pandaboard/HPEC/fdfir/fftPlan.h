@@ -0,0 +1,57 @@
+/******************************************************************************
+** File: fftPlan.h
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents: This include file provides declarations for the mixed-radix
+**           FFT used by the Frequency-domain FIR filter bank for input
+**           lengths that are not powers of four.
+**
+******************************************************************************/
+
+#ifndef FDFIR_FFT_PLAN_H_
+#define FDFIR_FFT_PLAN_H_
+
+/*
+  The largest radix a plan factors a length into.  Radices 2, 3, 4, 5 and
+  8 have dedicated butterflies; other primes up to FFTPLAN_MAX_RADIX use a
+  generic O(radix^2) butterfly.  A length with a larger prime factor is
+  transformed with Bluestein's algorithm, as a convolution of length
+  2^a 3^b 5^c >= 2*length-1.
+*/
+#ifndef FFTPLAN_MAX_RADIX
+#define FFTPLAN_MAX_RADIX   13
+#endif
+#define FFTPLAN_MAX_FACTORS 32
+
+/*
+  An FFT of one length, prepared in fftPlanCreate().
+
+  Like fft() and ifft(), the forward transform takes its input in natural
+  order and leaves its output in digit-reversed order (the mixed-radix
+  analogue of base-4 reversal), and the inverse transform takes that order
+  back to natural order.  The reversals cancel, so a frequency-domain
+  filter produced by the same plan can be applied with elMul() and no
+  reordering is ever done.  The inverse is not scaled by 1/length; elDiv()
+  does that.
+*/
+struct fftPlan{
+  int   length;
+  int   numFactors;
+  int   factors[FFTPLAN_MAX_FACTORS]; /* radix of each stage, first to last */
+  float *twiddlePtr;         /* length complex: exp(-2*pi*i*k/length)     */
+
+  /* Bluestein's algorithm, when subPlan is not NULL. */
+  struct fftPlan *subPlan;   /* plan of the convolution length            */
+  float *chirpPtr;           /* length complex: exp(-pi*i*k*k/length)     */
+  float *chirpFreqPtr;       /* transformed conjugate chirp, scaled       */
+  float *workPtr;            /* subPlan->length complex of scratch        */
+};
+
+struct fftPlan *fftPlanCreate(int length);
+void fftPlanForward(struct fftPlan *plan, float *dataPtr);
+void fftPlanInverse(struct fftPlan *plan, float *dataPtr);
+void fftPlanDestroy(struct fftPlan *plan);
+
+#endif
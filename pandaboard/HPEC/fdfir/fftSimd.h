@@ -0,0 +1,111 @@
+/******************************************************************************
+** File: fftSimd.h
+**
+** HPEC Challenge Benchmark Suite
+** FDFIR Kernel Benchmark
+**
+** Contents: This include file selects the vector instructions used by the
+**           radix 4 butterflies of fft.c and ifft.c, and provides the
+**           complex arithmetic they need.
+**
+**           ARM NEON - four butterflies per vector.  vld2q/vst2q split
+**                      interleaved complex data into real and imaginary
+**                      vectors and back.
+**           x86 SSE  - two butterflies per vector, on interleaved complex
+**                      data (re,im,re,im).
+**           Otherwise FFT_SIMD_WIDTH is not defined and only the scalar
+**           butterflies are used.
+**
+**           The batched transforms of fdFirBatch.c put one filter in each
+**           lane of a vector instead, FFT_BATCH_WIDTH filters at a time:
+**           eight with x86 AVX, four with NEON or SSE, and one, in plain
+**           C, otherwise.  They need only lane-wise arithmetic.
+**
+******************************************************************************/
+
+#ifndef FDFIR_FFT_SIMD_H_
+#define FDFIR_FFT_SIMD_H_
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FFT_NEON
+#define FFT_SIMD_WIDTH 4
+
+/* (ar,ai) = (ar,ai) * (wr,wi), on split real and imaginary vectors. */
+#define FFT_NEON_CMUL(ar, ai, wr, wi)				\
+  {								\
+    float32x4_t tempR = vmlsq_f32(vmulq_f32(ar, wr), ai, wi);	\
+    ai = vmlaq_f32(vmulq_f32(ar, wi), ai, wr);			\
+    ar = tempR;							\
+  }
+
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define FFT_SSE
+#define FFT_SIMD_WIDTH 2
+
+/*
+  a = a * w on interleaved complex pairs:
+  (ar*wr - ai*wi, ai*wr + ar*wi) = a*(wr,wr) + (ai,ar)*(wi,wi)*(-1,+1).
+  sign is the vector (-1,+1,-1,+1).
+*/
+#define FFT_SSE_CMUL(a, w, sign)					\
+  a = _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(w, w, _MM_SHUFFLE(2,2,0,0))), \
+		 _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1)), \
+				       _mm_shuffle_ps(w, w, _MM_SHUFFLE(3,3,1,1))), \
+			    sign));
+
+/* -i * (x,y) = (y,-x); negImag is the vector (+1,-1,+1,-1). */
+#define FFT_SSE_MUL_NEG_I(a, negImag)					\
+  _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2,3,0,1)), negImag)
+
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FFT_BATCH_WIDTH 8
+typedef __m256 fftBatchVec;
+#define FFT_BATCH_LOAD(p)     _mm256_loadu_ps(p)
+#define FFT_BATCH_STORE(p, v) _mm256_storeu_ps(p, v)
+#define FFT_BATCH_ADD(a, b)   _mm256_add_ps(a, b)
+#define FFT_BATCH_SUB(a, b)   _mm256_sub_ps(a, b)
+#define FFT_BATCH_MUL(a, b)   _mm256_mul_ps(a, b)
+#define FFT_BATCH_SPLAT(x)    _mm256_set1_ps(x)
+#elif defined(FFT_NEON)
+#define FFT_BATCH_WIDTH 4
+typedef float32x4_t fftBatchVec;
+#define FFT_BATCH_LOAD(p)     vld1q_f32(p)
+#define FFT_BATCH_STORE(p, v) vst1q_f32(p, v)
+#define FFT_BATCH_ADD(a, b)   vaddq_f32(a, b)
+#define FFT_BATCH_SUB(a, b)   vsubq_f32(a, b)
+#define FFT_BATCH_MUL(a, b)   vmulq_f32(a, b)
+#define FFT_BATCH_SPLAT(x)    vdupq_n_f32(x)
+#elif defined(FFT_SSE)
+#define FFT_BATCH_WIDTH 4
+typedef __m128 fftBatchVec;
+#define FFT_BATCH_LOAD(p)     _mm_loadu_ps(p)
+#define FFT_BATCH_STORE(p, v) _mm_storeu_ps(p, v)
+#define FFT_BATCH_ADD(a, b)   _mm_add_ps(a, b)
+#define FFT_BATCH_SUB(a, b)   _mm_sub_ps(a, b)
+#define FFT_BATCH_MUL(a, b)   _mm_mul_ps(a, b)
+#define FFT_BATCH_SPLAT(x)    _mm_set1_ps(x)
+#else
+#define FFT_BATCH_WIDTH 1
+typedef float fftBatchVec;
+#define FFT_BATCH_LOAD(p)     (*(p))
+#define FFT_BATCH_STORE(p, v) (*(p) = (v))
+#define FFT_BATCH_ADD(a, b)   ((a) + (b))
+#define FFT_BATCH_SUB(a, b)   ((a) - (b))
+#define FFT_BATCH_MUL(a, b)   ((a) * (b))
+#define FFT_BATCH_SPLAT(x)    (x)
+#endif
+
+/* (ar,ai) = (ar,ai) * (wr,wi), lane by lane. */
+#define FFT_BATCH_CMUL(ar, ai, wr, wi)					\
+  {									\
+    fftBatchVec tempR = FFT_BATCH_SUB(FFT_BATCH_MUL(ar, wr), FFT_BATCH_MUL(ai, wi)); \
+    ai = FFT_BATCH_ADD(FFT_BATCH_MUL(ar, wi), FFT_BATCH_MUL(ai, wr));	\
+    ar = tempR;								\
+  }
+
+#endif
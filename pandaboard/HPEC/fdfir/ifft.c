@@ -17,6 +17,7 @@
 
 
 #include "fdFir.h"
+#include "fftSimd.h"
 
 
 
@@ -32,204 +33,213 @@
   In the ifft, we work backwards.  We start where the stride is 1
   (small butterflies), and work to larger butterflies where the stride
   is equivalent to the inputLength / 4.
+  Given fewer phases than the length has, each transform does the phases
+  with the largest blocks, and leaves the smallest to the caller; 
+  fftFused() does those itself (fdFirFused.c).
 */
 
 
 
 
-void ifft(struct fdFirVariables *fdFirVars)
+void ifft(int filter, int inputLength, int phases,
+	  float * inputData, float * twiddleConjPtr)
 {
 
-  int filter        = fdFirVars->currentFilter;  /*which filter in the bank*/
-  int inputLength   = fdFirVars->inputLength;  /* input length */
-  int phases        = fdFirVars->phases;    /* number of phases in the ifft */
-  int butterflies   = fdFirVars->butterflies;  /* number of butterflies per phase */
-  int stride        = 2;  /* stride between elements in the butterfly */
-  int inc           = 4;  /*number of elements to increment after each butterfly */
-  int reset         = inputLength / 4;  /* cntr determining how many butterflies to 
-					   do before going to the second element of 
-					   the input vector.  */
-  int resetSave     = reset;/*  reset needs to be saved as we decrement it's value.  */
-  int shift;   /*  Variable used to determine the exponent of the twiddle factors */
-  float *dataPtr1   = (fdFirVars->input.data) + (inputLength * 2 * filter);/* pointers */
-  float *dataPtr2   = (fdFirVars->input.data) + (inputLength * 2 * filter);/*    to    */
-  float *dataPtr3   = (fdFirVars->input.data) + (inputLength * 2 * filter);/*   data   */
-  float *twiddlePtr = fdFirVars->twiddleConjPtr;  /* point to the start of the twiddle 
-						 factors vector.  */
+  /*int filter            which filter in the bank*/
+  /*int inputLength       input length */
+  /*int phases            number of phases in the ifft */
+  /*float *twiddleConjPtr point to the start of the conjugate twiddle tables. */
+  /*float *inputData      point to the start of the input.  */
+
+  int span          = inputLength;  /* elements per block in the
+				       current phase */
+  int m;                      /* butterflies per block, and the distance
+				 between the elements of a butterfly */
+  int phase, block, j;
+  float *dataPtr    = inputData + (inputLength * 2 * filter);
+  float *blockPtr;
+  float *ptr;
+  float *twiddlePtr;
+  float *w1Ptr, *w2Ptr, *w3Ptr;
 
   float ar,ai,br,bi,cr,ci,dr,di;  /*  butterfly input variables  */
-  int phase;  /*  current phase variable */
-  int butterfly;  /*  current butterfly variable  */
-  int exp1, exp2, exp3;  /* exponent variables for twiddle factors */
-  /*  int exp0;*/
-  float twiddle1_r, twiddle1_i;/*  twiddle  */
-  float twiddle2_r, twiddle2_i;/*  factor   */
-  float twiddle3_r, twiddle3_i;/* variables */
-  float twiddle4_r, twiddle4_i;/*           */
-
+  float t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;
   float res1r, res1i, res2r, res2i;  /* butterfly result */
   float res3r, res3i, res4r, res4i;  /*   variables      */
 
-  int tmp1,tmp2,tmp3;  /* temporary variables for utility use. */
-  /*  
-      Temporary variables for butterfly optimization below.  These are
-      not needed unless the optimizations found below are uncommented.
+#if defined(FFT_NEON)
+  float32x4x2_t a, b, c, d, w;
+  float32x4_t v1r, v1i, v2r, v2i, v3r, v3i, v4r, v4i;
+#elif defined(FFT_SSE)
+  __m128 a, b, c, d, w, v1, v2, v3, v4;
+  __m128 sign    = _mm_set_ps(1, -1, 1, -1);
+  __m128 negImag = _mm_set_ps(-1, 1, -1, 1);
+#endif
+
+  /*
+    The blocks of the first phase span RADIX elements, RADIX times more
+    for each phase left out.
   */
-  /* float t1r, t1i, t2r, t2i, t3r, t3i, t4r, t4i;*/
-
+  for(phase = 1; phase < phases; phase++)
+    {
+      span = span / RADIX;
+    }
 
   for(phase = phases-1; phase >= 0; phase--)
     {
-      dataPtr1 = dataPtr2 = dataPtr3;
-
-      for(butterfly = 0; butterfly < butterflies; butterfly++)
+      m = span / RADIX;
+
+      /*
+	The tables run from the largest span down, and the tables of
+	the spans above this one hold 2*(inputLength - span) floats.
+	note that these point to the twiddle factor's conjugate values
+	in twiddleConjPtr.
+      */
+      twiddlePtr = twiddleConjPtr + 2 * (inputLength - span);
+      w1Ptr      = twiddlePtr;
+      w2Ptr      = w1Ptr + 2 * m;
+      w3Ptr      = w2Ptr + 2 * m;
+
+      for(block = 0; block < inputLength; block += span)
 	{
-	  if(reset == 0)
+	  blockPtr = dataPtr + 2 * block;
+	  j = 0;
+
+#if defined(FFT_NEON)
+	  for(; j + FFT_SIMD_WIDTH <= m; j += FFT_SIMD_WIDTH)
 	    {
-	      dataPtr2 = dataPtr2 + 2;
-	      dataPtr1 = dataPtr2;
-	      reset    = resetSave;
+	      ptr = blockPtr + 2 * j;
+	      a = vld2q_f32(ptr);
+	      b = vld2q_f32(ptr + 2 * m);
+	      c = vld2q_f32(ptr + 4 * m);
+	      d = vld2q_f32(ptr + 6 * m);
+
+	      w = vld2q_f32(w1Ptr + 2 * j);
+	      FFT_NEON_CMUL(b.val[0], b.val[1], w.val[0], w.val[1]);
+	      w = vld2q_f32(w2Ptr + 2 * j);
+	      FFT_NEON_CMUL(c.val[0], c.val[1], w.val[0], w.val[1]);
+	      w = vld2q_f32(w3Ptr + 2 * j);
+	      FFT_NEON_CMUL(d.val[0], d.val[1], w.val[0], w.val[1]);
+
+	      v1r = vaddq_f32(a.val[0], c.val[0]);   /* t1 = a + c */
+	      v1i = vaddq_f32(a.val[1], c.val[1]);
+	      v2r = vaddq_f32(b.val[0], d.val[0]);   /* t2 = b + d */
+	      v2i = vaddq_f32(b.val[1], d.val[1]);
+	      v3r = vsubq_f32(a.val[0], c.val[0]);   /* t3 = a - c */
+	      v3i = vsubq_f32(a.val[1], c.val[1]);
+	      v4r = vsubq_f32(b.val[1], d.val[1]);   /* t4 = -i(b - d) */
+	      v4i = vsubq_f32(d.val[0], b.val[0]);
+
+	      a.val[0] = vaddq_f32(v1r, v2r);
+	      a.val[1] = vaddq_f32(v1i, v2i);
+	      b.val[0] = vsubq_f32(v3r, v4r);
+	      b.val[1] = vsubq_f32(v3i, v4i);
+	      c.val[0] = vsubq_f32(v1r, v2r);
+	      c.val[1] = vsubq_f32(v1i, v2i);
+	      d.val[0] = vaddq_f32(v3r, v4r);
+	      d.val[1] = vaddq_f32(v3i, v4i);
+
+	      vst2q_f32(ptr, a);
+	      vst2q_f32(ptr + 2 * m, b);
+	      vst2q_f32(ptr + 4 * m, c);
+	      vst2q_f32(ptr + 6 * m, d);
 	    }
-	  /*
-	    Calculate the exponents for the twiddle factors.
-	  */
-
-	  if (phase == 0)
+#elif defined(FFT_SSE)
+	  for(; j + FFT_SIMD_WIDTH <= m; j += FFT_SIMD_WIDTH)
 	    {
-	      tmp1 = 1;
+	      ptr = blockPtr + 2 * j;
+	      a = _mm_loadu_ps(ptr);
+	      b = _mm_loadu_ps(ptr + 2 * m);
+	      c = _mm_loadu_ps(ptr + 4 * m);
+	      d = _mm_loadu_ps(ptr + 6 * m);
+
+	      w = _mm_loadu_ps(w1Ptr + 2 * j);
+	      FFT_SSE_CMUL(b, w, sign);
+	      w = _mm_loadu_ps(w2Ptr + 2 * j);
+	      FFT_SSE_CMUL(c, w, sign);
+	      w = _mm_loadu_ps(w3Ptr + 2 * j);
+	      FFT_SSE_CMUL(d, w, sign);
+
+	      v1 = _mm_add_ps(a, c);                                    /* t1 */
+	      v2 = _mm_add_ps(b, d);                                    /* t2 */
+	      v3 = _mm_sub_ps(a, c);                                    /* t3 */
+	      v4 = FFT_SSE_MUL_NEG_I(_mm_sub_ps(b, d), negImag);        /* t4 */
+
+	      _mm_storeu_ps(ptr,         _mm_add_ps(v1, v2));
+	      _mm_storeu_ps(ptr + 2 * m, _mm_sub_ps(v3, v4));
+	      _mm_storeu_ps(ptr + 4 * m, _mm_sub_ps(v1, v2));
+	      _mm_storeu_ps(ptr + 6 * m, _mm_add_ps(v3, v4));
 	    }
-	  else
+#endif
+
+	  for(; j < m; j++)
 	    {
-	      shift = (phase - 1) * 2;
-	      tmp1 = 4<<shift;
-  	    }
-
-	  tmp2 = butterfly / tmp1;
-	  tmp3 = tmp1 * tmp2;
-	  /*exp0 = 0;*/
-	  exp1 = 2 * tmp3;
-	  exp2 = 4 * tmp3;
-	  exp3 = 6 * tmp3;
-
-	  /*
-	    The following elements a,b,c,d (r,i) are the four inputs
-	    to the butterfly operation below.
-	  */
-	  ar = *(dataPtr1);
-	  ai = *(dataPtr1 + 1);
-	  br = *(dataPtr1 + stride);
-	  bi = *(dataPtr1 + stride + 1);
-	  cr = *(dataPtr1 + 2 * stride);
-	  ci = *(dataPtr1 + 2 * stride + 1);
-	  dr = *(dataPtr1 + 3 * stride);
-	  di = *(dataPtr1 + 3 * stride + 1);
-	  
-
-	  /*
-	    The following for twiddle factors (r,i) are the four twiddle
-	    factors for the butterfly operation below.
-	  */
-	  /*
-	    note that these twiddle pointers actually point to the twiddle
-	    factor's conjugate values in fdFirVars->twiddleConjPtr.
-	  */
-	  twiddle1_r = 1;
-	  twiddle1_i = 0;
-	  twiddle2_r = *(twiddlePtr + exp1);
-	  twiddle2_i = *(twiddlePtr + exp1 + 1);
-	  twiddle3_r = *(twiddlePtr + exp2);
-	  twiddle3_i = *(twiddlePtr + exp2 + 1);
-	  twiddle4_r = *(twiddlePtr + exp3);
-	  twiddle4_i = *(twiddlePtr + exp3 + 1);
-	 
-
-	  
-	  /* 
-	    The following complex multiplies perform multiplications
-	    of the butterfly results by the respective twiddle factors.
-	    the results of the complex multiplies are placed back in
-	    r and i.  The CPLX_MUL macro can be found in fdFir.h
-	  */
-
-	  CPLX_MUL(ar, ai, twiddle1_r, twiddle1_i );
-	  CPLX_MUL(br, bi, twiddle2_r, twiddle2_i );
-	  CPLX_MUL(cr, ci, twiddle3_r, twiddle3_i );
-	  CPLX_MUL(dr, di, twiddle4_r, twiddle4_i );
-
- 
-	  /*
-	    The following 8 operations make up a Radix 4 butterfly.
-	  */
-	  
-	  res1r = ar + br + cr + dr;
-	  res1i = ai + bi + ci + di;
-	  res4r = ar + bi - cr - di;
-	  res4i = ai - br - ci + dr;
-	  res3r = ar - br + cr - dr;
-	  res3i = ai - bi + ci - di;           
-	  res2r = ar - bi - cr + di;           
-	  res2i = ai + br - ci - dr;           
-	  
-
-	  /*
-	    The following code could be an optimization for the above 8
-	    operations. Below performs 16 adds/subtracts versus the code 
-	    above performing 24 add/subtracts.  Unfortunatly the code below
-	    did perform slower than the above code; however, this is often 
-	    an optimization made to various fft implementations.
-	    
-	    To use this code, the temporary variables (t1r, t1i...) must be
-	    uncommented above)
-	  */
-	  /*
-	    t1r = ar + cr;
-	    t1i = ai + ci;
-	    t2r = br + dr;
-	    t2i = bi + di;
-	    t3r = ar - cr;
-	    t3i = ai - ci;
-	    t4r = br - dr;
-	    t4i = bi - di;
-	    
-	    res1r = t1r + t2r;
-	    res1i = t1i + t2i;
-	    res4r = t3r + t4i;
-	    res4i = t3i - t4r;
-	    res3r = t1r - t2r;
-	    res3i = t1i - t2i;
-	    res2r = t3r - t4i;
-	    res2i = t3i + t4r;
-	  */
-
-
-	  /*  Normally, we do a divide by inputLength on each
-	      element in the LAST Phase.  For optimization 
-	      purposes, I've moved the elDivide into the elDiv
-	      routine in FDFIR.
-	  */
-
-
-	  /*
-	    store the results.
-	  */
-	  *(dataPtr1)                  = res1r;
-	  *(dataPtr1 + 1)              = res1i;
-	  *(dataPtr1 + stride)         = res2r;
-	  *(dataPtr1 + stride + 1)     = res2i;
-	  *(dataPtr1 + 2 * stride)     = res3r;
-	  *(dataPtr1 + 2 * stride + 1) = res3i;
-	  *(dataPtr1 + 3 * stride)     = res4r;
-	  *(dataPtr1 + 3 * stride + 1) = res4i;
-
-
-	  dataPtr1 = dataPtr1 + inc*2;
-	  reset--;
-	}/*end butterflies*/
-      stride    = stride    * RADIX;  /* 4X the stride as previous phase*/ 
-      inc       = inc       * RADIX;  /* increment 4X as many elements after
-				       each butterfly     */
-      reset     = resetSave / RADIX;  /* reset 4X as often  */
-      resetSave = resetSave / RADIX;  /* reset 4X as often  */
+	      ptr = blockPtr + 2 * j;
+
+	      /*
+		The following elements a,b,c,d (r,i) are the four inputs
+		to the butterfly operation below.
+	      */
+	      ar = *(ptr);
+	      ai = *(ptr + 1);
+	      br = *(ptr + 2 * m);
+	      bi = *(ptr + 2 * m + 1);
+	      cr = *(ptr + 4 * m);
+	      ci = *(ptr + 4 * m + 1);
+	      dr = *(ptr + 6 * m);
+	      di = *(ptr + 6 * m + 1);
+
+	      /* 
+		The following complex multiplies perform multiplications
+		of the butterfly inputs by the respective twiddle factors.
+		The CPLX_MUL macro can be found in fdFir.h
+	      */
+	      CPLX_MUL(br, bi, w1Ptr[2 * j], w1Ptr[2 * j + 1]);
+	      CPLX_MUL(cr, ci, w2Ptr[2 * j], w2Ptr[2 * j + 1]);
+	      CPLX_MUL(dr, di, w3Ptr[2 * j], w3Ptr[2 * j + 1]);
+
+	      /*
+		The following operations make up a Radix 4 butterfly.
+	      */
+	      t1r = ar + cr;
+	      t1i = ai + ci;
+	      t2r = br + dr;
+	      t2i = bi + di;
+	      t3r = ar - cr;
+	      t3i = ai - ci;
+	      t4r = bi - di;
+	      t4i = dr - br;
+
+	      res1r = t1r + t2r;
+	      res1i = t1i + t2i;
+	      res2r = t3r - t4r;
+	      res2i = t3i - t4i;
+	      res3r = t1r - t2r;
+	      res3i = t1i - t2i;
+	      res4r = t3r + t4r;
+	      res4i = t3i + t4i;
+
+	      /*  Normally, we do a divide by inputLength on each
+		  element in the LAST Phase.  For optimization 
+		  purposes, I've moved the elDivide into the elDiv
+		  routine in FDFIR.
+	      */
+
+	      /*
+		store the results.
+	      */
+	      *(ptr)                 = res1r;
+	      *(ptr + 1)             = res1i;
+	      *(ptr + 2 * m)         = res2r;
+	      *(ptr + 2 * m + 1)     = res2i;
+	      *(ptr + 4 * m)         = res3r;
+	      *(ptr + 4 * m + 1)     = res3i;
+	      *(ptr + 6 * m)         = res4r;
+	      *(ptr + 6 * m + 1)     = res4i;
+	    }/*end butterflies*/
+	}/*end blocks*/
+
+      span = span * RADIX;  /* 4X the block size as previous phase*/ 
     }/* end phases*/
 
 }
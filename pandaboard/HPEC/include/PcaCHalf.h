@@ -0,0 +1,217 @@
+/******************************************************************************
+** File: PcaCHalf.h
+**
+** HPEC Challenge Benchmark Suite
+** Common Header File
+**
+** Contents:
+**    Half precision storage for the data of the PCA C kernels.
+** Description:
+**    Two 16 bit formats are supported:
+**
+**      PCA_FP16 - IEEE 754 binary16: 5 exponent bits, 11 bits of
+**                 precision, largest value 65504.
+**      PCA_BF16 - bfloat16, the top half of a float: the same 8 exponent
+**                 bits and range as a float, 8 bits of precision.
+**
+**    A PcaCArrayHalf is created and freed with the macros of PcaCArray.h,
+**    with pca_half as the type, and filled from a float array with
+**    pca_floats_to_halves.  Data files stay in float; the conversions
+**    belong outside the timed region of a kernel.  Conversion rounds to
+**    nearest, ties to even, so an element read back differs from the
+**    original by at most PCA_FP16_EPS (or PCA_BF16_EPS) of its magnitude,
+**    or for fp16 by PCA_FP16_TINY below the normal range.
+**
+**    Vector conversion is used where the processor has it: F16C on x86
+**    (-mf16c) and the NEON half precision extension on ARM
+**    (-mfpu=neon-fp16) for fp16, SSE2 and NEON shifts for bf16.  For
+**    kernels that widen in registers, PCA_FP16_WIDEN4(p) and
+**    PCA_BF16_WIDEN4(p) load 4 halves at p as a vector of 4 floats (an
+**    __m128 or a float32x4_t), and are defined only where that is one or
+**    two instructions.
+**
+**    Like PcaCTimer.h, this file defines functions: include it in only one
+**    file of each program.
+**
+******************************************************************************/
+#ifndef PCA_CHALF_H
+#define PCA_CHALF_H
+
+#include <string.h>
+#include "PcaCArray.h"
+
+#if defined(__F16C__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Formats */
+#define PCA_FP16 1
+#define PCA_BF16 2
+
+/* The largest relative error of one conversion, half an ulp. */
+#define PCA_FP16_EPS (1.0 / 2048.0)
+#define PCA_BF16_EPS (1.0 / 256.0)
+
+/* The largest absolute error of an fp16 subnormal, half of 2^-24. */
+#define PCA_FP16_TINY (1.0 / 33554432.0)
+
+/* The same for a bf16 subnormal, half of 2^-133 (rounded up). */
+#define PCA_BF16_TINY 4.6e-41
+
+/* 16-bit unsigned integer type, holding the bits of a half. */
+typedef unsigned short pca_half;
+
+typedef struct PcaCArrayHalf {
+  pca_half            *data;
+  void                *datav;
+  unsigned int         size[3];
+  unsigned int         ndims;
+  unsigned int         rctype;
+} PcaCArrayHalf;
+
+union PcaHalfWord {
+  float  f;
+  uint32 u;
+};
+
+#if defined(__F16C__)
+#define PCA_FP16_WIDEN4(p) _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *)(p)))
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__ARM_FP) && (__ARM_FP & 2)
+#define PCA_FP16_WIDEN4(p) vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)))
+#endif
+
+#if defined(__SSE2__)
+#define PCA_BF16_WIDEN4(p)						\
+  _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(),		\
+				      _mm_loadl_epi64((const __m128i *)(p))))
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define PCA_BF16_WIDEN4(p) vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(p), 16))
+#endif
+
+/**************************************************************************
+* Returns the format named "fp16" or "bf16", or 0.
+**************************************************************************/
+int pca_half_format(const char *name)
+{
+  if (name != NULL && strcmp(name, "fp16") == 0) return PCA_FP16;
+  if (name != NULL && strcmp(name, "bf16") == 0) return PCA_BF16;
+  return 0;
+}
+
+/**************************************************************************
+* Converts one float to a half, rounding to nearest even.  Out of range
+* fp16 values become infinities; NaNs stay NaNs.
+**************************************************************************/
+pca_half pca_float_to_half(int format, float value)
+{
+  union PcaHalfWord w, magic;
+  uint32            sign, odd;
+
+  w.f = value;
+  if (format == PCA_BF16) {
+    if ((w.u & 0x7fffffff) > 0x7f800000)
+      return (pca_half)((w.u >> 16) | 0x40);
+    return (pca_half)((w.u + 0x7fff + ((w.u >> 16) & 1)) >> 16);
+  }
+
+  sign = w.u & 0x80000000;
+  w.u ^= sign;
+  if (w.u >= (127 + 16) << 23) {
+    /* 65536 and beyond, infinities and NaNs */
+    return (pca_half)((sign >> 16) | (w.u > 0x7f800000 ? 0x7e00 : 0x7c00));
+  }
+  if (w.u < (127 - 14) << 23) {
+    /* Subnormal: the float adder rounds away the bits below 2^-24 */
+    magic.u = (127 - 1) << 23;
+    w.f += magic.f;
+    return (pca_half)((sign >> 16) | (w.u - magic.u));
+  }
+  /* Normal: rebias the exponent and round the 13 bits dropped */
+  odd  = (w.u >> 13) & 1;
+  w.u += ((uint32)(15 - 127) << 23) + 0xfff + odd;
+  return (pca_half)((sign >> 16) | (w.u >> 13));
+}
+
+/**************************************************************************
+* Converts one half to a float, exactly.
+**************************************************************************/
+float pca_half_to_float(int format, pca_half half)
+{
+  union PcaHalfWord w, magic;
+  uint32            exponent;
+
+  if (format == PCA_BF16) {
+    w.u = (uint32)half << 16;
+    return w.f;
+  }
+
+  w.u      = (uint32)(half & 0x7fff) << 13;
+  exponent = w.u & (0x7c00 << 13);
+  w.u     += (uint32)(127 - 15) << 23;
+  if (exponent == 0x7c00 << 13) {
+    /* Infinity or NaN */
+    w.u += (uint32)(128 - 16) << 23;
+  }
+  else if (exponent == 0) {
+    /* Zero or subnormal: renormalize through the float adder */
+    magic.u = (127 - 14) << 23;
+    w.u    += 1 << 23;
+    w.f    -= magic.f;
+  }
+  w.u |= (uint32)(half & 0x8000) << 16;
+  return w.f;
+}
+
+/**************************************************************************
+* Converts n floats to halves.
+**************************************************************************/
+void pca_floats_to_halves(int format, const float *in, pca_half *out, unsigned long n)
+{
+  unsigned long i = 0;
+
+  if (format == PCA_FP16) {
+#if defined(__F16C__)
+    for (; i + 4 <= n; i += 4)
+      _mm_storel_epi64((__m128i *)(out + i), _mm_cvtps_ph(_mm_loadu_ps(in + i), 0));
+#elif defined(PCA_FP16_WIDEN4)
+    for (; i + 4 <= n; i += 4)
+      vst1_u16(out + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in + i))));
+#endif
+  }
+  for (; i < n; i++)
+    out[i] = pca_float_to_half(format, in[i]);
+}
+
+/**************************************************************************
+* Converts n halves to floats.
+**************************************************************************/
+void pca_halves_to_floats(int format, const pca_half *in, float *out, unsigned long n)
+{
+  unsigned long i = 0;
+
+  if (format == PCA_FP16) {
+#if defined(__F16C__)
+    for (; i + 4 <= n; i += 4)
+      _mm_storeu_ps(out + i, PCA_FP16_WIDEN4(in + i));
+#elif defined(PCA_FP16_WIDEN4)
+    for (; i + 4 <= n; i += 4)
+      vst1q_f32(out + i, PCA_FP16_WIDEN4(in + i));
+#endif
+  }
+  else {
+#if defined(__SSE2__)
+    for (; i + 4 <= n; i += 4)
+      _mm_storeu_ps(out + i, PCA_BF16_WIDEN4(in + i));
+#elif defined(PCA_BF16_WIDEN4)
+    for (; i + 4 <= n; i += 4)
+      vst1q_f32(out + i, PCA_BF16_WIDEN4(in + i));
+#endif
+  }
+  for (; i < n; i++)
+    out[i] = pca_half_to_float(format, in[i]);
+}
+
+#endif
@@ -9,6 +9,12 @@
 **  Fast Givens QR algorithm, see Golub and Van Loan's "Matrix Computations," 
 **  sections 5.1.13 and 5.2.5.
 **
+**  'householder' runs the blocked Householder QR of qrHouseholder.c
+**  instead, whose trailing updates are complex matrix-matrix products.
+**  'parallel' runs the Fast Givens QR on QR_THREADS threads, with the
+**  rotations in wavefront order (qrParallel.c).  All write the same Q and
+**  R files, checked by qrVerify.
+**
 ** Input/Output:
 **  The input matrix is stored in file "./data/<DataSetNum>-qr-inmatrix.dat".
 **  The output matrices Q and R will be stored in the files 
@@ -18,7 +24,7 @@
 **  "./data/<DataSetNum>-qr-timing.dat".
 **
 ** Command:
-**   qr <DataSetNum>
+**   qr <DataSetNum> [givens | householder | parallel]
 **
 ** Author: Ryan Haney
 **         MIT Lincoln Laboratory
@@ -30,6 +36,7 @@
 
 #include "PcaCArray.h"
 #include "PcaCTimer.h"
+#include "qr.h"
 
 /*
 ** Function: initialize_matrices
@@ -77,6 +84,261 @@ void initialize_matrices(struct PcaCArrayFloat * M, struct PcaCArrayFloat * D)
   }
 }
 
+/*
+** Function: givens_transform
+**
+** Compute the Fast Givens transformation that zeroes the element a2 of
+** row i of A against the element a1 of row i-1, in the current column:
+** values alpha, beta, and what type of transform we're doing (1 or 2),
+** which is returned.  d1 and d2 point to D[i-1] and D[i], and are updated.
+*/
+int givens_transform(ComplexFloat *a1, ComplexFloat *a2, float *d1, float *d2,
+		     ComplexFloat *alpha_out, ComplexFloat *beta_out)
+{
+  /* Fast givens transformation values and temporaries */
+  ComplexFloat alpha, beta;
+  float gamma, temp;
+
+  /* Transform type (1 or 2) */
+  int type;
+
+  /* If the current value is zero, we have nothing to cancel out. */
+  /* Therefore, we set alpha and beta to zero and use a type 2    */
+  /* transformation...  Essentially we multiply by a 2x2          */
+  /* identity matrix                                              */
+  if(a2->r == 0 && a2->i == 0) {
+    type = 2;
+    alpha.r = 0.0;
+    alpha.i = 0.0;
+    beta = alpha;
+  }
+  /* The current value is not zero.  Therefore compute transform   */
+  /* values alpha and beta that will zero out the current element. */
+  else {
+    /* Compute alpha = -a1/a2 */
+    temp = a2->r*a2->r + a2->i*a2->i;
+    alpha.r = -(a1->r*a2->r + a1->i*a2->i)/temp;
+    alpha.i = -(a1->i*a2->r - a1->r*a2->i)/temp;
+ 
+    /* Compute beta = -conj(alpha)*d2/d1 */
+    temp = (*d2)/(*d1);
+    beta.r = -alpha.r * temp;
+    beta.i = alpha.i * temp;
+
+    /* Compute gamma = -alpha*beta...  We'll simplify this to        */
+    /* -alpha*-conj(alpha)*(d2/d1) = (alpha.r^2 + alpha.i^2)*(d2/d1) */
+    gamma = (alpha.r*alpha.r + alpha.i*alpha.i)*temp;
+
+    /* Check the gamma value.  If it's over 1 we'll take the     */
+    /* reciprocal of our alpha, beta, and gamma values to retain */
+    /* numerical stability.                                      */
+    if(gamma <= 1.0) {
+      type = 1;
+	  
+      /* Update the D values */
+      temp = *d1;
+      *d1 = (1 + gamma)*(*d2);
+      *d2 = (1 + gamma)*temp;
+    }
+    else {
+      type = 2;
+
+      /* Compute alpha = 1/alpha */
+      temp = alpha.r*alpha.r + alpha.i*alpha.i;
+      alpha.r = alpha.r/temp;
+      alpha.i = -alpha.i/temp;
+	  
+      /* Compute beta = 1/beta */
+      temp = beta.r*beta.r + beta.i*beta.i;
+      beta.r = beta.r/temp;
+      beta.i = -beta.i/temp;
+	  
+      /* Compute 1/gamma */
+      gamma = 1/gamma;
+
+      /* Update the D values */
+      *d1 = (1+gamma)*(*d1);
+      *d2 = (1+gamma)*(*d2);
+    }	
+  } /* if(*a2 == 0) */
+
+  *alpha_out = alpha;
+  *beta_out = beta;
+  return type;
+}
+
+/*
+** Function: givens_rows
+**
+** Apply a Fast Givens transformation to n elements of two rows of A
+** (pre-multiplication), starting at a3 in row i-1 and a4 in row i.
+** In matlab notation:
+**
+**                     |beta   1  |
+**    A([i-1 i],j:n) = | 1   alpha| * A([i-1 i],j:n),
+**
+** for a type 1 transform.  For a type 2 transform use [1 beta; alpha 1].
+** The elements are independent, so the rows may be updated in pieces.
+*/
+void givens_rows(int type, ComplexFloat alpha, ComplexFloat beta,
+		 ComplexFloat *a3, ComplexFloat *a4, int n)
+{
+  int k;
+  ComplexFloat tau;
+  float temp;
+
+  /* ------------- TYPE 1 TRANSFORMATION ---------------- */
+  if(type == 1) {
+    for(k = 0; k < n; k++) {
+      /* Temporarily store a3. */
+      tau = (*a3);
+	  
+      /* Update the rows of A. */
+      /* a3 = beta * a3 + a4 */
+      temp = a3->r;
+      a3->r = a3->r*beta.r - a3->i*beta.i + a4->r;
+      a3->i = temp*beta.i + a3->i*beta.r + a4->i;
+
+      /* a4 = tau + alpha*a4 */
+      temp = a4->r;
+      a4->r = tau.r + a4->r*alpha.r - a4->i*alpha.i;
+      a4->i = tau.i + temp*alpha.i + a4->i*alpha.r;
+
+      /* Increment pointers. */
+      a3++;
+      a4++;
+    }
+  }
+  /* ---------- TYPE 2 TRANSFORMATION ---------- */
+  else {
+    for(k = 0; k < n; k++) {
+      /* Temporarily store a3. */
+      tau = (*a3);
+	  
+      /* Update the rows of A. */
+      /* a3 = a3 + beta*a4 */
+      a3->r = a3->r + beta.r*a4->r - beta.i*a4->i;
+      a3->i = a3->i + beta.r*a4->i + beta.i*a4->r;
+
+      /* a4 = alpha*tau + a4 */
+      a4->r = alpha.r*tau.r - alpha.i*tau.i + a4->r;
+      a4->i = alpha.r*tau.i + alpha.i*tau.r + a4->i;
+
+      /* Increment pointers. */
+      a3++;
+      a4++;
+    }
+  }
+}
+
+/*
+** Function: givens_columns
+**
+** Apply a Fast Givens transformation to n elements of two columns of M
+** (post-multiplication), starting at m1 in column i-1 and m2 in column i.
+** In matlab notation:
+**
+**                     |beta   1  |'
+**    M(:,[i-1 i]) = [ | 1   alpha| * M(:,[i-1 i])' ]',
+**
+** for a type 1 transform.  For a type 2 transform use [1 alpha; beta 1]'.
+** Like givens_rows, the columns may be updated in pieces.
+*/
+void givens_columns(int type, ComplexFloat alpha, ComplexFloat beta,
+		    ComplexFloat *m1, ComplexFloat *m2, int n)
+{
+  int k;
+  ComplexFloat tau;
+  float temp;
+
+  /* ------------- TYPE 1 TRANSFORMATION ---------------- */
+  if(type == 1) {
+    for(k = 0; k < n; k++) {
+      /* Temporarily store m1 */
+      tau = (*m1);
+	  
+      /* Update the columns of M. */
+      /* m1 = beta'*m1 + m2 */
+      temp = m1->r;
+      m1->r = beta.r*m1->r + beta.i*m1->i + m2->r;
+      m1->i = beta.r*m1->i - beta.i*temp + m2->i;
+
+      /* m2 = tau + alpha'*m2 */
+      temp = m2->r;
+      m2->r = tau.r + alpha.r*m2->r + alpha.i*m2->i;
+      m2->i = tau.i + alpha.r*m2->i - alpha.i*temp;
+	  
+      /* Increment pointers. */
+      m1++;
+      m2++;
+    }
+  }
+  /* ---------- TYPE 2 TRANSFORMATION ---------- */
+  else {
+    for(k = 0; k < n; k++) {
+      /* Temporarily store m1 */
+      tau = (*m1);
+	  
+      /* Update the columns of M. */
+      /* m1 = m1 + beta'*m2 */
+      m1->r = m1->r + beta.r*m2->r + beta.i*m2->i;
+      m1->i = m1->i + beta.r*m2->i - beta.i*m2->r;
+	  
+      /* m2 = alpha'*tau + m2 */
+      m2->r = alpha.r*tau.r + alpha.i*tau.i + m2->r;
+      m2->i = alpha.r*tau.i - alpha.i*tau.r + m2->i;
+	  
+      /* Increment pointers. */
+      m1++;
+      m2++;
+    }
+  }
+}
+
+/*
+** Function: givens_form
+**
+** Form rows first to last-1 of the outputs, once D holds 1/square root of
+** each of its elements: Q = M * D^(-1/2), and R = D^(-1/2) * T (where T is
+** the upper triangularized version of A), in-place in A.
+*/
+void givens_form(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
+		 float * D, ComplexFloat * Q, int first, int last)
+{
+  int i, j;
+  struct ComplexFloat *a1, *m1, *q1;
+  float *d1;
+
+  /* Compute Q = M * D^(-1/2) */
+  /* This will assign into the new matrix Q.  Recall that the matrix */
+  /* M is stored in column major order, while the matrix Q is stored */
+  /* in row major order.                                             */
+  q1 = Q + first*rows;
+  for(i = first; i < last; i++) {
+    d1 = D;
+    m1 = M+i;
+    for(j = 0; j < rows; j++) {
+      q1->r = m1->r * (*d1);
+      q1->i = m1->i * (*d1);
+      m1 += rows;
+      q1++;
+      d1++;
+    }
+  }
+  /* Compute R = D^(-1/2) * T.  This will still assign in-place into */
+  /* the original input matrix A.                                    */
+  a1 = A + first*cols;
+  d1 = D + first;
+  for(i = first; i < last; i++) {
+    for(j = 0; j < cols; j++) {
+      a1->r = a1->r * (*d1);
+      a1->i = a1->i * (*d1);
+      a1++;
+    }
+    d1++;
+  }
+}
+
 /*
 ** Function: qr
 **
@@ -99,17 +361,14 @@ void qr(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
 	float * D, ComplexFloat * Q) 
 {
   /* Loop counters */
-  int i, j, k;
+  int i, j;
 
   /* Data pointers */
-  struct ComplexFloat *a1, *a2, *a3, *a4;
-  struct ComplexFloat *m1, *m2;
+  struct ComplexFloat *a1, *a2;
   float *d1, *d2;  
-  struct ComplexFloat *q1;
 
-  /* Fast givens transformation values and temporaries */
-  ComplexFloat alpha, beta, tau;
-  float gamma, temp;
+  /* Fast givens transformation values */
+  ComplexFloat alpha, beta;
   
   /* Transform type (1 or 2) */
   int type;
@@ -128,179 +387,14 @@ void qr(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
     /* Loop from the last to the jth row of A (Up to the diagonal). */
     for(i = rows-1; i > j; i--) {
 
-      /* ============================================================= */
-      /* Compute the Fast Givens transformation matrix: Values alpha,  */
-      /* beta, and what type of transform we're doing (1 or 2).        */
-      /* ============================================================= */
-
-      /* If the current value is zero, we have nothing to cancel out. */
-      /* Therefore, we set alpha and beta to zero and use a type 2    */
-      /* transformation...  Essentially we multiply by a 2x2          */
-      /* identity matrix                                              */
-      if(a2->r == 0 && a2->i == 0) {
-	type = 2;
-	alpha.r = 0.0;
-	alpha.i = 0.0;
-	beta = alpha;
-      }
-      /* The current value is not zero.  Therefore compute transform   */
-      /* values alpha and beta that will zero out the current element. */
-      else {
-	/* Compute alpha = -a1/a2 */
-	temp = a2->r*a2->r + a2->i*a2->i;
-	alpha.r = -(a1->r*a2->r + a1->i*a2->i)/temp;
-	alpha.i = -(a1->i*a2->r - a1->r*a2->i)/temp;
- 
-	/* Compute beta = -conj(alpha)*d2/d1 */
-	temp = (*d2)/(*d1);
-	beta.r = -alpha.r * temp;
-	beta.i = alpha.i * temp;
-
-	/* Compute gamma = -alpha*beta...  We'll simplify this to        */
-	/* -alpha*-conj(alpha)*(d2/d1) = (alpha.r^2 + alpha.i^2)*(d2/d1) */
-	gamma = (alpha.r*alpha.r + alpha.i*alpha.i)*temp;
-
-	/* Check the gamma value.  If it's over 1 we'll take the     */
-	/* reciprocal of our alpha, beta, and gamma values to retain */
-	/* numerical stability.                                      */
-	if(gamma <= 1.0) {
-	  type = 1;
-	  
-	  /* Update the D values */
-	  temp = *d1;
-	  *d1 = (1 + gamma)*(*d2);
-	  *d2 = (1 + gamma)*temp;
-	}
-	else {
-	  type = 2;
-
-	  /* Compute alpha = 1/alpha */
-	  temp = alpha.r*alpha.r + alpha.i*alpha.i;
-	  alpha.r = alpha.r/temp;
-	  alpha.i = -alpha.i/temp;
-	  
-	  /* Compute beta = 1/beta */
-	  temp = beta.r*beta.r + beta.i*beta.i;
-	  beta.r = beta.r/temp;
-	  beta.i = -beta.i/temp;
-	  
-	  /* Compute 1/gamma */
-	  gamma = 1/gamma;
-
-	  /* Update the D values */
-	  *d1 = (1+gamma)*(*d1);
-	  *d2 = (1+gamma)*(*d2);
-	}	
-      } /* if(*a2 == 0) */
-
-      /* ================================================================== */
-      /* Perform update of matrices A and M (pre and post multiplications). */
-      /* In matlab notation:                                                */
-      /*                                                                    */
-      /*                     |beta   1  |                                   */
-      /*    A([i-1 i],j:n) = | 1   alpha| * A([i-1 i],j:n),                 */
-      /*                                                                    */
-      /* and...                                                             */
-      /*                     |beta   1  |'                                  */
-      /*    M(:,[i-1 i]) = [ | 1   alpha| * M(:,[i-1 i])' ]',               */
-      /*                                                                    */
-      /* for a type 1 transform.                                            */
-      /* For a type 2 transform use [1 beta; alpha 1] for an A update,      */
-      /* and [1 alpha; beta 1]' for the update to M.                        */
-      /* ================================================================== */ 
-      
-      /* Setup the data pointers.  a3 is set to a1 or A[i-1][j].  a4 is set */
-      /* to a2 or A[i][j].  m1 is set to M[0][j], and m2 to M[0][i].        */
-      a3 = a1;
-      a4 = a2;
-      m1 = M + (i-1)*rows;
-      m2 = M + i*rows;
-
-      /* ------------- TYPE 1 TRANSFORMATION ---------------- */
-      if(type == 1) {
-	/* Pre-multiplication (A update) */
-	for(k = j; k < cols; k++) {
-	  /* Temporarily store a3. */
-	  tau = (*a3);
-	  
-	  /* Update the rows of A. */
-	  /* a3 = beta * a3 + a4 */
-	  temp = a3->r;
-	  a3->r = a3->r*beta.r - a3->i*beta.i + a4->r;
-	  a3->i = temp*beta.i + a3->i*beta.r + a4->i;
-
-	  /* a4 = tau + alpha*a4 */
-	  temp = a4->r;
-	  a4->r = tau.r + a4->r*alpha.r - a4->i*alpha.i;
-	  a4->i = tau.i + temp*alpha.i + a4->i*alpha.r;
-
-	  /* Increment pointers. */
-	  a3++;
-	  a4++;
-	}
-	/* Post-multiplication (M update) */
-	for(k = 0; k < rows; k++) {
-	  
-	  /* Temporarily store m1 */
-	  tau = (*m1);
-	  
-	  /* Update the columns of M. */
-	  /* m1 = beta'*m1 + m2 */
-	  temp = m1->r;
-	  m1->r = beta.r*m1->r + beta.i*m1->i + m2->r;
-	  m1->i = beta.r*m1->i - beta.i*temp + m2->i;
-
-	  /* m2 = tau + alpha'*m2 */
-	  temp = m2->r;
-	  m2->r = tau.r + alpha.r*m2->r + alpha.i*m2->i;
-	  m2->i = tau.i + alpha.r*m2->i - alpha.i*temp;
-	  
-	  /* Increment pointers. */
-	  m1++;
-	  m2++;
-	}
-      }
-      /* ---------- TYPE 2 TRANSFORMATION ---------- */
-      else {
-		
-	/* Pre-multiplication (A update) */
-	for(k = j; k < cols; k++) {
-	  /* Temporarily store a3. */
-	  tau = (*a3);
-	  
-	  /* Update the rows of A. */
-	  /* a3 = a3 + beta*a4 */
-	  a3->r = a3->r + beta.r*a4->r - beta.i*a4->i;
-	  a3->i = a3->i + beta.r*a4->i + beta.i*a4->r;
-
-	  /* a4 = alpha*tau + a4 */
-	  a4->r = alpha.r*tau.r - alpha.i*tau.i + a4->r;
-	  a4->i = alpha.r*tau.i + alpha.i*tau.r + a4->i;
-
-	  /* Increment pointers. */
-	  a3++;
-	  a4++;
-	}
-	/* Post-multiplication (M update) */
-	for(k = 0; k < rows; k++) {
-	  
-	  /* Temporarily store m1 */
-	  tau = (*m1);
-	  
-	  /* Update the columns of M. */
-	  /* m1 = m1 + beta'*m2 */
-	  m1->r = m1->r + beta.r*m2->r + beta.i*m2->i;
-	  m1->i = m1->i + beta.r*m2->i - beta.i*m2->r;
-	  
-	  /* m2 = alpha'*tau + m2 */
-	  m2->r = alpha.r*tau.r + alpha.i*tau.i + m2->r;
-	  m2->i = alpha.r*tau.i - alpha.i*tau.r + m2->i;
-	  
-	  /* Increment pointers. */
-	  m1++;
-	  m2++;
-	}
-      }  /* if(type == 1) */
+      /* Compute the Fast Givens transformation matrix. */
+      type = givens_transform(a1, a2, d1, d2, &alpha, &beta);
+
+      /* Perform update of matrices A and M (pre and post              */
+      /* multiplications): rows i-1 and i of A from column j on, and   */
+      /* columns i-1 and i of M.                                       */
+      givens_rows(type, alpha, beta, a1, a2, cols-j);
+      givens_columns(type, alpha, beta, M + (i-1)*rows, M + i*rows, rows);
       
       /* Set the data pointers for the next iteration.  The A values shift  */
       /* up a row.  Therefore a2 points to where a1 was in the previous     */
@@ -312,14 +406,14 @@ void qr(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
       d2 = d1;
       d1--;
 
-    } /* for(j = 0; j < cols; j++) */
+    } /* for(i = rows-1; i > j; i--) */
 
     /* Compute 1/square root of D[j][j].  Subsequent iterations will  */
     /* not access this element.  We'll need the 1/square root of each */
     /* diagonal element to compute the final Q and R values.          */
     *d2 = (float)(1/sqrt((double)*d2));
 
-  } /* for(i = rows-1; i > j; i--) */
+  } /* for(j = 0; j < cols; j++) */
 
   /* Compute 1/square root of the remaining rows-cols D values. */
   d1 = D+cols;
@@ -328,35 +422,8 @@ void qr(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
     d1++;
   }
 
-  /* Compute Q = M * D^(-1/2) */
-  /* This will assign into the new matrix Q.  Recall that the matrix */
-  /* M is stored in column major order, while the matrix Q is stored */
-  /* in row major order.                                             */
-  q1 = Q;
-  for(i = 0; i < rows; i++) {
-    d1 = D;
-    m1 = M+i;
-    for(j = 0; j < rows; j++) {
-      q1->r = m1->r * (*d1);
-      q1->i = m1->i * (*d1);
-      m1 += rows;
-      q1++;
-      d1++;
-    }
-  }
-  /* Compute R = D^(-1/2) * T (where T is the upper triangularized     */
-  /* version of A).  This will still assign in-place into the original */
-  /* input matrix A.                                                   */
-  a1 = A;
-  d1 = D;
-  for(i = 0; i < rows; i++) {
-    for(j = 0; j < cols; j++) {
-      a1->r = a1->r * (*d1);
-      a1->i = a1->i * (*d1);
-      a1++;
-    }
-    d1++;
-  }
+  /* Compute Q and R. */
+  givens_form(rows, cols, A, M, D, Q, 0, rows);
 
   return;
 }
@@ -386,6 +453,13 @@ int main(int argc, char **argv)
   /* Temporary matrix used for Q computation.  This matrix will be */
   /* stored column-wise.                                           */     
   PcaCArrayFloat M;
+
+  /* Workspace of the Householder QR. */
+  PcaCArrayFloat work;
+
+  /* The factorization to run, QR_MODE_GIVENS, QR_MODE_HOUSEHOLDER, */
+  /* or QR_MODE_PARALLEL.                                           */
+  int mode = QR_MODE_GIVENS;
   
   /* Temporary timing variable used to store the initial start time. */
   pca_timer_t    timer;
@@ -399,7 +473,16 @@ int main(int argc, char **argv)
 
   /* Build the input and output file names.  If no arguments are specified, */
   /* show the user the proper usage of the program.                         */
-  if (argc == 2) {
+  if (argc == 3 && strcmp(argv[2], "householder") == 0) {
+    mode = QR_MODE_HOUSEHOLDER;
+  }
+  else if (argc == 3 && strcmp(argv[2], "parallel") == 0) {
+    mode = QR_MODE_PARALLEL;
+  }
+  else if (argc == 3 && strcmp(argv[2], "givens") != 0) {
+    argc = 0;
+  }
+  if (argc == 2 || argc == 3) {
     /* Allocate memory for the file names. */
     inmatrixfile =    (char*) malloc(strlen("./data/") + strlen(argv[1]) +
 				     strlen("-qr-inmatrix.dat") + 1); 
@@ -418,7 +501,7 @@ int main(int argc, char **argv)
   }
   else {
     printf("No data set specified.\n");
-    printf("Usage: qr <DataSetNum>\n");
+    printf("Usage: qr <DataSetNum> [givens | householder | parallel]\n");
     exit(-1);
   }
 
@@ -450,20 +533,50 @@ int main(int argc, char **argv)
 		       rows, PCA_COMPLEX);
   pca_create_carray_1d(float, rtime, 1, PCA_REAL);
   pca_create_carray_1d(float, D, rows, PCA_REAL);
+  pca_create_carray_1d(float, work, qr_householder_work_size(rows, cols),
+		       PCA_COMPLEX);
 
   /* Initialize the matrix D and M (which will eventually form to Q) to I */
   initialize_matrices(&M, &D);
 
-  /* Run and time the Complex Fast Givens QR. */
+  /* The Householder QR accumulates its Q from the identity. */
+  if(mode == QR_MODE_HOUSEHOLDER) {
+    initialize_matrices(&outmatrix_q, &D);
+  }
+
+  /* The parallel QR starts its threads before timing. */
+  if(mode == QR_MODE_PARALLEL) {
+    qr_parallel_setup(cols, qr_thread_processors(QR_THREADS));
+  }
+
+  /* Run and time the QR. */
   timer = startTimer();
   
-  qr(rows, cols, 
-     (struct ComplexFloat *)&inmatrix.data[0], 
-     (struct ComplexFloat *)&M.data[0], 
-     &D.data[0], (struct ComplexFloat *)&outmatrix_q.data[0]);
+  if(mode == QR_MODE_HOUSEHOLDER) {
+    qr_householder(rows, cols,
+		   (struct ComplexFloat *)&inmatrix.data[0],
+		   (struct ComplexFloat *)&outmatrix_q.data[0],
+		   (struct ComplexFloat *)&work.data[0]);
+  }
+  else if(mode == QR_MODE_PARALLEL) {
+    qr_parallel(rows, cols,
+		(struct ComplexFloat *)&inmatrix.data[0],
+		(struct ComplexFloat *)&M.data[0],
+		&D.data[0], (struct ComplexFloat *)&outmatrix_q.data[0]);
+  }
+  else {
+    qr(rows, cols, 
+       (struct ComplexFloat *)&inmatrix.data[0], 
+       (struct ComplexFloat *)&M.data[0], 
+       &D.data[0], (struct ComplexFloat *)&outmatrix_q.data[0]);
+  }
 
   rtime.data[0] = stopTimer(timer); 
 
+  if(mode == QR_MODE_PARALLEL) {
+    qr_parallel_complete();
+  }
+
   /* Output the calculated time in seconds. */
   printf("Done.  Latency: %f s.\n", rtime.data[0]);
 
@@ -481,6 +594,7 @@ int main(int argc, char **argv)
   clean_mem(float, rtime);
   clean_mem(float, outmatrix_q);
   clean_mem(float, M);
+  clean_mem(float, work);
   clean_mem(float, inmatrix);
 
   return 0;
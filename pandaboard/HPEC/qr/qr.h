@@ -0,0 +1,95 @@
+/******************************************************************************
+** File: qr.h
+**
+** HPEC Challenge Benchmark Suite
+** QR Kernel Benchmark
+**
+** Contents:
+**  Declarations shared by the QR kernel's factorizations.  qr.c holds the
+**  Complex Fast Givens QR and the benchmark driver; qrParallel.c the same
+**  Fast Givens QR in wavefront order over the threads of qrThread.c;
+**  qrHouseholder.c the blocked Householder QR.  All take the row major
+**  rows x cols input A, overwrite it with R, and write the row major
+**  rows x rows Q.
+**
+******************************************************************************/
+
+#ifndef QR_H
+#define QR_H
+
+#include "PcaCArray.h"
+
+/* Factorizations, selected by the optional second command line argument. */
+#define QR_MODE_GIVENS      0
+#define QR_MODE_HOUSEHOLDER 1
+#define QR_MODE_PARALLEL    2
+
+/* Threads of the parallel Givens QR; 0 is one per online processor. */
+#ifndef QR_THREADS
+#define QR_THREADS 0
+#endif
+
+/* Polls of a waiting thread at a barrier before it yields its processor. */
+#ifndef QR_SPIN
+#define QR_SPIN 1000
+#endif
+
+/* Columns per panel of the blocked Householder QR. */
+#ifndef QR_BLOCK
+#define QR_BLOCK 8
+#endif
+
+/* Columns of the matrix updated at a time by a block reflector. */
+#ifndef QR_STRIP
+#define QR_STRIP 64
+#endif
+
+/*
+** Complex Fast Givens QR (qr.c).  M and D are set up by
+** initialize_matrices.
+*/
+void qr(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
+	float * D, ComplexFloat * Q);
+
+/* The steps of qr, shared with the parallel Givens QR (qr.c). */
+int  givens_transform(ComplexFloat *a1, ComplexFloat *a2, float *d1,
+		      float *d2, ComplexFloat *alpha_out,
+		      ComplexFloat *beta_out);
+void givens_rows(int type, ComplexFloat alpha, ComplexFloat beta,
+		 ComplexFloat *a3, ComplexFloat *a4, int n);
+void givens_columns(int type, ComplexFloat alpha, ComplexFloat beta,
+		    ComplexFloat *m1, ComplexFloat *m2, int n);
+void givens_form(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
+		 float * D, ComplexFloat * Q, int first, int last);
+
+/*
+** Parallel Complex Fast Givens QR (qrParallel.c), with the arguments of
+** qr.  qr_parallel_setup starts the threads and qr_parallel_complete
+** stops them, outside the timed region.
+*/
+void qr_parallel_setup(int cols, int num_threads);
+void qr_parallel(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
+		 float * D, ComplexFloat * Q);
+void qr_parallel_complete(void);
+
+/*
+** Thread pool (qrThread.c).  A job is run by every thread: 'thread' is 0
+** to num_threads-1, and the caller of qr_thread_run is thread 0.
+*/
+typedef void (*qr_job)(void *arg, int thread, int num_threads);
+
+int  qr_thread_processors(int num_threads);
+void qr_thread_start(int num_threads);
+void qr_thread_run(qr_job job, void *arg);
+void qr_thread_barrier(int thread);
+void qr_thread_stop(void);
+
+/*
+** Blocked Householder QR (qrHouseholder.c).  Q must hold the identity,
+** and work qr_householder_work_size(rows, cols) complex values.
+*/
+int  qr_householder_work_size(int rows, int cols);
+void qr_householder(int rows, int cols, ComplexFloat *A, ComplexFloat *Q,
+		    ComplexFloat *work);
+
+#endif
@@ -0,0 +1,471 @@
+/******************************************************************************
+** File: qrHouseholder.c
+**
+** HPEC Challenge Benchmark Suite
+** QR Kernel Benchmark
+**
+** Contents:
+**  The ANSI C blocked Householder QR, an alternative to the Complex Fast
+**  Givens QR of qr.c.  For more information, see Golub and Van Loan's
+**  "Matrix Computations," sections 5.1.2, 5.1.7 and 5.2.3, and Schreiber
+**  and Van Loan, "A Storage-Efficient WY Representation for Products of
+**  Householder Transformations".
+**
+**  The columns of A are taken in panels of QR_BLOCK.  Each panel is
+**  factored a column at a time, with complex Householder reflectors
+**  H = I - tau v v' as in LAPACK's xGEQRF, so that the diagonal of R is
+**  real.  The reflectors of the panel are then gathered into the compact
+**  WY form H1 H2 ... Hb = I - V T V', with T upper triangular, and the
+**  rest of A is updated with three matrix-matrix products:
+**
+**    W = V' A2,   W = T' W,   A2 = A2 - V W.
+**
+**  Q is formed by applying the block reflectors to the identity, last
+**  panel first, with the same three products.  The products work on
+**  QR_STRIP columns at a time, so that W stays in the L1 cache, and
+**  nearly all the flops of the factorization are in them.  With SSE or
+**  NEON their inner loops take two complex values per vector, the cross
+**  terms of each product from the vector with real and imaginary parts
+**  swapped; otherwise they are plain C.
+**
+******************************************************************************/
+
+#include <math.h>
+
+#include "qr.h"
+
+/*
+** x * c, for a vector x of two complex values and a complex scalar c, is
+** x * QR_DUP(c.r) + QR_SWAP(x) * (QR_DUP(c.i) * qr_sign), where qr_sign
+** is (-1, 1, -1, 1).
+*/
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define QR_VECTOR __m128
+#define QR_LOAD(p)       _mm_loadu_ps(p)
+#define QR_STORE(p, v)   _mm_storeu_ps(p, v)
+#define QR_DUP(f)        _mm_set1_ps(f)
+#define QR_MUL(a, b)     _mm_mul_ps(a, b)
+#define QR_MAC(acc, x, a, b)						\
+  acc = _mm_add_ps(acc, _mm_add_ps(_mm_mul_ps(x, a),			\
+				   _mm_mul_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2,3,0,1)), b)))
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define QR_VECTOR float32x4_t
+#define QR_LOAD(p)       vld1q_f32(p)
+#define QR_STORE(p, v)   vst1q_f32(p, v)
+#define QR_DUP(f)        vdupq_n_f32(f)
+#define QR_MUL(a, b)     vmulq_f32(a, b)
+#define QR_MAC(acc, x, a, b)						\
+  acc = vmlaq_f32(vmlaq_f32(acc, x, a), vrev64q_f32(x), b)
+#endif
+
+#ifdef QR_VECTOR
+static const float qr_sign[4] = { -1.0, 1.0, -1.0, 1.0 };
+#endif
+
+/*
+** Function: qr_householder_work_size
+**
+** The number of complex values of workspace qr_householder needs: the
+** tau of each column, one panel of V, the T of each panel, and W.
+*/
+int qr_householder_work_size(int rows, int cols)
+{
+  int panels = (cols + QR_BLOCK - 1) / QR_BLOCK;
+  int strip = QR_STRIP > QR_BLOCK ? QR_STRIP : QR_BLOCK;
+
+  return cols + rows * QR_BLOCK + panels * QR_BLOCK * QR_BLOCK
+    + QR_BLOCK * strip;
+}
+
+/*
+** Function: house_generate
+**
+** Compute the Householder reflector H = I - tau v v' for which H' x is
+** beta e1, with beta real, for the n values of x, stride elements apart.
+** x is overwritten with beta followed by v(2:n); v(1) is 1.  When x is
+** already beta e1, tau is 0 and H the identity.
+*/
+static void house_generate(int n, ComplexFloat *x, int stride,
+			   ComplexFloat *tau)
+{
+  int i;
+  double norm, beta, scale_r, scale_i, temp;
+  ComplexFloat alpha, *xi;
+
+  alpha = *x;
+  norm = 0.0;
+  for(i = 1, xi = x + stride; i < n; i++, xi += stride) {
+    norm += (double)xi->r*xi->r + (double)xi->i*xi->i;
+  }
+
+  if(norm == 0.0 && alpha.i == 0.0) {
+    tau->r = 0.0;
+    tau->i = 0.0;
+    return;
+  }
+
+  /* beta = -sign(real(alpha)) * norm(x) */
+  beta = sqrt((double)alpha.r*alpha.r + (double)alpha.i*alpha.i + norm);
+  if(alpha.r >= 0.0) {
+    beta = -beta;
+  }
+  tau->r = (float)((beta - alpha.r)/beta);
+  tau->i = (float)(-alpha.i/beta);
+
+  /* v(2:n) = x(2:n) / (alpha - beta) */
+  temp = (alpha.r - beta)*(alpha.r - beta) + (double)alpha.i*alpha.i;
+  scale_r = (alpha.r - beta)/temp;
+  scale_i = -alpha.i/temp;
+  for(i = 1, xi = x + stride; i < n; i++, xi += stride) {
+    temp = xi->r;
+    xi->r = (float)(temp*scale_r - xi->i*scale_i);
+    xi->i = (float)(temp*scale_i + xi->i*scale_r);
+  }
+  x->r = (float)beta;
+  x->i = 0.0;
+}
+
+/*
+** Function: house_pack
+**
+** Copy the kb reflectors of a panel, stored below the diagonal of the m
+** rows of A (lda apart) starting at the panel's diagonal, into the row
+** major m x kb matrix V, with the ones on its diagonal and zeros above.
+*/
+static void house_pack(int m, int kb, ComplexFloat *A, int lda,
+		       ComplexFloat *V)
+{
+  int i, p;
+
+  for(i = 0; i < m; i++, A += lda, V += kb) {
+    for(p = 0; p < kb; p++) {
+      if(p < i) {
+	V[p] = A[p];
+      }
+      else {
+	V[p].r = (p == i) ? 1.0 : 0.0;
+	V[p].i = 0.0;
+      }
+    }
+  }
+}
+
+/*
+** Function: house_form_t
+**
+** Form the kb x kb upper triangular T of H1 H2 ... Hkb = I - V T V' from
+** the m x kb V and the tau of each reflector, a column at a time:
+**
+**   T(p,p) = tau(p),
+**   T(1:p-1,p) = -tau(p) T(1:p-1,1:p-1) V(:,1:p-1)' V(:,p).
+**
+** z holds kb complex values.
+*/
+static void house_form_t(int m, int kb, ComplexFloat *V, ComplexFloat *tau,
+			 ComplexFloat *T, ComplexFloat *z)
+{
+  int i, p, q, r;
+  ComplexFloat *vrow, s;
+
+  for(p = 0; p < kb; p++) {
+    /* z = V(:,1:p-1)' V(:,p); rows above p of V(:,p) are zero. */
+    for(q = 0; q < p; q++) {
+      z[q].r = 0.0;
+      z[q].i = 0.0;
+    }
+    for(i = p, vrow = V + p*kb; i < m; i++, vrow += kb) {
+      for(q = 0; q < p; q++) {
+	z[q].r += vrow[q].r*vrow[p].r + vrow[q].i*vrow[p].i;
+	z[q].i += vrow[q].r*vrow[p].i - vrow[q].i*vrow[p].r;
+      }
+    }
+
+    /* T(1:p-1,p) = -tau(p) T(1:p-1,1:p-1) z */
+    for(q = 0; q < p; q++) {
+      s.r = 0.0;
+      s.i = 0.0;
+      for(r = q; r < p; r++) {
+	s.r += T[q*kb+r].r*z[r].r - T[q*kb+r].i*z[r].i;
+	s.i += T[q*kb+r].r*z[r].i + T[q*kb+r].i*z[r].r;
+      }
+      T[q*kb+p].r = -(tau[p].r*s.r - tau[p].i*s.i);
+      T[q*kb+p].i = -(tau[p].r*s.i + tau[p].i*s.r);
+    }
+    T[p*kb+p] = tau[p];
+    for(q = p+1; q < kb; q++) {
+      T[q*kb+p].r = 0.0;
+      T[q*kb+p].i = 0.0;
+    }
+  }
+}
+
+/*
+** Function: house_apply
+**
+** Apply the block reflector I - V T V' (or, if adjoint, I - V T' V') to
+** the m x n matrix X, whose rows are ldx apart, QR_STRIP columns at a
+** time:  W = V' X,  W = T W (or T' W),  X = X - V W.  W holds kb x
+** QR_STRIP complex values.  The two products take four rows of X (or of
+** W) per pass over a row of W (or of X), so that each load and store of
+** the strip serves four multiply-adds.  V holds its zeros explicitly, so
+** the triangle at its top needs no special case.
+*/
+static void house_apply(int m, int n, int kb, ComplexFloat *V,
+			ComplexFloat *T, int adjoint, ComplexFloat *X,
+			int ldx, ComplexFloat *W)
+{
+  int i, j, p, q, j0, s;
+  ComplexFloat c0, c1, c2, c3, t;
+  ComplexFloat *x0, *x1, *x2, *x3, *w0, *w1, *w2, *w3, *vrow, *wq;
+#ifdef QR_VECTOR
+  QR_VECTOR sign = QR_LOAD(qr_sign);
+  QR_VECTOR acc, v, a0, a1, a2, a3, b0, b1, b2, b3;
+#endif
+
+  for(j0 = 0; j0 < n; j0 += QR_STRIP) {
+    s = (n - j0 < QR_STRIP) ? n - j0 : QR_STRIP;
+
+    /* W = V' X(:,j0:j0+s-1), four rows of X at a time. */
+    for(p = 0; p < kb*s; p++) {
+      W[p].r = 0.0;
+      W[p].i = 0.0;
+    }
+    for(i = 0; i + 3 < m; i += 4) {
+      x0 = X + i*ldx + j0;
+      x1 = x0 + ldx;
+      x2 = x1 + ldx;
+      x3 = x2 + ldx;
+      vrow = V + i*kb;
+      for(p = 0; p < kb; p++) {
+	c0 = vrow[p];
+	c1 = vrow[kb+p];
+	c2 = vrow[2*kb+p];
+	c3 = vrow[3*kb+p];
+	w0 = W + p*s;
+	j = 0;
+#ifdef QR_VECTOR
+	a0 = QR_DUP(c0.r);  b0 = QR_MUL(QR_DUP(-c0.i), sign);
+	a1 = QR_DUP(c1.r);  b1 = QR_MUL(QR_DUP(-c1.i), sign);
+	a2 = QR_DUP(c2.r);  b2 = QR_MUL(QR_DUP(-c2.i), sign);
+	a3 = QR_DUP(c3.r);  b3 = QR_MUL(QR_DUP(-c3.i), sign);
+	for(; j + 1 < s; j += 2) {
+	  acc = QR_LOAD(&w0[j].r);
+	  v = QR_LOAD(&x0[j].r);  QR_MAC(acc, v, a0, b0);
+	  v = QR_LOAD(&x1[j].r);  QR_MAC(acc, v, a1, b1);
+	  v = QR_LOAD(&x2[j].r);  QR_MAC(acc, v, a2, b2);
+	  v = QR_LOAD(&x3[j].r);  QR_MAC(acc, v, a3, b3);
+	  QR_STORE(&w0[j].r, acc);
+	}
+#endif
+	for(; j < s; j++) {
+	  w0[j].r += c0.r*x0[j].r + c0.i*x0[j].i + c1.r*x1[j].r + c1.i*x1[j].i
+	    + c2.r*x2[j].r + c2.i*x2[j].i + c3.r*x3[j].r + c3.i*x3[j].i;
+	  w0[j].i += c0.r*x0[j].i - c0.i*x0[j].r + c1.r*x1[j].i - c1.i*x1[j].r
+	    + c2.r*x2[j].i - c2.i*x2[j].r + c3.r*x3[j].i - c3.i*x3[j].r;
+	}
+      }
+    }
+    for(; i < m; i++) {
+      x0 = X + i*ldx + j0;
+      vrow = V + i*kb;
+      for(p = 0; p < kb; p++) {
+	c0 = vrow[p];
+	w0 = W + p*s;
+	j = 0;
+#ifdef QR_VECTOR
+	a0 = QR_DUP(c0.r);  b0 = QR_MUL(QR_DUP(-c0.i), sign);
+	for(; j + 1 < s; j += 2) {
+	  acc = QR_LOAD(&w0[j].r);
+	  v = QR_LOAD(&x0[j].r);  QR_MAC(acc, v, a0, b0);
+	  QR_STORE(&w0[j].r, acc);
+	}
+#endif
+	for(; j < s; j++) {
+	  w0[j].r += c0.r*x0[j].r + c0.i*x0[j].i;
+	  w0[j].i += c0.r*x0[j].i - c0.i*x0[j].r;
+	}
+      }
+    }
+
+    /* W = T W, top row first, or W = T' W, bottom row first, in place. */
+    for(j = 0; j < s; j++) {
+      if(!adjoint) {
+	for(p = 0; p < kb; p++) {
+	  t.r = 0.0;
+	  t.i = 0.0;
+	  for(q = p, wq = W + p*s + j; q < kb; q++, wq += s) {
+	    t.r += T[p*kb+q].r*wq->r - T[p*kb+q].i*wq->i;
+	    t.i += T[p*kb+q].r*wq->i + T[p*kb+q].i*wq->r;
+	  }
+	  W[p*s+j] = t;
+	}
+      }
+      else {
+	for(p = kb-1; p >= 0; p--) {
+	  t.r = 0.0;
+	  t.i = 0.0;
+	  for(q = 0, wq = W + j; q <= p; q++, wq += s) {
+	    t.r += T[q*kb+p].r*wq->r + T[q*kb+p].i*wq->i;
+	    t.i += T[q*kb+p].r*wq->i - T[q*kb+p].i*wq->r;
+	  }
+	  W[p*s+j] = t;
+	}
+      }
+    }
+
+    /* X(:,j0:j0+s-1) = X(:,j0:j0+s-1) - V W, four rows of W at a time. */
+    for(i = 0; i < m; i++) {
+      x0 = X + i*ldx + j0;
+      vrow = V + i*kb;
+      for(p = 0; p + 3 < kb; p += 4) {
+	c0 = vrow[p];
+	c1 = vrow[p+1];
+	c2 = vrow[p+2];
+	c3 = vrow[p+3];
+	w0 = W + p*s;
+	w1 = w0 + s;
+	w2 = w1 + s;
+	w3 = w2 + s;
+	j = 0;
+#ifdef QR_VECTOR
+	a0 = QR_DUP(-c0.r);  b0 = QR_MUL(QR_DUP(-c0.i), sign);
+	a1 = QR_DUP(-c1.r);  b1 = QR_MUL(QR_DUP(-c1.i), sign);
+	a2 = QR_DUP(-c2.r);  b2 = QR_MUL(QR_DUP(-c2.i), sign);
+	a3 = QR_DUP(-c3.r);  b3 = QR_MUL(QR_DUP(-c3.i), sign);
+	for(; j + 1 < s; j += 2) {
+	  acc = QR_LOAD(&x0[j].r);
+	  v = QR_LOAD(&w0[j].r);  QR_MAC(acc, v, a0, b0);
+	  v = QR_LOAD(&w1[j].r);  QR_MAC(acc, v, a1, b1);
+	  v = QR_LOAD(&w2[j].r);  QR_MAC(acc, v, a2, b2);
+	  v = QR_LOAD(&w3[j].r);  QR_MAC(acc, v, a3, b3);
+	  QR_STORE(&x0[j].r, acc);
+	}
+#endif
+	for(; j < s; j++) {
+	  x0[j].r -= c0.r*w0[j].r - c0.i*w0[j].i + c1.r*w1[j].r - c1.i*w1[j].i
+	    + c2.r*w2[j].r - c2.i*w2[j].i + c3.r*w3[j].r - c3.i*w3[j].i;
+	  x0[j].i -= c0.r*w0[j].i + c0.i*w0[j].r + c1.r*w1[j].i + c1.i*w1[j].r
+	    + c2.r*w2[j].i + c2.i*w2[j].r + c3.r*w3[j].i + c3.i*w3[j].r;
+	}
+      }
+      for(; p < kb; p++) {
+	c0 = vrow[p];
+	w0 = W + p*s;
+	j = 0;
+#ifdef QR_VECTOR
+	a0 = QR_DUP(-c0.r);  b0 = QR_MUL(QR_DUP(-c0.i), sign);
+	for(; j + 1 < s; j += 2) {
+	  acc = QR_LOAD(&x0[j].r);
+	  v = QR_LOAD(&w0[j].r);  QR_MAC(acc, v, a0, b0);
+	  QR_STORE(&x0[j].r, acc);
+	}
+#endif
+	for(; j < s; j++) {
+	  x0[j].r -= c0.r*w0[j].r - c0.i*w0[j].i;
+	  x0[j].i -= c0.r*w0[j].i + c0.i*w0[j].r;
+	}
+      }
+    }
+  }
+}
+
+/*
+** Function: qr_householder
+**
+** Compute the blocked Householder QR of the rows x cols matrix A, in
+** place: A is overwritten with R, and Q, which must hold the identity on
+** entry, with Q.  work holds qr_householder_work_size(rows, cols) complex
+** values.
+*/
+void qr_householder(int rows, int cols, ComplexFloat *A, ComplexFloat *Q,
+		    ComplexFloat *work)
+{
+  /* Loop counters */
+  int i, j, k, k0, kb, m;
+
+  /* Workspace: tau of each column, a panel of V, each panel's T, and W. */
+  ComplexFloat *tau = work;
+  ComplexFloat *V = tau + cols;
+  ComplexFloat *Ts = V + rows*QR_BLOCK;
+  ComplexFloat *W = Ts + ((cols + QR_BLOCK - 1)/QR_BLOCK)*QR_BLOCK*QR_BLOCK;
+  ComplexFloat *T;
+
+  /* Temporaries of the panel update */
+  ComplexFloat *a1, *v1, ct;
+
+  for(k0 = 0; k0 < cols; k0 += QR_BLOCK) {
+    kb = (cols - k0 < QR_BLOCK) ? cols - k0 : QR_BLOCK;
+    m = rows - k0;
+    T = Ts + (k0/QR_BLOCK)*QR_BLOCK*QR_BLOCK;
+
+    /* Factor the panel a column at a time.  H(k)' is applied to the   */
+    /* rest of the panel with w = v' A(k:,k+1:k0+kb-1) held in W.      */
+    for(k = k0; k < k0 + kb; k++) {
+      house_generate(rows - k, A + k*cols + k, cols, &tau[k]);
+      if(tau[k].r == 0.0 && tau[k].i == 0.0) {
+	continue;
+      }
+
+      for(j = k+1; j < k0 + kb; j++) {
+	W[j-k0].r = A[k*cols+j].r;
+	W[j-k0].i = A[k*cols+j].i;
+      }
+      for(i = k+1; i < rows; i++) {
+	v1 = A + i*cols + k;
+	for(j = k+1, a1 = v1 + 1; j < k0 + kb; j++, a1++) {
+	  W[j-k0].r += v1->r*a1->r + v1->i*a1->i;
+	  W[j-k0].i += v1->r*a1->i - v1->i*a1->r;
+	}
+      }
+      /* w = conj(tau) w */
+      for(j = k+1; j < k0 + kb; j++) {
+	ct = W[j-k0];
+	W[j-k0].r = tau[k].r*ct.r + tau[k].i*ct.i;
+	W[j-k0].i = tau[k].r*ct.i - tau[k].i*ct.r;
+      }
+      for(j = k+1; j < k0 + kb; j++) {
+	A[k*cols+j].r -= W[j-k0].r;
+	A[k*cols+j].i -= W[j-k0].i;
+      }
+      for(i = k+1; i < rows; i++) {
+	v1 = A + i*cols + k;
+	for(j = k+1, a1 = v1 + 1; j < k0 + kb; j++, a1++) {
+	  a1->r -= v1->r*W[j-k0].r - v1->i*W[j-k0].i;
+	  a1->i -= v1->r*W[j-k0].i + v1->i*W[j-k0].r;
+	}
+      }
+    }
+
+    /* Gather the panel into I - V T V' and update the rest of A with */
+    /* its adjoint.                                                    */
+    house_pack(m, kb, A + k0*cols + k0, cols, V);
+    house_form_t(m, kb, V, tau + k0, T, W);
+    if(k0 + kb < cols) {
+      house_apply(m, cols - k0 - kb, kb, V, T, 1,
+		  A + k0*cols + k0 + kb, cols, W);
+    }
+  }
+
+  /* Q = (I - V1 T1 V1')(I - V2 T2 V2')... I, last panel first.  Before */
+  /* a panel is applied, Q is the identity outside rows and columns     */
+  /* k0 and up.                                                         */
+  for(k0 = ((cols - 1)/QR_BLOCK)*QR_BLOCK; k0 >= 0; k0 -= QR_BLOCK) {
+    kb = (cols - k0 < QR_BLOCK) ? cols - k0 : QR_BLOCK;
+    m = rows - k0;
+    T = Ts + (k0/QR_BLOCK)*QR_BLOCK*QR_BLOCK;
+    house_pack(m, kb, A + k0*cols + k0, cols, V);
+    house_apply(m, m, kb, V, T, 0, Q + k0*rows + k0, rows, W);
+  }
+
+  /* R is the upper triangle of A: clear the reflectors below it. */
+  for(i = 1; i < rows; i++) {
+    for(j = 0; j < i && j < cols; j++) {
+      A[i*cols+j].r = 0.0;
+      A[i*cols+j].i = 0.0;
+    }
+  }
+
+  return;
+}
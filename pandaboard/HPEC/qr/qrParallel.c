@@ -0,0 +1,195 @@
+/******************************************************************************
+** File: qrParallel.c
+**
+** HPEC Challenge Benchmark Suite
+** QR Kernel Benchmark
+**
+** Contents:
+**  The Complex Fast Givens QR of qr.c, run on the threads of qrThread.c.
+**
+**  qr zeroes the elements of each column from the bottom up, each one
+**  with a rotation of rows i-1 and i.  Rotations of different columns
+**  are independent when their row pairs are disjoint, which gives the
+**  wavefront order of Sameh and Kuck: the rotation zeroing A[i][j] runs
+**  at step
+**
+**      s = (rows-1-i) + 2*j,
+**
+**  one step after the rotation below it in its column, which last touched
+**  row i, and one after the rotation of the column before that last
+**  touched row i-1.  A step runs up to cols rotations at once, and there
+**  are about rows+cols steps, where qr runs rows*cols-cols*(cols+1)/2
+**  rotations one after another.
+**
+**  A step has two phases, each ended by a barrier:
+**    1. The transform of each rotation is computed (givens_transform), by
+**       the threads in turn, from its rows' elements in column j.
+**    2. The rotations' updates, rows i-1 and i of A from column j and
+**       columns i-1 and i of M, are laid end to end and cut into one
+**       equal piece per thread (givens_rows, givens_columns).
+**  Every row of A and D and every column of M sees the same rotations in
+**  the same order as in qr, with the same type 1 / type 2 selection, so
+**  Q and R come out the same.  Q and R are then formed by row bands.
+**
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "PcaCArray.h"
+#include "qr.h"
+
+/* The job of the threads: the matrices, and the transforms of a step. */
+struct qr_wavefront {
+  int           rows, cols;
+  ComplexFloat *A, *M, *Q;
+  float        *D;
+
+  /* Transform of the rotation of column j in the current step. */
+  int          *type;
+  ComplexFloat *alpha, *beta;
+};
+
+static struct qr_wavefront qr_wavefront;
+
+/*
+** Function: qr_parallel_setup
+**
+** Allocate the transforms of a step, and start num_threads threads.
+*/
+void qr_parallel_setup(int cols, int num_threads)
+{
+  qr_wavefront.type  = (int *)malloc(cols * sizeof(int));
+  qr_wavefront.alpha = (ComplexFloat *)malloc(cols * sizeof(ComplexFloat));
+  qr_wavefront.beta  = (ComplexFloat *)malloc(cols * sizeof(ComplexFloat));
+  if (qr_wavefront.type == NULL || qr_wavefront.alpha == NULL ||
+      qr_wavefront.beta == NULL) {
+    printf("qr_parallel_setup: out of memory\n");
+    exit(-1);
+  }
+
+  qr_thread_start(num_threads);
+}
+
+/*
+** Function: qr_wavefront_update
+**
+** Apply this thread's piece of the updates of the rotations of columns
+** first to last, the rotation of column j acting on rows i-1 and i with
+** i = rows-1-step+2*j.  Rotation j has cols-j elements of each row of A,
+** then rows elements of each column of M.
+*/
+static void qr_wavefront_update(struct qr_wavefront *w, int step,
+				int first, int last, long begin, long end)
+{
+  int  j, i, lo, hi;
+  long offset = 0;
+  ComplexFloat *a, *m;
+
+  for (j = first; j <= last && offset < end; j++) {
+    i = w->rows-1 - step + 2*j;
+
+    /* Rows i-1 and i of A from column j */
+    lo = (int)(begin > offset ? begin - offset : 0);
+    hi = (int)(end - offset < w->cols - j ? end - offset : w->cols - j);
+    if (lo < hi) {
+      a = w->A + (i-1)*w->cols + j;
+      givens_rows(w->type[j], w->alpha[j], w->beta[j],
+		  a + lo, a + w->cols + lo, hi - lo);
+    }
+    offset += w->cols - j;
+
+    /* Columns i-1 and i of M */
+    lo = (int)(begin > offset ? begin - offset : 0);
+    hi = (int)(end - offset < w->rows ? end - offset : w->rows);
+    if (lo < hi) {
+      m = w->M + (i-1)*w->rows;
+      givens_columns(w->type[j], w->alpha[j], w->beta[j],
+		     m + lo, m + w->rows + lo, hi - lo);
+    }
+    offset += w->rows;
+  }
+}
+
+/*
+** Function: qr_wavefront_job
+**
+** The factorization, run by each of num_threads threads.
+*/
+static void qr_wavefront_job(void *arg, int thread, int num_threads)
+{
+  struct qr_wavefront *w = (struct qr_wavefront *)arg;
+  int   rows = w->rows, cols = w->cols;
+  int   step, steps, first, last, count, j, i;
+  int   last_col = (cols < rows ? cols : rows-1) - 1;
+  long  total;
+  float *d1;
+
+  /* Column j has rotations in steps 2*j to rows-2+j. */
+  steps = last_col < 0 ? 0 : rows-1 + last_col;
+
+  for (step = 0; step < steps; step++) {
+    first = step - (rows-2) > 0 ? step - (rows-2) : 0;
+    last  = step/2 < last_col ? step/2 : last_col;
+    count = last - first + 1;
+
+    /* Phase 1: the transforms, and the new D values of their rows. */
+    for (j = first + thread; j <= last; j += num_threads) {
+      i = rows-1 - step + 2*j;
+      w->type[j] = givens_transform(w->A + (i-1)*cols + j, w->A + i*cols + j,
+				    w->D + (i-1), w->D + i,
+				    &w->alpha[j], &w->beta[j]);
+    }
+    qr_thread_barrier(thread);
+
+    /* Phase 2: the updates, split evenly. */
+    total = (long)count*(cols + rows) - ((long)(first + last)*count)/2;
+    qr_wavefront_update(w, step, first, last,
+			total*thread/num_threads,
+			total*(thread+1)/num_threads);
+    qr_thread_barrier(thread);
+  }
+
+  /* Compute 1/square root of the D values of this thread's rows, then */
+  /* Q and R of those rows once all of D is done.                      */
+  first = (int)((long)rows*thread/num_threads);
+  last  = (int)((long)rows*(thread+1)/num_threads);
+  for (d1 = w->D + first; d1 < w->D + last; d1++)
+    *d1 = (float)(1/sqrt((double)*d1));
+  qr_thread_barrier(thread);
+
+  givens_form(rows, cols, w->A, w->M, w->D, w->Q, first, last);
+}
+
+/*
+** Function: qr_parallel
+**
+** Compute the Complex Fast Givens QR factorization of A, as qr does, with
+** the rotations in wavefront order on the threads of qr_parallel_setup.
+*/
+void qr_parallel(int rows, int cols, ComplexFloat *A, ComplexFloat *M,
+		 float * D, ComplexFloat * Q)
+{
+  qr_wavefront.rows = rows;
+  qr_wavefront.cols = cols;
+  qr_wavefront.A    = A;
+  qr_wavefront.M    = M;
+  qr_wavefront.D    = D;
+  qr_wavefront.Q    = Q;
+
+  qr_thread_run(qr_wavefront_job, &qr_wavefront);
+}
+
+/*
+** Function: qr_parallel_complete
+**
+** Stop the threads, and free the transforms.
+*/
+void qr_parallel_complete(void)
+{
+  qr_thread_stop();
+  free(qr_wavefront.type);
+  free(qr_wavefront.alpha);
+  free(qr_wavefront.beta);
+}
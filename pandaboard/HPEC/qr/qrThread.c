@@ -0,0 +1,217 @@
+/******************************************************************************
+** File: qrThread.c
+**
+** HPEC Challenge Benchmark Suite
+** QR Kernel Benchmark
+**
+** Contents:
+**  The thread pool of the parallel QR.  The threads are started once,
+**  before timing, and wait between jobs; qr_thread_run() runs one job on
+**  all of them and returns when every thread has finished it.
+**
+**  Inside a job the threads meet at qr_thread_barrier(), once or twice
+**  for each step of the factorization.  The steps are short, so a
+**  waiting thread polls for the last one to arrive, and only after
+**  QR_SPIN polls yields its processor, in case there are more threads
+**  than processors.  The barrier uses the GCC __atomic builtins.
+**
+******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "qr.h"
+
+static int             qr_thread_num     = 1;
+static int             qr_thread_started = 0;
+static pthread_t      *qr_thread_ids     = NULL;
+static int            *qr_thread_index   = NULL;
+static pthread_mutex_t qr_thread_lock    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  qr_thread_wake    = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  qr_thread_done    = PTHREAD_COND_INITIALIZER;
+
+/* The current job; written by thread 0 under the lock. */
+static qr_job qr_thread_job;
+static void  *qr_thread_arg;
+static int    qr_thread_generation = 0;
+static int    qr_thread_pending    = 0;
+static int    qr_thread_quit       = 0;
+
+/* The barrier: threads arrived, and the sense of the last barrier left. */
+static int  qr_barrier_count = 0;
+static int  qr_barrier_sense = 0;
+static int *qr_barrier_local = NULL;
+
+static void *qr_thread_worker(void *arg)
+{
+  int    index = *(int *)arg;
+  int    generation = 0;
+  qr_job job;
+  void  *job_arg;
+
+  pthread_mutex_lock(&qr_thread_lock);
+  for (;;) {
+    while (generation == qr_thread_generation && !qr_thread_quit)
+      pthread_cond_wait(&qr_thread_wake, &qr_thread_lock);
+    if (qr_thread_quit)
+      break;
+    generation = qr_thread_generation;
+    job        = qr_thread_job;
+    job_arg    = qr_thread_arg;
+    pthread_mutex_unlock(&qr_thread_lock);
+
+    job(job_arg, index, qr_thread_num);
+
+    pthread_mutex_lock(&qr_thread_lock);
+    if (--qr_thread_pending == 0)
+      pthread_cond_signal(&qr_thread_done);
+  }
+  pthread_mutex_unlock(&qr_thread_lock);
+
+  return NULL;
+}
+
+/*
+** Function: qr_thread_processors
+**
+** The thread count to use for num_threads: itself, or one per online
+** processor when it is 0 or less.
+*/
+int qr_thread_processors(int num_threads)
+{
+  long online = 1;
+
+  if (num_threads > 0)
+    return num_threads;
+#ifdef _SC_NPROCESSORS_ONLN
+  online = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return (online < 1) ? 1 : (int)online;
+}
+
+/*
+** Function: qr_thread_start
+**
+** Start num_threads-1 threads; the caller is thread 0 of the pool.
+*/
+void qr_thread_start(int num_threads)
+{
+  int thread;
+
+  qr_thread_num = num_threads > 1 ? num_threads : 1;
+  if (qr_thread_num == 1)
+    return;
+
+  qr_thread_ids    = (pthread_t *)malloc(qr_thread_num * sizeof(pthread_t));
+  qr_thread_index  = (int *)malloc(qr_thread_num * sizeof(int));
+  qr_barrier_local = (int *)calloc(qr_thread_num, sizeof(int));
+  if (qr_thread_ids == NULL || qr_thread_index == NULL ||
+      qr_barrier_local == NULL) {
+    printf("qr_thread_start: out of memory\n");
+    exit(-1);
+  }
+
+  qr_thread_started = 1;
+  qr_thread_quit    = 0;
+  qr_barrier_count  = 0;
+  qr_barrier_sense  = 0;
+  for (thread = 1; thread < qr_thread_num; thread++) {
+    qr_thread_index[thread] = thread;
+    if (pthread_create(&qr_thread_ids[thread], NULL, qr_thread_worker,
+		       &qr_thread_index[thread]) != 0) {
+      printf("qr_thread_start: cannot start thread %d\n", thread);
+      exit(-1);
+    }
+  }
+}
+
+/*
+** Function: qr_thread_run
+**
+** Run job(arg, thread, num_threads) on every thread of the pool, and
+** return when all have returned.
+*/
+void qr_thread_run(qr_job job, void *arg)
+{
+  if (!qr_thread_started) {
+    job(arg, 0, 1);
+    return;
+  }
+
+  pthread_mutex_lock(&qr_thread_lock);
+  qr_thread_job     = job;
+  qr_thread_arg     = arg;
+  qr_thread_pending = qr_thread_num - 1;
+  qr_thread_generation++;
+  pthread_cond_broadcast(&qr_thread_wake);
+  pthread_mutex_unlock(&qr_thread_lock);
+
+  job(arg, 0, qr_thread_num);
+
+  pthread_mutex_lock(&qr_thread_lock);
+  while (qr_thread_pending > 0)
+    pthread_cond_wait(&qr_thread_done, &qr_thread_lock);
+  pthread_mutex_unlock(&qr_thread_lock);
+}
+
+/*
+** Function: qr_thread_barrier
+**
+** Return once every thread of the current job has called it, with the
+** writes each made before the call visible to all.  The barrier flips
+** qr_barrier_sense each time; the last thread to arrive resets the count
+** and flips it, the others wait for the flip.
+*/
+void qr_thread_barrier(int thread)
+{
+  int sense, spin;
+
+  if (qr_thread_num == 1)
+    return;
+
+  sense = qr_barrier_local[thread] = !qr_barrier_local[thread];
+  if (__atomic_add_fetch(&qr_barrier_count, 1, __ATOMIC_ACQ_REL) ==
+      qr_thread_num) {
+    __atomic_store_n(&qr_barrier_count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&qr_barrier_sense, sense, __ATOMIC_RELEASE);
+  }
+  else {
+    for (spin = 0;
+	 __atomic_load_n(&qr_barrier_sense, __ATOMIC_ACQUIRE) != sense;
+	 spin++) {
+      if (spin >= QR_SPIN)
+	sched_yield();
+    }
+  }
+}
+
+/*
+** Function: qr_thread_stop
+**
+** Stop the threads.
+*/
+void qr_thread_stop(void)
+{
+  int thread;
+
+  if (qr_thread_started) {
+    pthread_mutex_lock(&qr_thread_lock);
+    qr_thread_quit = 1;
+    pthread_cond_broadcast(&qr_thread_wake);
+    pthread_mutex_unlock(&qr_thread_lock);
+
+    for (thread = 1; thread < qr_thread_num; thread++)
+      pthread_join(qr_thread_ids[thread], NULL);
+
+    free(qr_thread_ids);
+    free(qr_thread_index);
+    free(qr_barrier_local);
+    qr_thread_started = 0;
+  }
+  qr_thread_num = 1;
+}
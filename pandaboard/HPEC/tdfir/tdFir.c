@@ -19,14 +19,19 @@
 #include "./tdFir.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "../include/PcaCTimer.h"
 
+struct tdFirVariables tdFirVars;
+
 
 
 int main(int argc, char **argv)
 {
   tdFirVars.arguments = argc;
   tdFirVars.dataSet = argv[1];
+  tdFirVars.modeName = (argc > 2) ? argv[2] : NULL;
+  tdFirVars.modeArg  = (argc > 3) ? argv[3] : NULL;
 
 
 
@@ -36,10 +41,10 @@ int main(int argc, char **argv)
       -pointers to data, filter, and result
       -inputLength;
     These are all in the tdFirVariables structure in tdFir.h
-    Along with the structure definition, I also instantiate an 
-    instanced called tdFirVars.  This is the same as doing:
+    tdFir.h only declares the instance, tdFirVars; it is defined 
+    once, at the top of this file:
     
-    struct tdFirVaribles tdFirVars;
+    struct tdFirVariables tdFirVars;
   */
   
 
@@ -107,17 +112,49 @@ void tdFirSetup(struct tdFirVariables *tdFirVars)
 {
 
 
-  int inputLength, filterLength, resultLength;
+  int inputLength, filterLength, resultLength, padded;
   char dataSetString[100];
   char filterSetString[100];
 
   if(tdFirVars->arguments == 1)
     {
       printf("No dataset provided\n");
-      printf("Usage: tdFir <dataset> \n");
+      printf("Usage: tdFir <dataset> [generic | stream [blockLength] | q15 | batch | fp16 | bf16]\n");
       exit(-1); /*return ;*/
     }
 
+  tdFirVars->mode = TDFIR_MODE_BANK;
+  if(tdFirVars->modeName != NULL)
+    {
+      if(strcmp(tdFirVars->modeName, "stream") == 0)
+	{
+	  tdFirVars->mode = TDFIR_MODE_STREAM;
+	}
+      else if(strcmp(tdFirVars->modeName, "generic") == 0)
+	{
+	  tdFirVars->mode = TDFIR_MODE_GENERIC;
+	}
+      else if(strcmp(tdFirVars->modeName, "q15") == 0)
+	{
+	  tdFirVars->mode = TDFIR_MODE_Q15;
+	}
+      else if(strcmp(tdFirVars->modeName, "batch") == 0)
+	{
+	  tdFirVars->mode = TDFIR_MODE_BATCH;
+	}
+      else if(strcmp(tdFirVars->modeName, "fp16") == 0 ||
+	      strcmp(tdFirVars->modeName, "bf16") == 0)
+	{
+	  tdFirVars->mode = TDFIR_MODE_HALF;
+	}
+      else
+	{
+	  printf("Unknown mode: %s\n", tdFirVars->modeName);
+	  printf("Usage: tdFir <dataset> [generic | stream [blockLength] | q15 | batch | fp16 | bf16]\n");
+	  exit(-1);
+	}
+    }
+
 
   sprintf(  dataSetString,"./data/%s-tdFir-input.dat" ,tdFirVars->dataSet);
   sprintf(filterSetString,"./data/%s-tdFir-filter.dat",tdFirVars->dataSet);
@@ -145,6 +182,85 @@ void tdFirSetup(struct tdFirVariables *tdFirVars)
   */
   zeroData(tdFirVars->result.data, resultLength, tdFirVars->numFilters);
 
+  /*
+    The streaming mode keeps one tdFirStream per filter, plus one block of
+    input and output scratch for the final, partial block.
+  */
+  tdFirVars->streams = NULL;
+  tdFirVars->blockPtr = NULL;
+  tdFirVars->blockResultPtr = NULL;
+
+  /*
+    Use a folded kernel for each filter with real or symmetric taps, and
+    for the rest a kernel specialized for this filter length when there is
+    one.  The specialized and folded kernels read each input from a
+    buffer padded with filterLength-1 zeros on either side, plus three for
+    the last group of four outputs; the zeros are written here, once.
+  */
+  tdFirVars->kernel = NULL;
+  tdFirVars->filterKinds = NULL;
+  tdFirVars->paddedInputPtr = NULL;
+  padded = 0;
+  if(tdFirVars->mode == TDFIR_MODE_BANK)
+    {
+      int filter;
+
+      tdFirVars->kernel = tdFirFindKernel(filterLength);
+      padded = (tdFirVars->kernel != NULL);
+
+      tdFirVars->filterKinds = malloc(tdFirVars->numFilters * sizeof(int));
+      for(filter = 0; filter < tdFirVars->numFilters; filter++)
+	{
+	  tdFirVars->filterKinds[filter] =
+	    tdFirClassifyFilter(tdFirVars->filter.data + (filter * (2*filterLength)),
+				filterLength);
+	  if(tdFirVars->filterKinds[filter] != TDFIR_FILTER_COMPLEX)
+	    {
+	      padded = 1;
+	    }
+	}
+    }
+  if(padded)
+    {
+      tdFirVars->paddedInputPtr = calloc(2 * (inputLength + 2 * (filterLength - 1) + 3),
+					 sizeof(float));
+    }
+
+  if(tdFirVars->mode == TDFIR_MODE_Q15)
+    {
+      tdFirQ15Setup(tdFirVars);
+    }
+  if(tdFirVars->mode == TDFIR_MODE_BATCH)
+    {
+      tdFirBatchSetup(tdFirVars);
+    }
+  if(tdFirVars->mode == TDFIR_MODE_HALF)
+    {
+      tdFirHalfSetup(tdFirVars);
+    }
+  if(tdFirVars->mode == TDFIR_MODE_STREAM)
+    {
+      int filter;
+
+      tdFirVars->blockLength = (tdFirVars->modeArg != NULL) ?
+	atoi(tdFirVars->modeArg) : TDFIR_DEFAULT_BLOCK;
+      if(tdFirVars->blockLength <= 0)
+	{
+	  printf("Invalid block length: %s\n", tdFirVars->modeArg);
+	  exit(-1);
+	}
+
+      tdFirVars->streams = malloc(tdFirVars->numFilters * sizeof(struct tdFirStream));
+      tdFirVars->blockPtr = malloc(2 * tdFirVars->blockLength * sizeof(float));
+      tdFirVars->blockResultPtr = malloc(2 * tdFirVars->blockLength * sizeof(float));
+      for(filter = 0; filter < tdFirVars->numFilters; filter++)
+	{
+	  tdFirStreamSetup(&tdFirVars->streams[filter],
+			   tdFirVars->filter.data + (filter * (2*filterLength)),
+			   filterLength, tdFirVars->blockLength);
+	}
+    }
+
 }
 
 
@@ -160,8 +276,65 @@ void tdFir(struct tdFirVariables *tdFirVars)
     I will need a timer to evaluate my functions performace.  The
     pca_timer_t is located in PcaCTimer.h
   */
+  pca_timer_t t;
+  t = startTimer();
+
+
+
+  switch(tdFirVars->mode)
+    {
+    case TDFIR_MODE_STREAM:
+      tdFirStreamRun(tdFirVars);
+      break;
+    case TDFIR_MODE_Q15:
+      tdFirQ15(tdFirVars);
+      break;
+    case TDFIR_MODE_BATCH:
+      tdFirBatch(tdFirVars);
+      break;
+    case TDFIR_MODE_HALF:
+      tdFirHalf(tdFirVars);
+      break;
+    default:
+      tdFirBank(tdFirVars);
+      break;
+    }
+
+
+
+  /*
+    Stop the timer.  Print out the
+    total time in Seconds it took to do the TDFIR.
+  */
+
+  tdFirVars->time.data[0] = stopTimer(t);
+
+  printf("Done.  Latency: %f s.\n", tdFirVars->time.data[0]);
+
+  /* One complex multiply-accumulate per filter tap per input sample. */
+  if(tdFirVars->time.data[0] > 0)
+    {
+      printf("Throughput: %f MMAC/s.\n",
+	     (float)tdFirVars->numFilters * tdFirVars->inputLength *
+	     tdFirVars->filterLength / tdFirVars->time.data[0] / 1e6);
+    }
+
+}
+
+
+
+
+
+/*
+  tdFirBank convolves each input vector with its filter in the bank: with a
+  folded kernel when the filter is real or symmetric, else with the
+  specialized kernel when there is one, else one filter tap at a time.
+*/
+void tdFirBank(struct tdFirVariables *tdFirVars)
+{
   int index;
   int filter;
+  int kind;
   float * inputPtr  = tdFirVars->input.data;
   float * filterPtr = tdFirVars->filter.data;
   float * resultPtr = tdFirVars->result.data;
@@ -171,14 +344,6 @@ void tdFir(struct tdFirVariables *tdFirVars)
   int  filterLength = tdFirVars->filterLength;
   int  inputLength  = tdFirVars->inputLength;  
   int  resultLength = filterLength + inputLength - 1;
-  pca_timer_t t;
-  t = startTimer();
-
-
-
-
-
-
 
   for(filter = 0; filter < tdFirVars->numFilters; filter++)
     {
@@ -187,6 +352,25 @@ void tdFir(struct tdFirVariables *tdFirVars)
       filterPtr = filterPtrSave + (filter * (2*filterLength)); 
       resultPtr = resultPtrSave + (filter * (2*resultLength)); 
 
+      kind = (tdFirVars->filterKinds != NULL) ?
+	tdFirVars->filterKinds[filter] : TDFIR_FILTER_COMPLEX;
+
+      if(kind != TDFIR_FILTER_COMPLEX)
+	{
+	  tdFirPadInput(inputPtr, tdFirVars->paddedInputPtr, inputLength, filterLength);
+	  tdFirFolded(inputPtr, tdFirVars->paddedInputPtr, filterPtr, resultPtr,
+		      inputLength, filterLength, kind);
+	  continue;
+	}
+
+      if(tdFirVars->kernel != NULL)
+	{
+	  tdFirPadInput(inputPtr, tdFirVars->paddedInputPtr, inputLength, filterLength);
+	  tdFirVars->kernel(tdFirVars->paddedInputPtr, filterPtr, resultPtr,
+			    resultLength);
+	  continue;
+	}
+
 
 
       /*
@@ -210,20 +394,6 @@ void tdFir(struct tdFirVariables *tdFirVars)
 
     }/* end for each filter */
 
-
-
-
-
-
-  /*
-    Stop the timer.  Print out the
-    total time in Seconds it took to do the TDFIR.
-  */
-
-  tdFirVars->time.data[0] = stopTimer(t);
-
-  printf("Done.  Latency: %f s.\n", tdFirVars->time.data[0]);
-
 }
 
 
@@ -271,6 +441,35 @@ void tdFirComplete(struct tdFirVariables *tdFirVars)
   clean_mem(float, tdFirVars->filter);
   clean_mem(float, tdFirVars->result);
   clean_mem(float, tdFirVars->time);
+
+  if(tdFirVars->mode == TDFIR_MODE_Q15)
+    {
+      tdFirQ15Complete(tdFirVars);
+    }
+  if(tdFirVars->mode == TDFIR_MODE_BATCH)
+    {
+      tdFirBatchComplete(tdFirVars);
+    }
+  if(tdFirVars->mode == TDFIR_MODE_HALF)
+    {
+      tdFirHalfComplete(tdFirVars);
+    }
+
+  free(tdFirVars->paddedInputPtr);
+  free(tdFirVars->filterKinds);
+
+  if(tdFirVars->streams != NULL)
+    {
+      int filter;
+
+      for(filter = 0; filter < tdFirVars->numFilters; filter++)
+	{
+	  tdFirStreamComplete(&tdFirVars->streams[filter]);
+	}
+      free(tdFirVars->streams);
+      free(tdFirVars->blockPtr);
+      free(tdFirVars->blockResultPtr);
+    }
 }
 
 
@@ -18,6 +18,88 @@
 
 #include "PcaCArray.h"
 
+/*
+  Kernel modes, selected by the optional second command line argument.
+    TDFIR_MODE_BANK    - the filter bank, each input convolved as a whole,
+                         with a folded kernel for real or symmetric
+                         filters (tdFirFolded.c), else a kernel
+                         specialized for filterLength when tdFirKernels.c
+                         has one.
+    TDFIR_MODE_GENERIC - the filter bank, always on the generic elCplxMul
+                         path.
+    TDFIR_MODE_STREAM - each input is fed through a tdFirStream in blocks
+                        of blockLength samples.
+    TDFIR_MODE_Q15    - the filter bank in Q15 fixed point (tdFirQ15.c).
+    TDFIR_MODE_BATCH  - filter 0 applied to every input, as channels of a
+                        channel interleaved matrix (tdFirBatch.c).
+    TDFIR_MODE_HALF   - the filter bank on inputs stored in fp16 or bf16,
+                        widened to float in registers (tdFirHalf.c).
+*/
+#define TDFIR_MODE_BANK   0
+#define TDFIR_MODE_STREAM 1
+#define TDFIR_MODE_Q15    2
+#define TDFIR_MODE_GENERIC 3
+#define TDFIR_MODE_BATCH  4
+#define TDFIR_MODE_HALF   5
+
+#define TDFIR_DEFAULT_BLOCK 256
+
+/*
+  Filter structures recognized by tdFirClassifyFilter (tdFirFolded.c).
+  In the bank modes, each filter with real or conjugate-symmetric taps is
+  run on a folded kernel instead of the complex one.
+*/
+#define TDFIR_FILTER_COMPLEX        0
+#define TDFIR_FILTER_REAL           1
+#define TDFIR_FILTER_CONJ_SYMMETRIC 2
+#define TDFIR_FILTER_REAL_SYMMETRIC 3
+
+/*
+  Minimum signal-to-quantization-noise ratio, in dB, that tdFirVerify
+  accepts for Q15 output (tdFirVerify <dataset> q15).  Block floating-point
+  scaling keeps 15 - (ceil(log2(filterLength))+2)/2 bits for each of the
+  input and the filter, so the quantization noise of a single product sits
+  near 62 dB (128 taps) to 68 dB (12 taps) below full scale; the 
+  pregenerated data sets measure about 80 dB at the output.  The bound
+  keeps 10 dB of margin below the per-product figure.
+*/
+#define TDFIR_Q15_MIN_SNR_DB 50.0
+
+/*
+  The same for the half precision modes (tdFirVerify <dataset> fp16 or
+  bf16).  Only the input is rounded, to 11 bits (fp16) or 8 bits (bf16)
+  of precision, which bounds its noise near 72 dB and 54 dB below the
+  signal; the pregenerated data sets measure 83 to 93 dB and 65 to 75 dB
+  at the output.  The bounds keep over 10 dB of margin below the first
+  figures.
+*/
+#define TDFIR_FP16_MIN_SNR_DB 60.0
+#define TDFIR_BF16_MIN_SNR_DB 40.0
+
+/*
+  A stateful FIR filter for continuous, block by block filtering.  The last
+  filterLength-1 input samples are carried between calls in a mirrored ring
+  of 2*capacity complex samples: every sample is written at its ring index
+  and again capacity samples later, so the newest 'capacity' samples are
+  always contiguous in memory and no history is ever shifted.
+*/
+struct tdFirStream{
+  float *filterPtr;     /* filterLength complex taps (not owned)        */
+  float *ringPtr;       /* 2*capacity complex samples                   */
+  int   filterLength;
+  int   blockLength;    /* samples consumed and produced per call       */
+  int   capacity;       /* filterLength - 1 + blockLength               */
+  int   writeIndex;     /* ring index of the oldest sample              */
+};
+
+/*
+  A FIR kernel specialized for one filter length (see tdFirKernels.c).  It
+  reads an input vector padded with filterLength-1 zeros on either side and
+  writes resultLength outputs.
+*/
+typedef void (*tdFirKernelFn)(float *paddedPtr, float *filterPtr,
+			      float *resultPtr, int resultLength);
+
 struct tdFirVariables{
   PcaCArrayFloat input;
   PcaCArrayFloat filter;
@@ -28,8 +110,33 @@ struct tdFirVariables{
   int   filterLength;
   int   resultLength;
   int   arguments;
+  int   mode;
+  int   blockLength;
+  tdFirKernelFn kernel;
+  int   *filterKinds;
+  float *paddedInputPtr;
+  struct tdFirStream *streams;
+  float *blockPtr;
+  float *blockResultPtr;
+  short *q15InputPtr;
+  short *q15FilterPtr;
+  float *q15ScalePtr;
+  int   q15Taps;
+  int   q15InputStride;
+  float *batchInputPtr;
+  float *batchResultPtr;
+  int   batchChannels;
+  unsigned short *halfInputPtr;  /* PcaCHalf.h halves */
+  float *halfTapsPtr;
+  int   halfInputStride;
+  int   halfFormat;              /* PCA_FP16 or PCA_BF16 */
   char  *dataSet;
-}tdFirVars; 
+  char  *modeName;
+  char  *modeArg;
+};
+
+/* Defined in the file with main. */
+extern struct tdFirVariables tdFirVars;
 
 void tdFirSetup(struct tdFirVariables *tdFirVars);
 void tdFir(struct tdFirVariables *tdFirVars);
@@ -38,6 +145,35 @@ void elCplxMul(float *dataPtr, float *filterPtr,
 	       float *resultPtr, int inputLength);
 void printVector(float * dataPtr, int inputLength);
 void zeroData(float *dataPtr, int length, int filters);
+void tdFirBank(struct tdFirVariables *tdFirVars);
+void tdFirStreamRun(struct tdFirVariables *tdFirVars);
+
+tdFirKernelFn tdFirFindKernel(int filterLength);
+void tdFirPadInput(float *inputPtr, float *paddedPtr,
+		   int inputLength, int filterLength);
+
+int  tdFirClassifyFilter(float *filterPtr, int filterLength);
+void tdFirFolded(float *inputPtr, float *paddedPtr, float *filterPtr,
+		 float *resultPtr, int inputLength, int filterLength, int kind);
+
+void tdFirQ15Setup(struct tdFirVariables *tdFirVars);
+void tdFirQ15(struct tdFirVariables *tdFirVars);
+void tdFirQ15Complete(struct tdFirVariables *tdFirVars);
+
+void tdFirBatchSetup(struct tdFirVariables *tdFirVars);
+void tdFirBatch(struct tdFirVariables *tdFirVars);
+void tdFirBatchComplete(struct tdFirVariables *tdFirVars);
+
+void tdFirHalfSetup(struct tdFirVariables *tdFirVars);
+void tdFirHalf(struct tdFirVariables *tdFirVars);
+void tdFirHalfComplete(struct tdFirVariables *tdFirVars);
+
+void tdFirStreamSetup(struct tdFirStream *stream, float *filterPtr,
+		      int filterLength, int blockLength);
+void tdFirStreamReset(struct tdFirStream *stream);
+void tdFirStreamProcess(struct tdFirStream *stream, float *blockPtr,
+			float *resultPtr);
+void tdFirStreamComplete(struct tdFirStream *stream);
 
 
 
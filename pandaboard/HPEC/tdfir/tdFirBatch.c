@@ -0,0 +1,197 @@
+/******************************************************************************
+** File: tdFirBatch.c
+**
+** HPEC Challenge Benchmark Suite
+** TDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides a batched TDFIR mode, in which one filter
+**           is applied to every channel of the input matrix (as in a
+**           beamformer), rather than filter i to input i.  The input is
+**           held channel interleaved: for each sample time, the real parts
+**           of all channels, then their imaginary parts.  A tap is then
+**           broadcast once and multiplied into a whole vector of channels.
+**
+**           Two inner loops are provided:
+**             ARM NEON / x86 SSE - four channels per vector
+**             generic            - plain C over the same four lanes
+**
+******************************************************************************/
+
+#include "./tdFir.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TDFIR_BATCH_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define TDFIR_BATCH_SSE
+#endif
+
+/* Channels per vector; the channel count is padded to a multiple. */
+#define TDFIR_BATCH_LANES 4
+
+
+/*
+  tdFirBatchSetup builds the channel interleaved copy of the input; the
+  other filters of the bank are not used.  Sample n of channel c is
+  stored at (n + filterLength-1) * 2*batchChannels + c (real part) and
+  batchChannels floats later (imaginary part); the filterLength-1 leading
+  and trailing samples are zeros, so every output reads a contiguous
+  window.  The interleaving is done here, outside the timed region, as
+  the samples would arrive interleaved from the receiver.
+*/
+void tdFirBatchSetup(struct tdFirVariables *tdFirVars)
+{
+  int channel, index;
+  int numChannels  = tdFirVars->numFilters;
+  int inputLength  = tdFirVars->inputLength;
+  int filterLength = tdFirVars->filterLength;
+  int resultLength = tdFirVars->resultLength;
+  int width;
+  float *inputPtr;
+  float *samplePtr;
+
+  width = (numChannels + TDFIR_BATCH_LANES - 1) & ~(TDFIR_BATCH_LANES - 1);
+  tdFirVars->batchChannels  = width;
+  tdFirVars->batchInputPtr  =
+    calloc(2 * width * (inputLength + 2 * (filterLength - 1)), sizeof(float));
+  tdFirVars->batchResultPtr = malloc(2 * width * resultLength * sizeof(float));
+  if(tdFirVars->batchInputPtr == NULL || tdFirVars->batchResultPtr == NULL)
+    {
+      printf("tdFirBatchSetup: out of memory\n");
+      exit(-1);
+    }
+
+  for(channel = 0; channel < numChannels; channel++)
+    {
+      inputPtr = tdFirVars->input.data + (channel * (2*inputLength));
+      for(index = 0; index < inputLength; index++)
+	{
+	  samplePtr = tdFirVars->batchInputPtr +
+	    (index + filterLength - 1) * 2 * width;
+	  samplePtr[channel]         = inputPtr[2 * index];
+	  samplePtr[width + channel] = inputPtr[2 * index + 1];
+	}
+    }
+}
+
+
+
+/*
+  tdFirBatch filters every channel with filter 0 and de-interleaves the
+  outputs into the result bank.  Output n is sum_k h[k] * x[n-k], where
+  x[n-k] is the interleaved sample at index n+filterLength-1-k.
+*/
+void tdFirBatch(struct tdFirVariables *tdFirVars)
+{
+  int index, group, tap, channel;
+  int numChannels  = tdFirVars->numFilters;
+  int filterLength = tdFirVars->filterLength;
+  int resultLength = tdFirVars->resultLength;
+  int width        = tdFirVars->batchChannels;
+  float *filterPtr = tdFirVars->filter.data;
+  float *windowPtr;
+  float *samplePtr;
+  float *outPtr;
+  float *resultPtr;
+#if defined(TDFIR_BATCH_NEON)
+  float32x4_t xr, xi, hr, hi, accR, accI;
+#elif defined(TDFIR_BATCH_SSE)
+  __m128 xr, xi, hr, hi, accR, accI;
+#else
+  int lane;
+  float accR[TDFIR_BATCH_LANES], accI[TDFIR_BATCH_LANES];
+  float hr, hi, xr, xi;
+#endif
+
+  for(index = 0; index < resultLength; index++)
+    {
+      outPtr    = tdFirVars->batchResultPtr + index * 2 * width;
+      windowPtr = tdFirVars->batchInputPtr + (index + filterLength - 1) * 2 * width;
+
+      for(group = 0; group < width; group += TDFIR_BATCH_LANES)
+	{
+#if defined(TDFIR_BATCH_NEON)
+	  accR = vdupq_n_f32(0);
+	  accI = vdupq_n_f32(0);
+	  samplePtr = windowPtr + group;
+	  for(tap = 0; tap < filterLength; tap++, samplePtr -= 2 * width)
+	    {
+	      hr = vdupq_n_f32(filterPtr[2 * tap]);
+	      hi = vdupq_n_f32(filterPtr[2 * tap + 1]);
+	      xr = vld1q_f32(samplePtr);
+	      xi = vld1q_f32(samplePtr + width);
+	      accR = vmlsq_f32(vmlaq_f32(accR, xr, hr), xi, hi);
+	      accI = vmlaq_f32(vmlaq_f32(accI, xr, hi), xi, hr);
+	    }
+	  vst1q_f32(outPtr + group, accR);
+	  vst1q_f32(outPtr + width + group, accI);
+#elif defined(TDFIR_BATCH_SSE)
+	  accR = _mm_setzero_ps();
+	  accI = _mm_setzero_ps();
+	  samplePtr = windowPtr + group;
+	  for(tap = 0; tap < filterLength; tap++, samplePtr -= 2 * width)
+	    {
+	      hr = _mm_set1_ps(filterPtr[2 * tap]);
+	      hi = _mm_set1_ps(filterPtr[2 * tap + 1]);
+	      xr = _mm_loadu_ps(samplePtr);
+	      xi = _mm_loadu_ps(samplePtr + width);
+	      accR = _mm_sub_ps(_mm_add_ps(accR, _mm_mul_ps(xr, hr)),
+				_mm_mul_ps(xi, hi));
+	      accI = _mm_add_ps(_mm_add_ps(accI, _mm_mul_ps(xr, hi)),
+				_mm_mul_ps(xi, hr));
+	    }
+	  _mm_storeu_ps(outPtr + group, accR);
+	  _mm_storeu_ps(outPtr + width + group, accI);
+#else
+	  for(lane = 0; lane < TDFIR_BATCH_LANES; lane++)
+	    {
+	      accR[lane] = 0;
+	      accI[lane] = 0;
+	    }
+	  samplePtr = windowPtr + group;
+	  for(tap = 0; tap < filterLength; tap++, samplePtr -= 2 * width)
+	    {
+	      hr = filterPtr[2 * tap];
+	      hi = filterPtr[2 * tap + 1];
+	      for(lane = 0; lane < TDFIR_BATCH_LANES; lane++)
+		{
+		  xr = samplePtr[lane];
+		  xi = samplePtr[width + lane];
+		  accR[lane] += xr * hr - xi * hi;
+		  accI[lane] += xr * hi + xi * hr;
+		}
+	    }
+	  for(lane = 0; lane < TDFIR_BATCH_LANES; lane++)
+	    {
+	      outPtr[group + lane]         = accR[lane];
+	      outPtr[width + group + lane] = accI[lane];
+	    }
+#endif
+	}
+    }
+
+  /* De-interleave into the result bank, one output row per channel. */
+  for(channel = 0; channel < numChannels; channel++)
+    {
+      resultPtr = tdFirVars->result.data + (channel * (2*resultLength));
+      outPtr    = tdFirVars->batchResultPtr + channel;
+      for(index = 0; index < resultLength; index++)
+	{
+	  resultPtr[2 * index]     = outPtr[0];
+	  resultPtr[2 * index + 1] = outPtr[width];
+	  outPtr += 2 * width;
+	}
+    }
+}
+
+
+
+void tdFirBatchComplete(struct tdFirVariables *tdFirVars)
+{
+  free(tdFirVars->batchInputPtr);
+  free(tdFirVars->batchResultPtr);
+}
@@ -0,0 +1,225 @@
+/******************************************************************************
+** File: tdFirFolded.c
+**
+** HPEC Challenge Benchmark Suite
+** TDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides FIR kernels for filters with structured taps:
+**           real-valued taps, and conjugate-symmetric (linear-phase) taps.
+**           Real taps need two real multiplies per tap instead of the four
+**           of a complex multiply.  Symmetric filters are folded: the two
+**           input samples that meet equal (or conjugate) taps are combined
+**           first, so each pair of taps costs the multiplies of one.
+**
+**           Multiplies per tap, against four for the generic path:
+**             TDFIR_FILTER_REAL           - 2
+**             TDFIR_FILTER_CONJ_SYMMETRIC - 2
+**             TDFIR_FILTER_REAL_SYMMETRIC - 1
+**
+**           Like elCplxMul, each kernel applies one tap pair to the entire
+**           input vector before moving to the next; a pair of real taps
+**           that are not symmetric is applied in one pass as well, so the
+**           result is read and written once per pair.
+**
+******************************************************************************/
+
+#include "./tdFir.h"
+#include <stdlib.h>
+
+
+/*
+  tdFirClassifyFilter returns the TDFIR_FILTER_* structure of one filter.
+  The taps are compared exactly, so only filters that really have the
+  structure are folded.  Folding multiplies h*(a+b) where the generic
+  path adds h*a + h*b, so the results match it within rounding, which is
+  what tdFirVerify checks.
+*/
+int tdFirClassifyFilter(float *filterPtr, int filterLength)
+{
+  int index, mirror;
+  int real = 1, symmetric = 1;
+
+  for(index = 0; index < filterLength; index++)
+    {
+      mirror = filterLength - 1 - index;
+      if(filterPtr[2 * index + 1] != 0)
+	{
+	  real = 0;
+	}
+      if(filterPtr[2 * index]     !=  filterPtr[2 * mirror] ||
+	 filterPtr[2 * index + 1] != -filterPtr[2 * mirror + 1])
+	{
+	  symmetric = 0;
+	}
+    }
+
+  if(real && symmetric)
+    {
+      return TDFIR_FILTER_REAL_SYMMETRIC;
+    }
+  if(symmetric)
+    {
+      return TDFIR_FILTER_CONJ_SYMMETRIC;
+    }
+  if(real)
+    {
+      return TDFIR_FILTER_REAL;
+    }
+  return TDFIR_FILTER_COMPLEX;
+}
+
+
+
+/*
+  One real tap applied to the entire input vector.
+*/
+static void elRealMul(float *dataPtr, float tap, float *resultPtr, int length)
+{
+  int index;
+
+  for(index = 0; index < 2 * length; index++)
+    {
+      *resultPtr += (*dataPtr) * tap;
+      resultPtr++;
+      dataPtr++;
+    }
+}
+
+
+
+/*
+  Two consecutive real taps applied to the two windows of the input they
+  meet, so the result is read and written once per pair of taps:
+  result += tap0 * a + tap1 * b.
+*/
+static void elRealMul2(float *aPtr, float *bPtr, float tap0, float tap1,
+		       float *resultPtr, int length)
+{
+  int index;
+
+  for(index = 0; index < 2 * length; index++)
+    {
+      *resultPtr += (*aPtr) * tap0 + (*bPtr) * tap1;
+      resultPtr++;
+      aPtr++;
+      bPtr++;
+    }
+}
+
+
+
+/*
+  One pair of equal real taps applied to two windows of the input:
+  result += tap * (a + b).
+*/
+static void elRealSymMul(float *aPtr, float *bPtr, float tap,
+			 float *resultPtr, int length)
+{
+  int index;
+
+  for(index = 0; index < 2 * length; index++)
+    {
+      *resultPtr += (*aPtr + *bPtr) * tap;
+      resultPtr++;
+      aPtr++;
+      bPtr++;
+    }
+}
+
+
+
+/*
+  One pair of conjugate taps h and conj(h) applied to two windows of the
+  input: h*a + conj(h)*b = hr*(a+b) + i*hi*(a-b).
+*/
+static void elCplxSymMul(float *aPtr, float *bPtr, float *filterPtr,
+			 float *resultPtr, int length)
+{
+  int index;
+  float filterReal = *filterPtr;
+  float filterImag = *(filterPtr+1);
+  float sumReal, sumImag, diffReal, diffImag;
+
+  for(index = 0; index < length; index++)
+    {
+      sumReal  = *aPtr     + *bPtr;
+      sumImag  = *(aPtr+1) + *(bPtr+1);
+      diffReal = *aPtr     - *bPtr;
+      diffImag = *(aPtr+1) - *(bPtr+1);
+      /* real  */
+      *resultPtr += filterReal * sumReal - filterImag * diffImag;
+      resultPtr++;
+      /* imag  */
+      *resultPtr += filterReal * sumImag + filterImag * diffReal;
+      resultPtr++;
+      aPtr+=2;
+      bPtr+=2;
+    }
+}
+
+
+
+/*
+  tdFirFolded convolves one input vector with one structured filter,
+  accumulating into resultPtr (which must start out zeroed).
+  Input Parameters:
+  inputPtr   - inputLength complex samples
+  paddedPtr  - the input padded with filterLength-1 zeros on either side
+               (tdFirPadInput)
+  filterPtr  - filterLength complex taps
+  resultPtr  - inputLength+filterLength-1 complex outputs
+  kind       - the TDFIR_FILTER_* structure of the filter
+*/
+void tdFirFolded(float *inputPtr, float *paddedPtr, float *filterPtr,
+		 float *resultPtr, int inputLength, int filterLength, int kind)
+{
+  int index, mirror;
+  int resultLength = inputLength + filterLength - 1;
+
+  /*
+    Output n is sum_k h[k] * padded[n+filterLength-1-k]: tap k meets the
+    window starting at padded[filterLength-1-k].
+  */
+  if(kind == TDFIR_FILTER_REAL)
+    {
+      for(index = 0; index + 1 < filterLength; index += 2)
+	{
+	  elRealMul2(paddedPtr + 2 * (filterLength - 1 - index),
+		     paddedPtr + 2 * (filterLength - 2 - index),
+		     filterPtr[2 * index], filterPtr[2 * index + 2],
+		     resultPtr, resultLength);
+	}
+      if(filterLength % 2 == 1)
+	{
+	  index = filterLength - 1;
+	  elRealMul(inputPtr, filterPtr[2 * index], resultPtr + 2 * index,
+		    inputLength);
+	}
+      return;
+    }
+
+  /* Taps k and filterLength-1-k are a symmetric pair. */
+  for(index = 0; index < filterLength / 2; index++)
+    {
+      mirror = filterLength - 1 - index;
+      if(kind == TDFIR_FILTER_REAL_SYMMETRIC)
+	{
+	  elRealSymMul(paddedPtr + 2 * mirror, paddedPtr + 2 * index,
+		       filterPtr[2 * index], resultPtr, resultLength);
+	}
+      else
+	{
+	  elCplxSymMul(paddedPtr + 2 * mirror, paddedPtr + 2 * index,
+		       filterPtr + 2 * index, resultPtr, resultLength);
+	}
+    }
+
+  /* The middle tap of an odd length filter is its own mirror, so real. */
+  if(filterLength % 2 == 1)
+    {
+      index = filterLength / 2;
+      elRealMul(inputPtr, filterPtr[2 * index], resultPtr + 2 * index,
+		inputLength);
+    }
+}
@@ -0,0 +1,220 @@
+/******************************************************************************
+** File: tdFirHalf.c
+**
+** HPEC Challenge Benchmark Suite
+** TDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides the TDFIR filter bank on inputs stored in
+**           half precision, fp16 or bf16 (PcaCHalf.h).  The inputs are
+**           converted to halves outside the timed region, as they would
+**           arrive from a receiver storing them so; the filters stay in
+**           float.  The kernel widens the samples to float in registers
+**           as it loads them and accumulates in float, so it reads half
+**           the input bytes of the float bank.
+**
+**           Each vector holds two complex samples.  Per tap, with the
+**           filter time reversed, an accumulator of two outputs gains
+**             x * (hr, hr, hr, hr) + swap(x) * (-hi, hi, -hi, hi)
+**           where swap exchanges the real and imaginary part of each
+**           sample: (xr*hr - xi*hi, xi*hr + xr*hi) per output.
+**
+**           Three inner loops are provided:
+**             x86 SSE2 - F16C _mm_cvtph_ps (fp16) or a 16 bit unpack
+**                        (bf16) to widen, _mm_shuffle_ps to swap.
+**             ARM NEON - vcvt_f32_f16 (fp16, with -mfpu=neon-fp16) or
+**                        vshll_n_u16 (bf16) to widen, vrev64q_f32 to
+**                        swap.
+**             generic  - plain C with pca_half_to_float, also used for
+**                        fp16 without F16C or the NEON half extension.
+**
+******************************************************************************/
+
+#include "./tdFir.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include "PcaCHalf.h"
+
+#if defined(__SSE2__)
+#define TDFIR_HALF_VECTOR __m128
+#define TDFIR_HALF_LOAD(p)      _mm_loadu_ps(p)
+#define TDFIR_HALF_STORE(p, v)  _mm_storeu_ps(p, v)
+#define TDFIR_HALF_ZERO()       _mm_setzero_ps()
+#define TDFIR_HALF_MAC(acc, x, a, b)					\
+  acc = _mm_add_ps(acc, _mm_add_ps(_mm_mul_ps(x, a),			\
+				   _mm_mul_ps(_mm_shuffle_ps(x, x, _MM_SHUFFLE(2,3,0,1)), b)))
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define TDFIR_HALF_VECTOR float32x4_t
+#define TDFIR_HALF_LOAD(p)      vld1q_f32(p)
+#define TDFIR_HALF_STORE(p, v)  vst1q_f32(p, v)
+#define TDFIR_HALF_ZERO()       vdupq_n_f32(0)
+#define TDFIR_HALF_MAC(acc, x, a, b)					\
+  acc = vmlaq_f32(vmlaq_f32(acc, x, a), vrev64q_f32(x), b)
+#endif
+
+
+
+/*
+  tdFirHalfSetup stores the bank's inputs in halves and lays out the
+  filters for tdFirHalf.  This happens outside the timed region.
+
+  Each input row is stored padded with filterLength-1 leading and
+  trailing zeros, so every output is a dot product over a contiguous
+  window.  Each filter is stored time reversed as 8 floats a tap:
+  (hr,hr,hr,hr) and (-hi,hi,-hi,hi).
+*/
+void tdFirHalfSetup(struct tdFirVariables *tdFirVars)
+{
+  int filter, index, tap;
+  int inputLength  = tdFirVars->inputLength;
+  int filterLength = tdFirVars->filterLength;
+  int stride;
+  float *filterPtr, *tapsPtr;
+
+  tdFirVars->halfFormat = pca_half_format(tdFirVars->modeName);
+  stride = inputLength + 2 * (filterLength - 1);
+  tdFirVars->halfInputStride = stride;
+  tdFirVars->halfInputPtr    = calloc(2 * stride * tdFirVars->numFilters, sizeof(pca_half));
+  tdFirVars->halfTapsPtr     = malloc(8 * filterLength * tdFirVars->numFilters * sizeof(float));
+  if(tdFirVars->halfInputPtr == NULL || tdFirVars->halfTapsPtr == NULL)
+    {
+      printf("tdFirHalfSetup: out of memory\n");
+      exit(-1);
+    }
+
+  for(filter = 0; filter < tdFirVars->numFilters; filter++)
+    {
+      pca_floats_to_halves(tdFirVars->halfFormat,
+			   tdFirVars->input.data + (filter * (2*inputLength)),
+			   tdFirVars->halfInputPtr + (filter * (2*stride)) + 2 * (filterLength - 1),
+			   2 * inputLength);
+
+      filterPtr = tdFirVars->filter.data + (filter * (2*filterLength));
+      tapsPtr   = tdFirVars->halfTapsPtr + (filter * (8*filterLength));
+      for(index = 0; index < filterLength; index++)
+	{
+	  tap = filterLength - 1 - index;
+	  tapsPtr[8 * index]     = filterPtr[2 * tap];
+	  tapsPtr[8 * index + 1] = filterPtr[2 * tap];
+	  tapsPtr[8 * index + 2] = filterPtr[2 * tap];
+	  tapsPtr[8 * index + 3] = filterPtr[2 * tap];
+	  tapsPtr[8 * index + 4] = -filterPtr[2 * tap + 1];
+	  tapsPtr[8 * index + 5] = filterPtr[2 * tap + 1];
+	  tapsPtr[8 * index + 6] = -filterPtr[2 * tap + 1];
+	  tapsPtr[8 * index + 7] = filterPtr[2 * tap + 1];
+	}
+    }
+}
+
+
+
+/*
+  halfScalar computes outputs first to last-1 of one filter: the dot
+  product of filterLength samples from xPtr + 2*index with the taps.
+*/
+static void halfScalar(int format, pca_half *xPtr, float *tapsPtr, float *resultPtr,
+		       int first, int last, int filterLength)
+{
+  int index, tap;
+  float xr, xi, accR, accI;
+
+  for(index = first; index < last; index++)
+    {
+      accR = 0;
+      accI = 0;
+      for(tap = 0; tap < filterLength; tap++)
+	{
+	  xr = pca_half_to_float(format, xPtr[2 * (index + tap)]);
+	  xi = pca_half_to_float(format, xPtr[2 * (index + tap) + 1]);
+	  accR += xr * tapsPtr[8 * tap] + xi * tapsPtr[8 * tap + 4];
+	  accI += xi * tapsPtr[8 * tap] + xr * tapsPtr[8 * tap + 5];
+	}
+      resultPtr[2 * index]     = accR;
+      resultPtr[2 * index + 1] = accI;
+    }
+}
+
+
+
+/*
+  TDFIR_DEFINE_HALF_KERNEL defines a vector kernel that widens samples
+  with WIDEN, 4 halves to a vector of 4 floats.  It computes 4 outputs at
+  a time, in two accumulators, and returns how many it computed.
+*/
+#define TDFIR_DEFINE_HALF_KERNEL(name, WIDEN)				\
+static int name(pca_half *xPtr, float *tapsPtr, float *resultPtr,	\
+		int resultLength, int filterLength)			\
+{									\
+  int index, tap;							\
+  pca_half *windowPtr;							\
+  TDFIR_HALF_VECTOR acc0, acc1, x0, x1, a, b;				\
+									\
+  for(index = 0; index + 4 <= resultLength; index += 4)			\
+    {									\
+      acc0 = TDFIR_HALF_ZERO();						\
+      acc1 = TDFIR_HALF_ZERO();						\
+      windowPtr = xPtr + 2 * index;					\
+      for(tap = 0; tap < filterLength; tap++)				\
+	{								\
+	  a  = TDFIR_HALF_LOAD(tapsPtr + 8 * tap);			\
+	  b  = TDFIR_HALF_LOAD(tapsPtr + 8 * tap + 4);			\
+	  x0 = WIDEN(windowPtr + 2 * tap);				\
+	  x1 = WIDEN(windowPtr + 2 * tap + 4);				\
+	  TDFIR_HALF_MAC(acc0, x0, a, b);				\
+	  TDFIR_HALF_MAC(acc1, x1, a, b);				\
+	}								\
+      TDFIR_HALF_STORE(resultPtr + 2 * index, acc0);			\
+      TDFIR_HALF_STORE(resultPtr + 2 * index + 4, acc1);		\
+    }									\
+  return index;								\
+}
+
+#if defined(TDFIR_HALF_VECTOR) && defined(PCA_FP16_WIDEN4)
+TDFIR_DEFINE_HALF_KERNEL(halfFp16, PCA_FP16_WIDEN4)
+#endif
+#if defined(TDFIR_HALF_VECTOR) && defined(PCA_BF16_WIDEN4)
+TDFIR_DEFINE_HALF_KERNEL(halfBf16, PCA_BF16_WIDEN4)
+#endif
+
+
+
+void tdFirHalf(struct tdFirVariables *tdFirVars)
+{
+  int filter, done;
+  int format       = tdFirVars->halfFormat;
+  int stride       = tdFirVars->halfInputStride;
+  int filterLength = tdFirVars->filterLength;
+  int resultLength = tdFirVars->resultLength;
+  pca_half *xPtr;
+  float *tapsPtr, *resultPtr;
+
+  for(filter = 0; filter < tdFirVars->numFilters; filter++)
+    {
+      xPtr      = tdFirVars->halfInputPtr + (filter * (2*stride));
+      tapsPtr   = tdFirVars->halfTapsPtr  + (filter * (8*filterLength));
+      resultPtr = tdFirVars->result.data  + (filter * (2*resultLength));
+
+      done = 0;
+#if defined(TDFIR_HALF_VECTOR) && defined(PCA_FP16_WIDEN4)
+      if(format == PCA_FP16)
+	{
+	  done = halfFp16(xPtr, tapsPtr, resultPtr, resultLength, filterLength);
+	}
+#endif
+#if defined(TDFIR_HALF_VECTOR) && defined(PCA_BF16_WIDEN4)
+      if(format == PCA_BF16)
+	{
+	  done = halfBf16(xPtr, tapsPtr, resultPtr, resultLength, filterLength);
+	}
+#endif
+      halfScalar(format, xPtr, tapsPtr, resultPtr, done, resultLength, filterLength);
+    }
+}
+
+
+
+void tdFirHalfComplete(struct tdFirVariables *tdFirVars)
+{
+  free(tdFirVars->halfInputPtr);
+  free(tdFirVars->halfTapsPtr);
+}
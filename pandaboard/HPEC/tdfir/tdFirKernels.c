@@ -0,0 +1,180 @@
+/******************************************************************************
+** File: tdFirKernels.c
+**
+** HPEC Challenge Benchmark Suite
+** TDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides FIR kernels specialized at compile time for
+**           fixed filter lengths, and the registry tdFir uses to find them.
+**           Each kernel is generated by TDFIR_DEFINE_KERNEL with its taps
+**           fully unrolled: there is no tap loop, and the coefficients
+**           are loaded once per filter into arrays indexed only by
+**           constants, which the compiler keeps in registers when they fit.
+**           Outputs are accumulated in registers, four at a time, and
+**           stored once.
+**
+**           To add a filter length n, define TDFIR_TAPS_n below and add
+**           X(n) to TDFIR_KERNEL_LIST.
+**
+******************************************************************************/
+
+#include "./tdFir.h"
+#include <stdlib.h>
+
+
+/*
+  Repetition macros: TDFIR_REPn(M, k) expands to M(k) M(k+1) ... M(k+n-1).
+*/
+#define TDFIR_REP1(M, k)   M(k)
+#define TDFIR_REP2(M, k)   TDFIR_REP1(M, k)  TDFIR_REP1(M, (k)+1)
+#define TDFIR_REP4(M, k)   TDFIR_REP2(M, k)  TDFIR_REP2(M, (k)+2)
+#define TDFIR_REP8(M, k)   TDFIR_REP4(M, k)  TDFIR_REP4(M, (k)+4)
+#define TDFIR_REP16(M, k)  TDFIR_REP8(M, k)  TDFIR_REP8(M, (k)+8)
+#define TDFIR_REP32(M, k)  TDFIR_REP16(M, k) TDFIR_REP16(M, (k)+16)
+
+/*
+  TDFIR_TAPS_n(M) expands M once for each tap of an n tap filter.
+*/
+#define TDFIR_TAPS_4(M)   TDFIR_REP4(M, 0)
+#define TDFIR_TAPS_8(M)   TDFIR_REP8(M, 0)
+#define TDFIR_TAPS_12(M)  TDFIR_REP8(M, 0) TDFIR_REP4(M, 8)
+#define TDFIR_TAPS_16(M)  TDFIR_REP16(M, 0)
+#define TDFIR_TAPS_24(M)  TDFIR_REP16(M, 0) TDFIR_REP8(M, 16)
+#define TDFIR_TAPS_32(M)  TDFIR_REP32(M, 0)
+
+/*
+  The filter lengths for which kernels are generated.  Beyond 32 taps the
+  coefficients no longer fit in registers and the per-tap loop overhead of
+  the generic path is already amortized over the whole input vector; at
+  64 and 128 taps the unrolled kernels measured no faster than elCplxMul,
+  so those lengths use the generic path.
+*/
+#define TDFIR_KERNEL_LIST(X) X(4) X(8) X(12) X(16) X(24) X(32)
+
+
+#define TDFIR_LOAD_TAP(k)				\
+  hr[k] = filterPtr[2*(k)];				\
+  hi[k] = filterPtr[2*(k)+1];
+
+/*
+  One tap applied to four consecutive outputs.  Output j of the group
+  reads sample window[j-k], so consecutive taps reuse three of the four
+  samples and the compiler may pack the four outputs into vector lanes.
+*/
+#define TDFIR_MAC_TAP(k)				\
+  x0r = windowPtr[-2*(k)];				\
+  x0i = windowPtr[-2*(k)+1];				\
+  x1r = windowPtr[-2*(k)+2];				\
+  x1i = windowPtr[-2*(k)+3];				\
+  x2r = windowPtr[-2*(k)+4];				\
+  x2i = windowPtr[-2*(k)+5];				\
+  x3r = windowPtr[-2*(k)+6];				\
+  x3i = windowPtr[-2*(k)+7];				\
+  acc0r += x0r * hr[k] - x0i * hi[k];			\
+  acc0i += x0r * hi[k] + x0i * hr[k];			\
+  acc1r += x1r * hr[k] - x1i * hi[k];			\
+  acc1i += x1r * hi[k] + x1i * hr[k];			\
+  acc2r += x2r * hr[k] - x2i * hi[k];			\
+  acc2i += x2r * hi[k] + x2i * hr[k];			\
+  acc3r += x3r * hr[k] - x3i * hi[k];			\
+  acc3i += x3r * hi[k] + x3i * hr[k];
+
+/*
+  TDFIR_DEFINE_KERNEL(TAPS) defines tdFirKernelTAPS().  The input is read
+  from paddedPtr, a copy of the input vector with TAPS-1 zeros on either
+  side, so output n is sum_k h[k] * padded[n+TAPS-1-k] with no bounds
+  checks.  Outputs are produced four at a time; the last group may compute
+  up to three outputs past resultLength, which read further into the
+  padding and are not stored.
+*/
+#define TDFIR_DEFINE_KERNEL(TAPS)					\
+static void tdFirKernel##TAPS(float *paddedPtr, float *filterPtr,	\
+			      float *resultPtr, int resultLength)	\
+{									\
+  int index;								\
+  float hr[TAPS], hi[TAPS];						\
+  float x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;			\
+  float acc0r, acc0i, acc1r, acc1i, acc2r, acc2i, acc3r, acc3i;	\
+  float *windowPtr;							\
+									\
+  TDFIR_TAPS_##TAPS(TDFIR_LOAD_TAP)					\
+									\
+  for(index = 0; index < resultLength; index += 4)			\
+    {									\
+      windowPtr = paddedPtr + 2 * (index + TAPS - 1);			\
+      acc0r = acc0i = acc1r = acc1i = 0;				\
+      acc2r = acc2i = acc3r = acc3i = 0;				\
+      TDFIR_TAPS_##TAPS(TDFIR_MAC_TAP)					\
+      resultPtr[2 * index]     = acc0r;					\
+      resultPtr[2 * index + 1] = acc0i;					\
+      if(index + 1 < resultLength)					\
+	{								\
+	  resultPtr[2 * index + 2] = acc1r;				\
+	  resultPtr[2 * index + 3] = acc1i;				\
+	}								\
+      if(index + 2 < resultLength)					\
+	{								\
+	  resultPtr[2 * index + 4] = acc2r;				\
+	  resultPtr[2 * index + 5] = acc2i;				\
+	}								\
+      if(index + 3 < resultLength)					\
+	{								\
+	  resultPtr[2 * index + 6] = acc3r;				\
+	  resultPtr[2 * index + 7] = acc3i;				\
+	}								\
+    }									\
+}
+
+TDFIR_KERNEL_LIST(TDFIR_DEFINE_KERNEL)
+
+
+struct tdFirKernelEntry{
+  int           filterLength;
+  tdFirKernelFn kernel;
+};
+
+#define TDFIR_REGISTER_KERNEL(TAPS) { TAPS, tdFirKernel##TAPS },
+
+static const struct tdFirKernelEntry tdFirKernelRegistry[] = {
+  TDFIR_KERNEL_LIST(TDFIR_REGISTER_KERNEL)
+  { 0, NULL }
+};
+
+
+
+/*
+  tdFirFindKernel returns the kernel specialized for filterLength, or NULL
+  when there is none and the generic path must be used.
+*/
+tdFirKernelFn tdFirFindKernel(int filterLength)
+{
+  int index;
+
+  for(index = 0; tdFirKernelRegistry[index].kernel != NULL; index++)
+    {
+      if(tdFirKernelRegistry[index].filterLength == filterLength)
+	{
+	  return tdFirKernelRegistry[index].kernel;
+	}
+    }
+  return NULL;
+}
+
+
+
+/*
+  tdFirPadInput copies one input vector between the filterLength-1 zeros
+  on either side of paddedPtr.  The zeros are written once, in tdFirSetup.
+*/
+void tdFirPadInput(float *inputPtr, float *paddedPtr,
+		   int inputLength, int filterLength)
+{
+  int index;
+
+  paddedPtr += 2 * (filterLength - 1);
+  for(index = 0; index < 2 * inputLength; index++)
+    {
+      paddedPtr[index] = inputPtr[index];
+    }
+}
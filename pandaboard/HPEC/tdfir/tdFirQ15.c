@@ -0,0 +1,295 @@
+/******************************************************************************
+** File: tdFirQ15.c
+**
+** HPEC Challenge Benchmark Suite
+** TDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides a fixed-point (Q15) complex implementation
+**           of the TDFIR filter bank.  Inputs and filters are quantized to
+**           16-bit integers with block floating-point scaling (one power
+**           of two per input vector and per filter), multiplied with
+**           widening multiply-accumulates into 32-bit accumulators, and
+**           scaled back to float.
+**
+**           Three inner loops are provided:
+**             ARM NEON - vqdmlal_s16, a saturating doubling widening
+**                        multiply-accumulate; accumulators are Q31.
+**             x86 SSE2 - _mm_madd_epi16, a widening multiply with pairwise
+**                        add; accumulators are Q30.
+**             generic  - plain C with a saturating 32-bit add; Q30.
+**           The block floating-point scaling leaves enough guard bits that
+**           the 32-bit accumulators cannot overflow, so saturation only
+**           ever guards against a broken invariant.
+**
+******************************************************************************/
+
+#include "./tdFir.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <limits.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TDFIR_Q15_NEON
+#define TDFIR_Q15_ACC_BITS 31
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define TDFIR_Q15_SSE2
+#define TDFIR_Q15_ACC_BITS 30
+#else
+#define TDFIR_Q15_ACC_BITS 30
+#endif
+
+
+static int q15Log2Ceil(int value)
+{
+  int bits = 0;
+
+  while((1 << bits) < value)
+    {
+      bits++;
+    }
+  return bits;
+}
+
+
+
+/*
+  Returns the exponent e for which every real and imaginary part of the
+  vector lies below 2^e in magnitude (0 for an all-zero vector).
+*/
+static int q15BlockExponent(float *dataPtr, int length)
+{
+  int index, exponent;
+  float peak = 0;
+
+  for(index = 0; index < 2 * length; index++)
+    {
+      if(fabs(dataPtr[index]) > peak)
+	{
+	  peak = fabs(dataPtr[index]);
+	}
+    }
+  if(peak == 0)
+    {
+      return 0;
+    }
+  frexp(peak, &exponent);
+  return exponent;
+}
+
+
+
+static short q15Quantize(float value, int shift)
+{
+  double scaled = ldexp((double)value, shift);
+
+  scaled = (scaled < 0) ? scaled - 0.5 : scaled + 0.5;
+  if(scaled > SHRT_MAX)
+    {
+      return SHRT_MAX;
+    }
+  if(scaled < SHRT_MIN)
+    {
+      return SHRT_MIN;
+    }
+  return (short)scaled;
+}
+
+
+
+/*
+  tdFirQ15Setup quantizes the bank.  This happens outside the timed region,
+  as it would in a receiver whose samples arrive as 16-bit integers.
+
+  With L taps, a complex output is a sum of 2L real products.  Scaling the
+  inputs to below 2^(15-gx) and the filters to below 2^(15-gh) with
+  gx+gh = ceil(log2(L))+2 guard bits bounds every such sum by 2^30, even
+  with NEON's doubling, so neither the lanes nor their final reduction can
+  overflow.
+
+  Each input row is stored padded with filterLength-1 leading and
+  q15Taps-1 trailing zeros, so every output is a dot product over a
+  contiguous window.  Each filter is stored time reversed, zero padded to
+  q15Taps (a multiple of four taps, one 128-bit vector), as two arrays of
+  (re,im) pairs: (hr,-hi) yields the real part of the product with
+  (xr,xi), (hi,hr) the imaginary part.
+*/
+void tdFirQ15Setup(struct tdFirVariables *tdFirVars)
+{
+  int filter, index, tap;
+  int inputLength  = tdFirVars->inputLength;
+  int filterLength = tdFirVars->filterLength;
+  int guardBits, guardInput, guardFilter, shiftInput, shiftFilter;
+  int taps, stride;
+  float *inputPtr, *filterPtr;
+  short *qInputPtr, *qFilterPtr;
+
+  taps   = (filterLength + 3) & ~3;
+  stride = inputLength + filterLength - 1 + taps - 1;
+  tdFirVars->q15Taps        = taps;
+  tdFirVars->q15InputStride = stride;
+  tdFirVars->q15InputPtr    = calloc(2 * stride * tdFirVars->numFilters, sizeof(short));
+  tdFirVars->q15FilterPtr   = calloc(4 * taps * tdFirVars->numFilters, sizeof(short));
+  tdFirVars->q15ScalePtr    = malloc(tdFirVars->numFilters * sizeof(float));
+  if(tdFirVars->q15InputPtr == NULL || tdFirVars->q15FilterPtr == NULL ||
+     tdFirVars->q15ScalePtr == NULL)
+    {
+      printf("tdFirQ15Setup: out of memory\n");
+      exit(-1);
+    }
+
+  guardBits   = q15Log2Ceil(filterLength) + 2;
+  guardInput  = guardBits / 2;
+  guardFilter = guardBits - guardInput;
+
+  for(filter = 0; filter < tdFirVars->numFilters; filter++)
+    {
+      inputPtr   = tdFirVars->input.data  + (filter * (2*inputLength));
+      filterPtr  = tdFirVars->filter.data + (filter * (2*filterLength));
+      qInputPtr  = tdFirVars->q15InputPtr  + (filter * (2*stride));
+      qFilterPtr = tdFirVars->q15FilterPtr + (filter * (4*taps));
+
+      shiftInput  = 15 - guardInput  - q15BlockExponent(inputPtr, inputLength);
+      shiftFilter = 15 - guardFilter - q15BlockExponent(filterPtr, filterLength);
+
+      for(index = 0; index < 2 * inputLength; index++)
+	{
+	  qInputPtr[2 * (filterLength - 1) + index] =
+	    q15Quantize(inputPtr[index], shiftInput);
+	}
+
+      for(index = 0; index < filterLength; index++)
+	{
+	  tap = filterLength - 1 - index;
+	  qFilterPtr[2 * index]                = q15Quantize(filterPtr[2 * tap], shiftFilter);
+	  qFilterPtr[2 * index + 1]            = -q15Quantize(filterPtr[2 * tap + 1], shiftFilter);
+	  qFilterPtr[2 * (taps + index)]       = q15Quantize(filterPtr[2 * tap + 1], shiftFilter);
+	  qFilterPtr[2 * (taps + index) + 1]   = q15Quantize(filterPtr[2 * tap], shiftFilter);
+	}
+
+      tdFirVars->q15ScalePtr[filter] =
+	(float)ldexp(1.0, -(shiftInput + shiftFilter + (TDFIR_Q15_ACC_BITS - 30)));
+    }
+}
+
+
+
+#if !defined(TDFIR_Q15_NEON) && !defined(TDFIR_Q15_SSE2)
+static int q15SatAdd(int a, int b)
+{
+  if(b > 0 && a > INT_MAX - b)
+    {
+      return INT_MAX;
+    }
+  if(b < 0 && a < INT_MIN - b)
+    {
+      return INT_MIN;
+    }
+  return a + b;
+}
+#endif
+
+
+
+/*
+  q15Dot computes one complex output: the dot product of 'taps' complex
+  samples at xPtr with the two packed filter arrays.
+*/
+static void q15Dot(short *xPtr, short *aPtr, short *bPtr, int taps,
+		   int *realPtr, int *imagPtr)
+{
+  int index;
+#if defined(TDFIR_Q15_NEON)
+  int16x8_t x, a, b;
+  int32x4_t accR = vdupq_n_s32(0);
+  int32x4_t accI = vdupq_n_s32(0);
+  int32x2_t sumR, sumI;
+
+  for(index = 0; index < 2 * taps; index += 8)
+    {
+      x = vld1q_s16(xPtr + index);
+      a = vld1q_s16(aPtr + index);
+      b = vld1q_s16(bPtr + index);
+      accR = vqdmlal_s16(accR, vget_low_s16(x),  vget_low_s16(a));
+      accR = vqdmlal_s16(accR, vget_high_s16(x), vget_high_s16(a));
+      accI = vqdmlal_s16(accI, vget_low_s16(x),  vget_low_s16(b));
+      accI = vqdmlal_s16(accI, vget_high_s16(x), vget_high_s16(b));
+    }
+  sumR = vqadd_s32(vget_low_s32(accR), vget_high_s32(accR));
+  sumI = vqadd_s32(vget_low_s32(accI), vget_high_s32(accI));
+  *realPtr = vget_lane_s32(vqadd_s32(sumR, vrev64_s32(sumR)), 0);
+  *imagPtr = vget_lane_s32(vqadd_s32(sumI, vrev64_s32(sumI)), 0);
+#elif defined(TDFIR_Q15_SSE2)
+  __m128i x;
+  __m128i accR = _mm_setzero_si128();
+  __m128i accI = _mm_setzero_si128();
+
+  for(index = 0; index < 2 * taps; index += 8)
+    {
+      x = _mm_loadu_si128((__m128i *)(xPtr + index));
+      accR = _mm_add_epi32(accR, _mm_madd_epi16(x, _mm_loadu_si128((__m128i *)(aPtr + index))));
+      accI = _mm_add_epi32(accI, _mm_madd_epi16(x, _mm_loadu_si128((__m128i *)(bPtr + index))));
+    }
+  accR = _mm_add_epi32(accR, _mm_shuffle_epi32(accR, _MM_SHUFFLE(1,0,3,2)));
+  accR = _mm_add_epi32(accR, _mm_shuffle_epi32(accR, _MM_SHUFFLE(2,3,0,1)));
+  accI = _mm_add_epi32(accI, _mm_shuffle_epi32(accI, _MM_SHUFFLE(1,0,3,2)));
+  accI = _mm_add_epi32(accI, _mm_shuffle_epi32(accI, _MM_SHUFFLE(2,3,0,1)));
+  *realPtr = _mm_cvtsi128_si32(accR);
+  *imagPtr = _mm_cvtsi128_si32(accI);
+#else
+  int accR = 0, accI = 0;
+
+  for(index = 0; index < 2 * taps; index += 2)
+    {
+      accR = q15SatAdd(accR, xPtr[index] * aPtr[index] + xPtr[index + 1] * aPtr[index + 1]);
+      accI = q15SatAdd(accI, xPtr[index] * bPtr[index] + xPtr[index + 1] * bPtr[index + 1]);
+    }
+  *realPtr = accR;
+  *imagPtr = accI;
+#endif
+}
+
+
+
+/*
+  tdFirQ15 runs the quantized bank and converts each output back to float
+  with its filter's scale.
+*/
+void tdFirQ15(struct tdFirVariables *tdFirVars)
+{
+  int filter, index, real, imag;
+  int taps         = tdFirVars->q15Taps;
+  int stride       = tdFirVars->q15InputStride;
+  int resultLength = tdFirVars->resultLength;
+  short *qInputPtr, *qFilterPtr;
+  float *resultPtr;
+  float scale;
+
+  for(filter = 0; filter < tdFirVars->numFilters; filter++)
+    {
+      qInputPtr  = tdFirVars->q15InputPtr  + (filter * (2*stride));
+      qFilterPtr = tdFirVars->q15FilterPtr + (filter * (4*taps));
+      resultPtr  = tdFirVars->result.data  + (filter * (2*resultLength));
+      scale      = tdFirVars->q15ScalePtr[filter];
+
+      for(index = 0; index < resultLength; index++)
+	{
+	  q15Dot(qInputPtr + 2 * index, qFilterPtr, qFilterPtr + 2 * taps,
+		 taps, &real, &imag);
+	  resultPtr[2 * index]     = real * scale;
+	  resultPtr[2 * index + 1] = imag * scale;
+	}
+    }
+}
+
+
+
+void tdFirQ15Complete(struct tdFirVariables *tdFirVars)
+{
+  free(tdFirVars->q15InputPtr);
+  free(tdFirVars->q15FilterPtr);
+  free(tdFirVars->q15ScalePtr);
+}
@@ -0,0 +1,196 @@
+/******************************************************************************
+** File: tdFirStream.c
+**
+** HPEC Challenge Benchmark Suite
+** TDFIR Kernel Benchmark
+**
+** Contents:
+** Desc    : This file provides a stateful, block streaming FIR filter built
+**           on the elCplxMul kernel of the generic C TDFIR implementation.
+**           Every call to tdFirStreamProcess() consumes blockLength input
+**           samples and produces exactly blockLength output samples; the
+**           filterLength-1 samples of history are carried between calls,
+**           so a signal may be filtered indefinitely.  All memory is
+**           allocated in tdFirStreamSetup(), none per call.
+**
+******************************************************************************/
+
+#include "./tdFir.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+  tdFirStreamSetup allocates the history ring for one filter.  The ring
+  holds 'capacity' = filterLength-1+blockLength complex samples, stored
+  twice (see struct tdFirStream in tdFir.h).
+*/
+void tdFirStreamSetup(struct tdFirStream *stream, float *filterPtr,
+		      int filterLength, int blockLength)
+{
+  stream->filterPtr    = filterPtr;
+  stream->filterLength = filterLength;
+  stream->blockLength  = blockLength;
+  stream->capacity     = filterLength - 1 + blockLength;
+  stream->ringPtr      = malloc(4 * stream->capacity * sizeof(float));
+
+  if(stream->ringPtr == NULL)
+    {
+      printf("tdFirStreamSetup: out of memory\n");
+      exit(-1);
+    }
+
+  tdFirStreamReset(stream);
+}
+
+
+
+/*
+  Forget all history; the next block is filtered as if it were preceded
+  by zeros.
+*/
+void tdFirStreamReset(struct tdFirStream *stream)
+{
+  memset(stream->ringPtr, 0, 4 * stream->capacity * sizeof(float));
+  stream->writeIndex = 0;
+}
+
+
+
+/*
+  tdFirStreamProcess filters one block.
+  Input Parameters:
+  stream    - the filter state
+  blockPtr  - blockLength complex input samples
+  resultPtr - space for blockLength complex output samples
+*/
+void tdFirStreamProcess(struct tdFirStream *stream, float *blockPtr,
+			float *resultPtr)
+{
+  int index;
+  int capacity     = stream->capacity;
+  int blockLength  = stream->blockLength;
+  int filterLength = stream->filterLength;
+  int writeIndex   = stream->writeIndex;
+  int head;
+  float *ringPtr   = stream->ringPtr;
+  float *windowPtr;
+  float *filterPtr = stream->filterPtr;
+
+  /*
+    Write the block over the oldest samples, once at its ring index and
+    once at its mirror.  blockLength <= capacity, so the first copy never
+    runs past the end of the 2*capacity buffer and the mirror wraps at
+    most once.
+  */
+  memcpy(ringPtr + 2 * writeIndex, blockPtr, 2 * blockLength * sizeof(float));
+  if(writeIndex + blockLength <= capacity)
+    {
+      memcpy(ringPtr + 2 * (writeIndex + capacity), blockPtr,
+	     2 * blockLength * sizeof(float));
+    }
+  else
+    {
+      head = capacity - writeIndex;
+      memcpy(ringPtr + 2 * (writeIndex + capacity), blockPtr,
+	     2 * head * sizeof(float));
+      memcpy(ringPtr, blockPtr + 2 * head,
+	     2 * (blockLength - head) * sizeof(float));
+    }
+
+  writeIndex += blockLength;
+  if(writeIndex >= capacity)
+    {
+      writeIndex -= capacity;
+    }
+  stream->writeIndex = writeIndex;
+
+  /*
+    The newest 'capacity' samples now start at the oldest sample's index:
+    filterLength-1 samples of history followed by the new block.
+  */
+  windowPtr = ringPtr + 2 * writeIndex;
+
+  for(index = 0; index < 2 * blockLength; index++)
+    {
+      resultPtr[index] = 0;
+    }
+
+  /*
+    Output n of the block is sum_k h[k] * window[filterLength-1+n-k], so
+    tap k is one elCplxMul over the window shifted by filterLength-1-k.
+  */
+  for(index = 0; index < filterLength; index++)
+    {
+      elCplxMul(windowPtr + 2 * (filterLength - 1 - index),
+		filterPtr + 2 * index, resultPtr, blockLength);
+    }
+}
+
+
+
+void tdFirStreamComplete(struct tdFirStream *stream)
+{
+  free(stream->ringPtr);
+  stream->ringPtr = NULL;
+}
+
+
+
+/*
+  tdFirStreamRun drives the streams for the benchmark: each input vector is
+  pushed through its filter's stream in blocks, followed by zeros to flush
+  the last filterLength-1 outputs, so the result matches the full
+  convolution computed by the filter bank.  Only the final, partial block
+  goes through the scratch buffers allocated in tdFirSetup.
+*/
+void tdFirStreamRun(struct tdFirVariables *tdFirVars)
+{
+  int filter, index, done, count;
+  int blockLength  = tdFirVars->blockLength;
+  int inputLength  = tdFirVars->inputLength;
+  int resultLength = tdFirVars->resultLength;
+  float *inputPtr;
+  float *resultPtr;
+  float *blockPtr;
+  float *outPtr;
+
+  for(filter = 0; filter < tdFirVars->numFilters; filter++)
+    {
+      inputPtr  = tdFirVars->input.data  + (filter * (2*inputLength));
+      resultPtr = tdFirVars->result.data + (filter * (2*resultLength));
+
+      for(done = 0; done < resultLength; done += blockLength)
+	{
+	  if(done + blockLength <= inputLength)
+	    {
+	      blockPtr = inputPtr + 2 * done;
+	    }
+	  else
+	    {
+	      blockPtr = tdFirVars->blockPtr;
+	      count = (done < inputLength) ? inputLength - done : 0;
+	      for(index = 0; index < 2 * blockLength; index++)
+		{
+		  blockPtr[index] = (index < 2 * count) ? inputPtr[2 * done + index] : 0;
+		}
+	    }
+
+	  if(done + blockLength <= resultLength)
+	    {
+	      tdFirStreamProcess(&tdFirVars->streams[filter], blockPtr,
+				 resultPtr + 2 * done);
+	    }
+	  else
+	    {
+	      outPtr = tdFirVars->blockResultPtr;
+	      tdFirStreamProcess(&tdFirVars->streams[filter], blockPtr, outPtr);
+	      for(index = 0; index < 2 * (resultLength - done); index++)
+		{
+		  resultPtr[2 * done + index] = outPtr[index];
+		}
+	    }
+	}
+    }
+}
@@ -9,6 +9,8 @@
 **           functionality of the time-domain FIR filter bank implementation.                                   
 **            Inputs: ./data/<dataset>-tdFir-output.dat         
 **                    ./data/<dataset>-tdFir-answer.dat         
+**                    (batch mode: ./data/<dataset>-tdFir-input.dat
+**                     and ./data/<dataset>-tdFir-filter.dat instead)
 **
 ** Author: Matthew A. Alexander 
 **         MIT Lincoln Laboratory
@@ -20,12 +22,18 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include "tdFir.h"
 /*
   Need to include tdFir.h to used the tdFirVars structure.
 */
 
+struct tdFirVariables tdFirVars;
+
 void tdFirVerify(struct tdFirVariables *tdFirVars);
+void tdFirVerifyBatchAnswer(struct tdFirVariables *tdFirVars);
+int  tdFirVerifySnr(float *expectedPtr, float *kernelResPtr,
+		    int numFilters, int resultLength, double bound);
 void tdFirComplete(struct tdFirVariables *tdFirVars);
 
 
@@ -39,12 +47,13 @@ int main(int argc, char **argv)
   if (argc == 1)
     {
       printf("No dataset provided\n");
-      printf("Usage: tdFirVerify <dataset> \n");
+      printf("Usage: tdFirVerify <dataset> [q15 | batch | fp16 | bf16]\n");
       exit(-1);
     }
   else
     {
       tdFirVars.dataSet = argv[1];
+      tdFirVars.modeName = (argc > 2) ? argv[2] : NULL;
     }
   
   tdFirVerify(&tdFirVars);
@@ -86,7 +95,14 @@ void tdFirVerify(struct tdFirVariables *tdFirVars)
   sprintf(  resultString,"./data/%s-tdFir-output.dat",tdFirVars->dataSet);
 
 
-  readFromFile(float, dataSetString, tdFirVars->result);    
+  if(tdFirVars->modeName != NULL && strcmp(tdFirVars->modeName, "batch") == 0)
+    {
+      tdFirVerifyBatchAnswer(tdFirVars);
+    }
+  else
+    {
+      readFromFile(float, dataSetString, tdFirVars->result);    
+    }
   readFromFile(float, resultString, tdFirVars->input);
   inputLength = tdFirVars->result.size[1];
   resultLength = tdFirVars->input.size[1];
@@ -108,6 +124,29 @@ void tdFirVerify(struct tdFirVariables *tdFirVars)
 
 
 
+  /*
+    Fixed point and half precision output is judged by its
+    signal-to-quantization-noise ratio rather than element by element.
+  */
+  if(tdFirVars->modeName != NULL && strcmp(tdFirVars->modeName, "q15") == 0)
+    {
+      failed = !tdFirVerifySnr(expectedPtr_r, kernelResPtr_r, numFilters, inputLength,
+			       TDFIR_Q15_MIN_SNR_DB);
+      printf("Verification: %s \n", failed ? "FAIL" : "PASS");
+      return;
+    }
+  if(tdFirVars->modeName != NULL && (strcmp(tdFirVars->modeName, "fp16") == 0 ||
+				     strcmp(tdFirVars->modeName, "bf16") == 0))
+    {
+      failed = !tdFirVerifySnr(expectedPtr_r, kernelResPtr_r, numFilters, inputLength,
+			       strcmp(tdFirVars->modeName, "fp16") == 0 ?
+			       TDFIR_FP16_MIN_SNR_DB : TDFIR_BF16_MIN_SNR_DB);
+      printf("Verification: %s \n", failed ? "FAIL" : "PASS");
+      return;
+    }
+
+
+
   /*
     Verify that both the real and imaginary values are equal to the
     expected result.  If they're not, print out the index and values, then
@@ -181,6 +220,107 @@ void tdFirVerify(struct tdFirVariables *tdFirVars)
 
 
 
+/*
+  tdFirVerifyBatchAnswer computes the answer of batch mode, which filters
+  every input with filter 0, into tdFirVars->result: the full convolution
+  of each input with filter 0, in double precision and rounded to float,
+  as the answer files hold it for the filter bank.
+*/
+void tdFirVerifyBatchAnswer(struct tdFirVariables *tdFirVars)
+{
+  int numInputs, inputLength, filterLength, resultLength;
+  int input, index, tap;
+  double accR, accI;
+  float *xPtr, *hPtr, *yPtr;
+  char inputString[100];
+  char filterString[100];
+
+  sprintf(inputString,  "./data/%s-tdFir-input.dat",  tdFirVars->dataSet);
+  sprintf(filterString, "./data/%s-tdFir-filter.dat", tdFirVars->dataSet);
+  readFromFile(float, inputString,  tdFirVars->input);
+  readFromFile(float, filterString, tdFirVars->filter);
+
+  numInputs    = tdFirVars->input.size[0];
+  inputLength  = tdFirVars->input.size[1];
+  filterLength = tdFirVars->filter.size[1];
+  resultLength = inputLength + filterLength - 1;
+  pca_create_carray_2d(float, tdFirVars->result, numInputs, resultLength, PCA_COMPLEX);
+
+  hPtr = tdFirVars->filter.data;
+  for(input = 0; input < numInputs; input++)
+    {
+      xPtr = tdFirVars->input.data  + input * 2 * inputLength;
+      yPtr = tdFirVars->result.data + input * 2 * resultLength;
+      for(index = 0; index < resultLength; index++)
+	{
+	  accR = 0;
+	  accI = 0;
+	  for(tap = 0; tap < filterLength; tap++)
+	    {
+	      if(index - tap >= 0 && index - tap < inputLength)
+		{
+		  accR += (double)hPtr[2*tap] * xPtr[2*(index-tap)]
+		    - (double)hPtr[2*tap+1] * xPtr[2*(index-tap)+1];
+		  accI += (double)hPtr[2*tap] * xPtr[2*(index-tap)+1]
+		    + (double)hPtr[2*tap+1] * xPtr[2*(index-tap)];
+		}
+	    }
+	  yPtr[2*index]   = (float)accR;
+	  yPtr[2*index+1] = (float)accI;
+	}
+    }
+
+  clean_mem(float, tdFirVars->input);
+  clean_mem(float, tdFirVars->filter);
+}
+
+
+
+/*
+  tdFirVerifySnr computes, for each filter, the ratio of the expected
+  output's energy to the energy of the error, and requires every filter to
+  reach 'bound' dB.
+*/
+int tdFirVerifySnr(float *expectedPtr, float *kernelResPtr,
+		   int numFilters, int resultLength, double bound)
+{
+  int filter, index;
+  int passed = 1;
+  double signal, noise, diff, snr;
+  double minSnr = 1e9;
+
+  for(filter = 0; filter < numFilters; filter++)
+    {
+      signal = 0;
+      noise  = 0;
+      for(index = 0; index < 2 * resultLength; index++)
+	{
+	  diff    = expectedPtr[index] - kernelResPtr[index];
+	  signal += expectedPtr[index] * expectedPtr[index];
+	  noise  += diff * diff;
+	}
+      snr = (noise > 0) ? 10 * log10(signal / noise) : 1e9;
+      if(snr < minSnr)
+	{
+	  minSnr = snr;
+	}
+      if(snr < bound)
+	{
+#ifdef VERBOSE
+	  printf("filter %d: SNR %f dB below %f dB\n", filter, snr, bound);
+#endif
+	  passed = 0;
+	}
+      expectedPtr  += 2 * resultLength;
+      kernelResPtr += 2 * resultLength;
+    }
+
+  printf("Minimum SNR: %f dB (bound %f dB)\n", minSnr, bound);
+  return passed;
+}
+
+
+
 void tdFirComplete(struct tdFirVariables *tdFirVars)
 {
   clean_mem(float, tdFirVars->input);